@@ -0,0 +1,144 @@
+#include "atomic_bitvector.hpp"
+
+#include <algorithm> // std::min
+#include <bit>
+#include <stdexcept>
+#include <utility> // std::exchange
+
+// -- helpers --
+
+void AtomicBitVector::check_index(size_t i) const {
+  if (i >= nbits)
+    throw std::out_of_range("Index");
+}
+
+std::atomic_ref<word_t> AtomicBitVector::word(size_t w) const noexcept {
+  return std::atomic_ref<word_t>(data[w]);
+}
+
+std::memory_order
+AtomicBitVector::load_order(std::memory_order order) noexcept {
+  switch (order) {
+  case std::memory_order_release:
+    return std::memory_order_relaxed;
+  case std::memory_order_acq_rel:
+    return std::memory_order_acquire;
+  default:
+    return order;
+  }
+}
+
+std::memory_order
+AtomicBitVector::store_order(std::memory_order order) noexcept {
+  switch (order) {
+  case std::memory_order_consume:
+    return std::memory_order_release;
+  case std::memory_order_acquire:
+  case std::memory_order_acq_rel:
+    return std::memory_order_seq_cst;
+  default:
+    return order;
+  }
+}
+
+// -- constructors --
+
+AtomicBitVector::AtomicBitVector(size_t size, bool value)
+    : data(new word_t[BitVector::words_for_bits(size)]()), nbits(size) {
+  if (value)
+    setAll(true, std::memory_order_relaxed);
+}
+
+AtomicBitVector::AtomicBitVector(const BitVector &bv)
+    : data(new word_t[bv.word_count()]), nbits(bv.size()) {
+  for (size_t w = 0; w < bv.word_count(); ++w)
+    data[w] = bv.word_at(w); // the complement applied, bv left as it is
+}
+
+AtomicBitVector::AtomicBitVector(AtomicBitVector &&other) noexcept
+    : data(std::move(other.data)), nbits(std::exchange(other.nbits, 0)) {}
+
+AtomicBitVector &AtomicBitVector::operator=(AtomicBitVector &&other) noexcept {
+  if (this != &other) {
+    data = std::move(other.data);
+    nbits = std::exchange(other.nbits, 0);
+  }
+  return *this;
+}
+
+size_t AtomicBitVector::size() const noexcept { return nbits; }
+
+// -- single bits --
+
+bool AtomicBitVector::test(size_t i, std::memory_order order) const {
+  check_index(i);
+  return (word(i / BITS_PER_WORD).load(load_order(order)) >>
+          (i % BITS_PER_WORD)) &
+         1u;
+}
+
+void AtomicBitVector::set(size_t i, std::memory_order order) {
+  test_and_set(i, order);
+}
+
+void AtomicBitVector::reset(size_t i, std::memory_order order) {
+  test_and_reset(i, order);
+}
+
+void AtomicBitVector::flip(size_t i, std::memory_order order) {
+  check_index(i);
+  word(i / BITS_PER_WORD).fetch_xor(word_t(1) << (i % BITS_PER_WORD), order);
+}
+
+bool AtomicBitVector::test_and_set(size_t i, std::memory_order order) {
+  check_index(i);
+  word_t mask = word_t(1) << (i % BITS_PER_WORD);
+  return word(i / BITS_PER_WORD).fetch_or(mask, order) & mask;
+}
+
+bool AtomicBitVector::test_and_reset(size_t i, std::memory_order order) {
+  check_index(i);
+  word_t mask = word_t(1) << (i % BITS_PER_WORD);
+  return word(i / BITS_PER_WORD).fetch_and(~mask, order) & mask;
+}
+
+// -- whole vector --
+
+void AtomicBitVector::setAll(bool value, std::memory_order order) {
+  order = store_order(order);
+  size_t nwords = BitVector::words_for_bits(nbits);
+  for (size_t w = 0; w < nwords; ++w) {
+    word_t v = value ? ~word_t(0) : word_t(0);
+    if (value && w + 1 == nwords && nbits % BITS_PER_WORD != 0)
+      v = (word_t(1) << (nbits % BITS_PER_WORD)) - 1; // keep the tail zero
+    word(w).store(v, order);
+  }
+}
+
+void AtomicBitVector::merge(const BitVector &bv, std::memory_order order) {
+  size_t nwords = std::min(BitVector::words_for_bits(nbits), bv.word_count());
+  for (size_t w = 0; w < nwords; ++w) {
+    word_t v = bv.word_at(w);
+    if (w + 1 == BitVector::words_for_bits(nbits) &&
+        nbits % BITS_PER_WORD != 0)
+      v &= (word_t(1) << (nbits % BITS_PER_WORD)) - 1;
+    if (v) // skip the atomic for words with nothing to add
+      word(w).fetch_or(v, order);
+  }
+}
+
+size_t AtomicBitVector::weight(std::memory_order order) const {
+  size_t cnt = 0;
+  size_t nwords = BitVector::words_for_bits(nbits);
+  for (size_t w = 0; w < nwords; ++w)
+    cnt += static_cast<size_t>(std::popcount(word(w).load(load_order(order))));
+  return cnt;
+}
+
+BitVector AtomicBitVector::snapshot(std::memory_order order) const {
+  BitVector out(nbits, false);
+  size_t nwords = BitVector::words_for_bits(nbits);
+  for (size_t w = 0; w < nwords; ++w)
+    out.data[w] = word(w).load(load_order(order));
+  return out;
+}
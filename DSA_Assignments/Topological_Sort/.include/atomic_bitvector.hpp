@@ -0,0 +1,67 @@
+#pragma once
+
+// Bit vector that many threads may update at once without a lock.
+// Every bit operation is a single std::atomic_ref<uint64_t> fetch_or /
+// fetch_and / fetch_xor on the word holding the bit, so writers of
+// neighbouring bits never lose each other's updates (a plain BitVector::set
+// is a read-modify-write of the whole word).
+// Each operation takes a memory order: acq_rel (the default) to publish or
+// observe data guarded by the bit, relaxed for pure marking (visited sets).
+// Construction, moves and snapshot() of a vector still being written are
+// the caller's to order; a snapshot reads each word atomically but not all
+// words at one instant.
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "bitvector.hpp"
+
+class AtomicBitVector {
+public:
+  // Constructors (not thread-safe themselves)
+  AtomicBitVector() = default;
+  explicit AtomicBitVector(size_t size, bool value = false);
+  explicit AtomicBitVector(const BitVector &bv);
+  AtomicBitVector(const AtomicBitVector &) = delete;
+  AtomicBitVector &operator=(const AtomicBitVector &) = delete;
+  // A moved-from vector is empty
+  AtomicBitVector(AtomicBitVector &&other) noexcept;
+  AtomicBitVector &operator=(AtomicBitVector &&other) noexcept;
+
+  size_t size() const noexcept;
+
+  // single bits
+  bool test(size_t i,
+            std::memory_order order = std::memory_order_acquire) const;
+  void set(size_t i, std::memory_order order = std::memory_order_acq_rel);
+  void reset(size_t i, std::memory_order order = std::memory_order_acq_rel);
+  void flip(size_t i, std::memory_order order = std::memory_order_acq_rel);
+  // Sets bit i and returns its previous value: exactly one of several
+  // threads racing on the same bit sees false
+  bool test_and_set(size_t i,
+                    std::memory_order order = std::memory_order_acq_rel);
+  bool test_and_reset(size_t i,
+                      std::memory_order order = std::memory_order_acq_rel);
+
+  // whole vector, word by word
+  void setAll(bool value,
+              std::memory_order order = std::memory_order_release);
+  // OR a private BitVector in (e.g. one producer's local results)
+  void merge(const BitVector &bv,
+             std::memory_order order = std::memory_order_acq_rel);
+  size_t weight(std::memory_order order = std::memory_order_acquire) const;
+  BitVector
+  snapshot(std::memory_order order = std::memory_order_acquire) const;
+
+private:
+  void check_index(size_t i) const;
+  std::atomic_ref<word_t> word(size_t w) const noexcept;
+  // Load orders cannot be release/acq_rel
+  static std::memory_order load_order(std::memory_order order) noexcept;
+  // Store orders cannot be consume/acquire/acq_rel
+  static std::memory_order store_order(std::memory_order order) noexcept;
+
+  std::unique_ptr<word_t[]> data;
+  size_t nbits = 0;
+};
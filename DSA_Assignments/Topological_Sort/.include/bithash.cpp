@@ -0,0 +1,46 @@
+#include "bithash.hpp"
+
+static constexpr uint64_t P0 = 0xa0761d6478bd642fu;
+static constexpr uint64_t P1 = 0xe7037ed1a0b428dbu;
+static constexpr uint64_t P2 = 0x8ebc6af09c88c6e3u;
+static constexpr uint64_t P3 = 0x589965cc75374cc3u;
+
+// Full 64x64 product, high half folded into the low half
+static uint64_t mum(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+  __extension__ using u128 = unsigned __int128;
+  u128 r = static_cast<u128>(a) * b;
+  return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#else
+  uint64_t al = a & 0xffffffffu, ah = a >> 32;
+  uint64_t bl = b & 0xffffffffu, bh = b >> 32;
+  uint64_t ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+  uint64_t mid = (ll >> 32) + (lh & 0xffffffffu) + (hl & 0xffffffffu);
+  uint64_t lo = (mid << 32) | (ll & 0xffffffffu);
+  uint64_t hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+  return lo ^ hi;
+#endif
+}
+
+// word(i) reads word i of the input
+template <class Word>
+static uint64_t hash_word_reader(Word word, size_t n, uint64_t seed) {
+  uint64_t h = seed ^ P0;
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+    h = mum(word(i) ^ P1, word(i + 1) ^ h);
+  if (i < n)
+    h = mum(word(i) ^ P1, h ^ P2);
+  return mum(h ^ P3, static_cast<uint64_t>(n) ^ P1);
+}
+
+uint64_t hash_words(const uint64_t *words, size_t n, uint64_t seed) {
+  return hash_word_reader([words](size_t i) { return words[i]; }, n, seed);
+}
+
+uint64_t hash_words_complement(const uint64_t *words, size_t n, uint64_t seed,
+                               uint64_t last_mask) {
+  return hash_word_reader(
+      [=](size_t i) { return i + 1 == n ? ~words[i] & last_mask : ~words[i]; },
+      n, seed);
+}
@@ -1,58 +1,125 @@
 // BitMatrix.cpp (or continuation of single-file)
 #include "bitmatrix.hpp"
+#include "parallel.hpp"
+#include "prefetch.hpp"
+#include "snapshot.hpp"
 #include <algorithm>
-#include <cmath>
+#include <bit>
+#include <fstream>
+#include <utility> // std::in_range
 
 // --- Private helpers ---
 
+// Bit i moves to bit 63 - i
+static word_t reverse_bits(word_t x) {
+  x = std::byteswap(x);
+  x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fu) | ((x & 0x0f0f0f0f0f0f0f0fu) << 4);
+  x = ((x >> 2) & 0x3333333333333333u) | ((x & 0x3333333333333333u) << 2);
+  x = ((x >> 1) & 0x5555555555555555u) | ((x & 0x5555555555555555u) << 1);
+  return x;
+}
+
 void BitMatrix::check_row_index(size_t i) const {
   if (i >= m_matrix.size())
     throw std::out_of_range("Row index out of bounds");
 }
 
-BitMatrix BitMatrix::row_wise_op(const BitMatrix &rhs, char op) const {
+void BitMatrix::check_same_dimensions(const BitMatrix &rhs) const {
   if (m_matrix.size() != rhs.m_matrix.size() || columns() != rhs.columns()) {
     throw std::invalid_argument(
         "Matrices must have the same dimensions for bitwise operation");
   }
-  BitMatrix result(*this); // Start with a copy
+}
+
+size_t BitMatrix::rows_per_block() const {
+  size_t row_words = std::max<size_t>(1, BitVector::words_for_bits(columns()));
+  return std::max<size_t>(1, PARALLEL_GRAIN_WORDS / row_words);
+}
+
+size_t BitMatrix::row_blocks() const {
+  return (m_matrix.size() + rows_per_block() - 1) / rows_per_block();
+}
+
+// Blocks are fixed by the shape alone and callers combine their results in
+// block order, so a reduction does not depend on the thread count
+void BitMatrix::for_row_blocks(
+    const std::function<void(size_t, size_t, size_t)> &body) const {
+  size_t n = m_matrix.size();
+  size_t per_block = rows_per_block();
+  auto block = [&](size_t b) {
+    body(b, b * per_block, std::min(n, (b + 1) * per_block));
+  };
+  size_t row_words = BitVector::words_for_bits(columns());
+  if (n * row_words < PARALLEL_MIN_WORDS) {
+    for (size_t b = 0; b < row_blocks(); ++b)
+      block(b);
+    return;
+  }
+  parallel_chunks(row_blocks(), block);
+}
+
+// Each result row is evaluated in one fused pass straight from both operands
+BitMatrix BitMatrix::row_wise_op(const BitMatrix &rhs, char op) const {
+  check_same_dimensions(rhs);
+  BitMatrix result;
+  result.m_matrix.reserve(m_matrix.size());
   for (size_t i = 0; i < m_matrix.size(); ++i) {
     switch (op) {
     case '&':
-      result.m_matrix[i] &= rhs.m_matrix[i];
+      result.m_matrix.push_back(BitVector(m_matrix[i] & rhs.m_matrix[i]));
       break;
     case '|':
-      result.m_matrix[i] |= rhs.m_matrix[i];
+      result.m_matrix.push_back(BitVector(m_matrix[i] | rhs.m_matrix[i]));
       break;
     case '^':
-      result.m_matrix[i] ^= rhs.m_matrix[i];
+      result.m_matrix.push_back(BitVector(m_matrix[i] ^ rhs.m_matrix[i]));
       break;
     default:
+      result.m_matrix.push_back(m_matrix[i]);
       break;
     }
   }
   return result;
 }
 
+// Compound forms update the rows in place, no copy of the matrix
+void BitMatrix::row_wise_assign(const BitMatrix &rhs, char op) {
+  check_same_dimensions(rhs);
+  for (size_t i = 0; i < m_matrix.size(); ++i) {
+    switch (op) {
+    case '&':
+      m_matrix[i] &= rhs.m_matrix[i];
+      break;
+    case '|':
+      m_matrix[i] |= rhs.m_matrix[i];
+      break;
+    case '^':
+      m_matrix[i] ^= rhs.m_matrix[i];
+      break;
+    default:
+      break;
+    }
+  }
+}
+
 // --- Constructors / Destructor / Assignment ---
 
 BitMatrix::BitMatrix() : m_matrix() {}
 
+// Row i holds vec[i] in bit_width(max) bits, index 0 = MSB: the value with
+// its bits reversed, built as one word
 BitMatrix::BitMatrix(const std::vector<unsigned int> &vec) {
-  // determine number of bits for the largest number
+  if (vec.empty())
+    return;
   unsigned int maxVal = *std::max_element(vec.begin(), vec.end());
-  int nbits =
-      (maxVal > 0) ? static_cast<int>(std::floor(std::log2(maxVal))) + 1 : 1;
+  size_t nbits = std::max<size_t>(1, std::bit_width(maxVal));
 
   m_matrix.reserve(vec.size());
 
   for (unsigned int num : vec) {
-    BitVector bv(nbits, false);
-    for (int i = 0; i < nbits; ++i) {
-      // index 0 = MSB
-      bv[i] = (num >> (nbits - 1 - i)) & 1;
-    }
-    m_matrix.push_back(std::move(bv));
+    word_t row = reverse_bits(num) >> (BITS_PER_WORD - nbits);
+    m_matrix.push_back(
+        BitVector::from_words(std::span<const word_t>(&row, 1), nbits));
   }
 }
 
@@ -138,30 +205,46 @@ size_t BitMatrix::row_weight(size_t j) const {
 }
 
 size_t BitMatrix::weight() const {
+  std::vector<size_t> partial(row_blocks());
+  for_row_blocks([&](size_t b, size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i)
+      partial[b] += m_matrix[i].weight();
+  });
   size_t total_weight = 0;
-  for (size_t i = 0; i < m_matrix.size(); ++i) {
-    total_weight += m_matrix[i].weight();
-  }
+  for (size_t w : partial)
+    total_weight += w;
   return total_weight;
 }
 
 BitVector BitMatrix::conjunction_rows() const {
   if (m_matrix.size() == 0)
     return BitVector(0, false);
-  BitVector result = m_matrix[0];
-  for (size_t i = 1; i < m_matrix.size(); ++i) {
-    result &= m_matrix[i];
-  }
+  std::vector<BitVector> partial(row_blocks());
+  for_row_blocks([&](size_t b, size_t first, size_t last) {
+    BitVector acc = m_matrix[first];
+    for (size_t i = first + 1; i < last; ++i)
+      acc &= m_matrix[i];
+    partial[b] = std::move(acc);
+  });
+  BitVector result = std::move(partial[0]);
+  for (size_t b = 1; b < partial.size(); ++b)
+    result &= partial[b];
   return result;
 }
 
 BitVector BitMatrix::disjunction_rows() const {
   if (m_matrix.size() == 0)
     return BitVector(0, false);
-  BitVector result = m_matrix[0];
-  for (size_t i = 1; i < m_matrix.size(); ++i) {
-    result |= m_matrix[i];
-  }
+  std::vector<BitVector> partial(row_blocks());
+  for_row_blocks([&](size_t b, size_t first, size_t last) {
+    BitVector acc = m_matrix[first];
+    for (size_t i = first + 1; i < last; ++i)
+      acc |= m_matrix[i];
+    partial[b] = std::move(acc);
+  });
+  BitVector result = std::move(partial[0]);
+  for (size_t b = 1; b < partial.size(); ++b)
+    result |= partial[b];
   return result;
 }
 
@@ -169,9 +252,7 @@ void BitMatrix::flip_range(size_t j, size_t i, size_t k) {
   check_row_index(j);
   if (i + k > columns())
     throw std::out_of_range("Range out of column bounds");
-  for (size_t pos = i; pos < i + k; ++pos) {
-    m_matrix[j].flip(pos);
-  }
+  m_matrix[j].flipRange(i, k);
 }
 
 void BitMatrix::set_range(size_t j, size_t i, size_t k, bool value) {
@@ -181,13 +262,61 @@ void BitMatrix::set_range(size_t j, size_t i, size_t k, bool value) {
   m_matrix[j].setRange(i, k, value);
 }
 
+template <class Cell>
+void BitMatrix::set_cells_of(std::span<const Cell> cells, bool value) {
+  // Check every cell and note the rows written, so only those are
+  // detached (shared rows stay shared). std::in_range also turns away
+  // negative int indices.
+  size_t cols = columns();
+  std::vector<char> touched(m_matrix.size(), 0);
+  for (const Cell &c : cells) {
+    if (!std::in_range<size_t>(c.first) ||
+        static_cast<size_t>(c.first) >= m_matrix.size())
+      throw std::out_of_range("Row index out of bounds");
+    if (!std::in_range<size_t>(c.second) ||
+        static_cast<size_t>(c.second) >= cols)
+      throw std::out_of_range("Column index out of bounds");
+    touched[static_cast<size_t>(c.first)] = 1;
+  }
+  // Word pointers of the touched rows, one flat array for the loop below
+  std::vector<word_t *> row_words(m_matrix.size(), nullptr);
+  for (size_t r = 0; r < m_matrix.size(); ++r) {
+    if (touched[r]) {
+      m_matrix[r].detach();
+      row_words[r] = m_matrix[r].data.get();
+    }
+  }
+  size_t n = cells.size();
+  for (size_t k = 0; k < n; ++k) {
+    if (k + PREFETCH_AHEAD < n) {
+      const Cell &ahead = cells[k + PREFETCH_AHEAD];
+      prefetch_write(row_words[static_cast<size_t>(ahead.first)] +
+                     static_cast<size_t>(ahead.second) / BITS_PER_WORD);
+    }
+    size_t row = static_cast<size_t>(cells[k].first);
+    size_t col = static_cast<size_t>(cells[k].second);
+    word_t *w = row_words[row] + col / BITS_PER_WORD;
+    word_t mask = word_t(1) << (col % BITS_PER_WORD);
+    *w = value ? *w | mask : *w & ~mask;
+  }
+}
+
+void BitMatrix::set_cells(std::span<const pair> cells, bool value) {
+  set_cells_of(cells, value);
+}
+
+void BitMatrix::set_cells(std::span<const std::pair<int, int>> cells,
+                          bool value) {
+  set_cells_of(cells, value);
+}
+
 // --- Bitwise overloads (row-wise) ---
 
 BitMatrix BitMatrix::operator&(const BitMatrix &rhs) const {
   return row_wise_op(rhs, '&');
 }
 BitMatrix &BitMatrix::operator&=(const BitMatrix &rhs) {
-  *this = row_wise_op(rhs, '&');
+  row_wise_assign(rhs, '&');
   return *this;
 }
 
@@ -195,7 +324,7 @@ BitMatrix BitMatrix::operator|(const BitMatrix &rhs) const {
   return row_wise_op(rhs, '|');
 }
 BitMatrix &BitMatrix::operator|=(const BitMatrix &rhs) {
-  *this = row_wise_op(rhs, '|');
+  row_wise_assign(rhs, '|');
   return *this;
 }
 
@@ -203,15 +332,16 @@ BitMatrix BitMatrix::operator^(const BitMatrix &rhs) const {
   return row_wise_op(rhs, '^');
 }
 BitMatrix &BitMatrix::operator^=(const BitMatrix &rhs) {
-  *this = row_wise_op(rhs, '^');
+  row_wise_assign(rhs, '^');
   return *this;
 }
 
+// flipAll only marks each copied row complemented, so on shareable rows
+// no words are written at all
 BitMatrix BitMatrix::operator~() const {
   BitMatrix result(*this);
-  for (size_t i = 0; i < result.m_matrix.size(); ++i) {
-    result.m_matrix[i] = ~result.m_matrix[i];
-  }
+  for (BitVector &row : result.m_matrix)
+    row.flipAll();
   return result;
 }
 
@@ -219,8 +349,7 @@ bool BitMatrix::operator==(const BitMatrix &other) const {
   if (m_matrix.size() != other.m_matrix.size() || columns() != other.columns())
     return false;
   for (size_t i = 0; i < m_matrix.size(); ++i) {
-    BitVector _other = other.m_matrix[i];
-    if (!(m_matrix[i] == _other))
+    if (!(m_matrix[i] == other.m_matrix[i]))
       return false;
   }
   return true;
@@ -241,6 +370,91 @@ std::vector<unsigned int> BitMatrix::to_vec() {
   return out;
 }
 
+// --- Copy-on-write ---
+void BitMatrix::make_shareable() {
+  for (size_t i = 0; i < m_matrix.size(); ++i)
+    m_matrix[i].make_shareable();
+}
+
+// --- Binary snapshots ---
+
+void BitMatrix::save(std::ostream &os) const {
+  if (columns() == 0 && rows() > 1)
+    throw std::invalid_argument("Rows without columns cannot be saved");
+  SnapshotHeader h;
+  h.rows = rows();
+  h.columns = columns();
+  // Complemented rows are written as read, through a scratch copy
+  std::vector<word_t> scratch;
+  SnapshotChecksum sum;
+  for (size_t i = 0; i < rows(); ++i)
+    sum.update(m_matrix[i].words(scratch), m_matrix[i].word_count());
+  h.checksum = sum.value();
+  write_snapshot_header(os, h);
+  for (size_t i = 0; i < rows(); ++i)
+    write_snapshot_words(os, m_matrix[i].words(scratch),
+                         m_matrix[i].word_count());
+}
+
+void BitMatrix::save(const std::string &path) const {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out)
+    throw std::runtime_error("Cannot open " + path);
+  save(out);
+  if (!out.flush())
+    throw std::runtime_error("Cannot write " + path);
+}
+
+// Rows are read into one reusable buffer and copied out as owned vectors
+BitMatrix BitMatrix::load(std::istream &is) {
+  SnapshotHeader h = read_snapshot_header(is);
+  BitMatrix out;
+  // Rows are only reserved once the stream is known to hold their words
+  if (check_snapshot_length(is, h.total_words()) && h.row_words() != 0)
+    out.m_matrix.reserve(h.rows);
+  std::vector<word_t> row;
+  SnapshotChecksum sum;
+  for (size_t i = 0; i < h.rows; ++i) {
+    read_snapshot_words_chunked(is, row, h.row_words(), h.foreign_order);
+    sum.update(row.data(), row.size());
+    BitVector borrowed = BitVector::borrow(row, h.columns);
+    out.m_matrix.push_back(borrowed);
+  }
+  if (sum.value() != h.checksum)
+    throw std::runtime_error("Snapshot checksum mismatch");
+  return out;
+}
+
+BitMatrix BitMatrix::load(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    throw std::runtime_error("Cannot open " + path);
+  return load(in);
+}
+
+BitMatrix BitMatrix::view(std::span<std::byte> snapshot, bool verify) {
+  SnapshotHeader h = parse_snapshot_header(snapshot);
+  if (h.foreign_order)
+    throw std::runtime_error("Snapshot words are not in host byte order");
+  size_t nwords = h.total_words();
+  if (snapshot.size() - SNAPSHOT_HEADER_BYTES < nwords * sizeof(word_t))
+    throw std::runtime_error("Truncated snapshot");
+  std::byte *first = snapshot.data() + SNAPSHOT_HEADER_BYTES;
+  if (reinterpret_cast<uintptr_t>(first) % alignof(word_t) != 0)
+    throw std::invalid_argument("Snapshot buffer is not 8-byte aligned");
+  auto *words = reinterpret_cast<word_t *>(first);
+  if (verify && snapshot_checksum(words, nwords) != h.checksum)
+    throw std::runtime_error("Snapshot checksum mismatch");
+
+  BitMatrix out;
+  out.m_matrix.reserve(h.rows);
+  size_t row_words = h.row_words();
+  for (size_t i = 0; i < h.rows; ++i)
+    out.m_matrix.push_back(BitVector::borrow(
+        std::span<word_t>(words + i * row_words, row_words), h.columns));
+  return out;
+}
+
 // --- Streaming I/O ---
 std::ostream &operator<<(std::ostream &os, const BitMatrix &bm) {
   if (bm.rows() == 0) {
@@ -296,7 +510,7 @@ std::istream &operator>>(std::istream &is, BitMatrix &bm) {
 
   bm = BitMatrix(rows, columns);
   for (size_t i = 0; i < rows; ++i) {
-    bm[i] = temp_matrix[i];
+    bm[i] = std::move(temp_matrix[i]);
   }
 
   return is;
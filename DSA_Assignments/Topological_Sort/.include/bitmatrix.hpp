@@ -39,9 +39,12 @@
 #pragma once
 
 #include <cstddef>
+#include <functional>
 #include <iostream>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "bitvector.hpp"
@@ -54,8 +57,21 @@ class BitMatrix {
   // Helper to check row index
   void check_row_index(size_t i) const;
 
-  // Helper for row-wise bitwise operations
+  // Helpers for row-wise bitwise operations
+  void check_same_dimensions(const BitMatrix &rhs) const;
   BitMatrix row_wise_op(const BitMatrix &rhs, char op) const;
+  void row_wise_assign(const BitMatrix &rhs, char op);
+
+  // Row blocks of about PARALLEL_GRAIN_WORDS words for the reductions;
+  // body(block, first, last) runs on the thread pool for large matrices
+  size_t rows_per_block() const;
+  size_t row_blocks() const;
+  void for_row_blocks(
+      const std::function<void(size_t, size_t, size_t)> &body) const;
+
+  // Both set_cells overloads (bitmatrix.cpp)
+  template <class Cell> void set_cells_of(std::span<const Cell> cells,
+                                          bool value);
 
 public:
   // --- Constructors / Destructor / Assignment ---
@@ -92,6 +108,15 @@ class BitMatrix {
   void flip_range(size_t j, size_t i, size_t k);
   void set_range(size_t j, size_t i, size_t k, bool value);
 
+  // set(row, column, value) for every (row, column) cell, e.g. an edge
+  // list. All cells are checked before any is written; see
+  // BitVector::set_bits for the prefetching.
+  void set_cells(std::span<const pair> cells, bool value = true);
+  // Same for an int edge list, read in place (a negative index is out of
+  // range like any other)
+  void set_cells(std::span<const std::pair<int, int>> cells,
+                 bool value = true);
+
   // --- Overloads: Bitwise (Row-wise) ---
   BitMatrix operator&(const BitMatrix &rhs) const;
   BitMatrix &operator&=(const BitMatrix &rhs);
@@ -109,6 +134,23 @@ class BitMatrix {
   bool operator!=(const BitMatrix &other) const;
 
   std::vector<unsigned int> to_vec();
+
+  // --- Copy-on-write ---
+  // Makes every row shareable (BitVector::make_shareable): copies of the
+  // matrix then cost O(rows), and only the rows written afterwards are
+  // duplicated.
+  void make_shareable();
+
+  // --- Binary snapshots (format in snapshot.hpp) ---
+  // save() throws std::invalid_argument for several rows of zero columns,
+  // which the format cannot bound
+  void save(std::ostream &os) const;
+  void save(const std::string &path) const;
+  static BitMatrix load(std::istream &is);
+  static BitMatrix load(const std::string &path);
+  // Zero-copy: every row borrows its words from the buffer (see
+  // BitVector::view), which must outlive the matrix. Copies are owned.
+  static BitMatrix view(std::span<std::byte> snapshot, bool verify = true);
 };
 
 // Streaming I/O
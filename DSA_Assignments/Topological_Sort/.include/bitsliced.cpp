@@ -0,0 +1,216 @@
+#include "bitsliced.hpp"
+#include "parallel.hpp"
+#include "popcount.hpp"
+
+#include <algorithm> // std::max_element, std::fill_n, std::copy_n
+#include <bit>
+#include <stdexcept>
+
+// -- block kernel --
+
+// Words per block: the lt / eq scratch of a block stays in L1 while every
+// slice is streamed through it in order
+static constexpr size_t BLOCK_WORDS = 256;
+
+// Compares the values of words [w, w + len) against c, 64 per word: lt gets
+// bit j where value j < c, eq where value j == c. s[b] are the words of
+// slice b.
+static void compare_block(const word_t *const *s, size_t width, size_t w,
+                          size_t len, uint64_t c, word_t *lt, word_t *eq) {
+  if (width < BitSlicedColumn::MAX_WIDTH && (c >> width) != 0) {
+    std::fill_n(lt, len, ~word_t(0)); // c needs more bits than any value
+    std::fill_n(eq, len, word_t(0));
+    return;
+  }
+  std::fill_n(lt, len, word_t(0));
+  std::fill_n(eq, len, ~word_t(0));
+  for (size_t b = width; b-- > 0;) {
+    const word_t *x = s[b] + w;
+    word_t left = 0; // values still equal to c on the bits seen so far
+    if ((c >> b) & 1) {
+      for (size_t k = 0; k < len; ++k) {
+        lt[k] |= eq[k] & ~x[k]; // equal so far, value has 0 where c has 1
+        eq[k] &= x[k];
+        left |= eq[k];
+      }
+    } else {
+      for (size_t k = 0; k < len; ++k) {
+        eq[k] &= ~x[k];
+        left |= eq[k];
+      }
+    }
+    if (left == 0)
+      return; // every value is decided; the lower slices cannot change lt
+  }
+}
+
+// Word pointers of every slice; scratch keeps copies of complemented ones
+static std::vector<const word_t *>
+slice_words(const std::vector<BitVector> &slices,
+            std::vector<std::vector<word_t>> &scratch) {
+  std::vector<const word_t *> s;
+  s.reserve(slices.size());
+  scratch.resize(slices.size());
+  for (size_t b = 0; b < slices.size(); ++b)
+    s.push_back(slices[b].words(scratch[b]));
+  return s;
+}
+
+// -- constructors --
+
+BitSlicedColumn::BitSlicedColumn(std::span<const uint64_t> values,
+                                 size_t width)
+    : n(values.size()) {
+  uint64_t top = values.empty() ? 0 : *std::max_element(values.begin(),
+                                                        values.end());
+  size_t needed = static_cast<size_t>(std::bit_width(top));
+  if (width == 0)
+    width = needed;
+  if (width > MAX_WIDTH || width < needed)
+    throw std::invalid_argument("Width does not fit the values");
+
+  size_t nwords = BitVector::words_for_bits(n);
+  std::vector<std::vector<word_t>> bits(width,
+                                        std::vector<word_t>(nwords, 0));
+  for (size_t i = 0; i < n; ++i) {
+    word_t mask = word_t(1) << (i % BITS_PER_WORD);
+    for (uint64_t v = values[i]; v != 0; v &= v - 1)
+      bits[static_cast<size_t>(std::countr_zero(v))][i / BITS_PER_WORD] |=
+          mask;
+  }
+  slices.reserve(width);
+  for (const std::vector<word_t> &words : bits)
+    slices.push_back(BitVector::from_words(words, n));
+}
+
+BitSlicedColumn::BitSlicedColumn(const std::vector<unsigned> &values)
+    : BitSlicedColumn(std::vector<uint64_t>(values.begin(), values.end())) {}
+
+// -- access --
+
+size_t BitSlicedColumn::size() const noexcept { return n; }
+
+size_t BitSlicedColumn::width() const noexcept { return slices.size(); }
+
+const BitVector &BitSlicedColumn::slice(size_t b) const {
+  if (b >= slices.size())
+    throw std::out_of_range("Index");
+  return slices[b];
+}
+
+uint64_t BitSlicedColumn::value(size_t i) const {
+  if (i >= n)
+    throw std::out_of_range("Index");
+  uint64_t v = 0;
+  for (size_t b = 0; b < slices.size(); ++b)
+    v |= uint64_t(slices[b].get(i)) << b;
+  return v;
+}
+
+std::vector<uint64_t> BitSlicedColumn::values() const {
+  std::vector<uint64_t> out(n, 0);
+  for (size_t b = 0; b < slices.size(); ++b)
+    slices[b].for_each_set_bit([&](size_t i) { out[i] |= uint64_t(1) << b; });
+  return out;
+}
+
+// -- predicates --
+
+BitVector BitSlicedColumn::evaluate(Predicate p, uint64_t a,
+                                    uint64_t b) const {
+  std::vector<std::vector<word_t>> scratch;
+  std::vector<const word_t *> s = slice_words(slices, scratch);
+  size_t width = slices.size();
+  size_t nwords = BitVector::words_for_bits(n);
+  std::vector<word_t> out(nwords);
+  parallel_words(nwords, [&](size_t begin, size_t end) {
+    word_t lt[BLOCK_WORDS], eq[BLOCK_WORDS];
+    for (size_t w = begin; w < end; w += BLOCK_WORDS) {
+      size_t len = std::min(BLOCK_WORDS, end - w);
+      compare_block(s.data(), width, w, len, a, lt, eq);
+      if (p == Predicate::Less) {
+        std::copy_n(lt, len, out.data() + w);
+      } else if (p == Predicate::Equal) {
+        std::copy_n(eq, len, out.data() + w);
+      } else {
+        std::copy_n(lt, len, out.data() + w); // below a
+        compare_block(s.data(), width, w, len, b, lt, eq);
+        for (size_t k = 0; k < len; ++k)
+          out[w + k] = lt[k] & ~out[w + k]; // below b, not below a
+      }
+    }
+  });
+  return BitVector::from_words(out, n);
+}
+
+BitVector BitSlicedColumn::equal(uint64_t c) const {
+  return evaluate(Predicate::Equal, c, 0);
+}
+
+BitVector BitSlicedColumn::not_equal(uint64_t c) const {
+  return ~equal(c);
+}
+
+BitVector BitSlicedColumn::less(uint64_t c) const {
+  return evaluate(Predicate::Less, c, 0);
+}
+
+BitVector BitSlicedColumn::less_equal(uint64_t c) const {
+  if (c == UINT64_MAX)
+    return BitVector(n, true);
+  return less(c + 1);
+}
+
+BitVector BitSlicedColumn::greater(uint64_t c) const {
+  return ~less_equal(c);
+}
+
+BitVector BitSlicedColumn::greater_equal(uint64_t c) const {
+  return ~less(c);
+}
+
+BitVector BitSlicedColumn::between(uint64_t lo, uint64_t hi) const {
+  return evaluate(Predicate::Between, lo, hi);
+}
+
+// -- aggregates --
+
+void BitSlicedColumn::check_mask(const BitVector &mask) const {
+  if (mask.size() != n)
+    throw std::invalid_argument("Mask size differs from the column");
+}
+
+uint64_t BitSlicedColumn::sum(const BitVector &mask) const {
+  check_mask(mask);
+  std::vector<std::vector<word_t>> scratch;
+  std::vector<const word_t *> s = slice_words(slices, scratch);
+  std::vector<word_t> mask_scratch;
+  const word_t *m = mask.words(mask_scratch);
+  // sum of 2^b * |slice b & mask|; size_t arithmetic wraps like uint64_t
+  return parallel_sum_words(
+      BitVector::words_for_bits(n), [&](size_t begin, size_t end) {
+        word_t masked[BLOCK_WORDS];
+        size_t acc = 0;
+        for (size_t w = begin; w < end; w += BLOCK_WORDS) {
+          size_t len = std::min(BLOCK_WORDS, end - w);
+          for (size_t b = 0; b < s.size(); ++b) {
+            for (size_t k = 0; k < len; ++k)
+              masked[k] = s[b][w + k] & m[w + k];
+            acc += popcount_words(masked, len) << b;
+          }
+        }
+        return acc;
+      });
+}
+
+size_t BitSlicedColumn::count(const BitVector &mask) const {
+  check_mask(mask);
+  return mask.weight();
+}
+
+uint64_t BitSlicedColumn::sum() const {
+  uint64_t acc = 0;
+  for (size_t b = 0; b < slices.size(); ++b)
+    acc += uint64_t(slices[b].weight()) << b;
+  return acc;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+// Bit-sliced column of unsigned integers: the transpose of the layout
+// BitMatrix(const std::vector<unsigned> &) builds. Slice b is a BitVector
+// holding bit b of every value, so value i is spread over bit i of each
+// slice. Predicates walk the slices from the most significant one down and
+// decide 64 values per word operation; they return a mask with bit i set
+// where value i matches, which sum() and count() then aggregate.
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "bitvector.hpp"
+
+class BitSlicedColumn {
+public:
+  static constexpr size_t MAX_WIDTH = 64;
+
+  // Constructors. width 0 picks the bit width of the largest value; an
+  // explicit width must hold every value (std::invalid_argument otherwise).
+  BitSlicedColumn() = default;
+  explicit BitSlicedColumn(std::span<const uint64_t> values, size_t width = 0);
+  explicit BitSlicedColumn(const std::vector<unsigned> &values);
+
+  // number of values / number of slices
+  size_t size() const noexcept;
+  size_t width() const noexcept;
+
+  // bit b of every value
+  const BitVector &slice(size_t b) const;
+  // value i, reassembled from the slices
+  uint64_t value(size_t i) const;
+  std::vector<uint64_t> values() const;
+
+  // -- predicates (mask of size() bits) --
+  BitVector equal(uint64_t c) const;          // x == c
+  BitVector not_equal(uint64_t c) const;      // x != c
+  BitVector less(uint64_t c) const;           // x < c
+  BitVector less_equal(uint64_t c) const;     // x <= c
+  BitVector greater(uint64_t c) const;        // x > c
+  BitVector greater_equal(uint64_t c) const;  // x >= c
+  BitVector between(uint64_t lo, uint64_t hi) const; // lo <= x < hi
+
+  // -- aggregates over a mask of size() bits (std::invalid_argument) --
+  // sum wraps modulo 2^64
+  uint64_t sum(const BitVector &mask) const;
+  size_t count(const BitVector &mask) const;
+  uint64_t sum() const;
+
+private:
+  enum class Predicate { Less, Equal, Between };
+
+  BitVector evaluate(Predicate p, uint64_t a, uint64_t b) const;
+  void check_mask(const BitVector &mask) const;
+
+  size_t n = 0;
+  std::vector<BitVector> slices; // slices[b] holds bit b
+};
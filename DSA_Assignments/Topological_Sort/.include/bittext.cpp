@@ -0,0 +1,183 @@
+#include "bittext.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // std::strcmp
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) &&                              \
+    (defined(__x86_64__) || defined(__i386__))
+#define BITTEXT_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using parse_fn = bool (*)(const char *, size_t, uint64_t *);
+using format_fn = void (*)(const uint64_t *, size_t, char *);
+
+// -- portable fallback --
+// '0' ^ '0' == 0 and '1' ^ '0' == 1; any other character leaves a bit above
+// bit 0, which is collected in bad.
+
+bool parse_generic(const char *text, size_t n, uint64_t *words) {
+  uint64_t bad = 0;
+  for (size_t w = 0; w * 64 < n; ++w) {
+    size_t count = n - w * 64 < 64 ? n - w * 64 : 64;
+    const unsigned char *p =
+        reinterpret_cast<const unsigned char *>(text) + w * 64;
+    uint64_t word = 0;
+    for (size_t j = 0; j < count; ++j) {
+      uint64_t d = p[j] ^ uint64_t('0');
+      bad |= d;
+      word |= (d & 1u) << j;
+    }
+    words[w] = word;
+  }
+  return (bad & ~uint64_t(1)) == 0;
+}
+
+void format_generic(const uint64_t *words, size_t n, char *out) {
+  for (size_t i = 0; i < n; ++i)
+    out[i] = static_cast<char>('0' + ((words[i / 64] >> (i % 64)) & 1u));
+}
+
+#ifdef BITTEXT_X86
+
+// -- AVX2: 32 characters per compare --
+// A character is valid iff (c | 1) == '1'; movemask of c == '1' gives the
+// bits. Bits are expanded by giving each byte its source byte and testing
+// one bit per lane.
+
+__attribute__((target("avx2"))) bool
+parse_avx2(const char *text, size_t n, uint64_t *words) {
+  const __m256i one = _mm256_set1_epi8('1');
+  const __m256i low = _mm256_set1_epi8(1);
+  size_t full = n / 64;
+  for (size_t w = 0; w < full; ++w) {
+    const __m256i *p = reinterpret_cast<const __m256i *>(text + w * 64);
+    __m256i a = _mm256_loadu_si256(p);
+    __m256i b = _mm256_loadu_si256(p + 1);
+    __m256i ok = _mm256_and_si256(
+        _mm256_cmpeq_epi8(_mm256_or_si256(a, low), one),
+        _mm256_cmpeq_epi8(_mm256_or_si256(b, low), one));
+    if (static_cast<uint32_t>(_mm256_movemask_epi8(ok)) != 0xffffffffu)
+      return false;
+    uint64_t lo = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, one)));
+    uint64_t hi = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(b, one)));
+    words[w] = lo | (hi << 32);
+  }
+  if (n % 64 != 0)
+    return parse_generic(text + full * 64, n % 64, words + full);
+  return true;
+}
+
+__attribute__((target("avx2"))) void
+format_avx2(const uint64_t *words, size_t n, char *out) {
+  // Lane bytes 0-7 read source byte 0, 8-15 byte 1 (2 and 3 in the high
+  // lane), then each byte keeps the one bit it stands for
+  const __m256i spread =
+      _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2,
+                       2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+  const __m256i select = _mm256_set1_epi64x(
+      static_cast<long long>(0x8040201008040201ull));
+  const __m256i zero_char = _mm256_set1_epi8('0');
+  size_t full = n / 32;
+  for (size_t k = 0; k < full; ++k) {
+    uint32_t bits = static_cast<uint32_t>(words[k / 2] >> (k % 2 * 32));
+    __m256i v = _mm256_shuffle_epi8(
+        _mm256_set1_epi32(static_cast<int>(bits)), spread);
+    __m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(v, select), select);
+    // set lanes are -1, so '0' - set is '1' there
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + k * 32),
+                        _mm256_sub_epi8(zero_char, set));
+  }
+  for (size_t i = full * 32; i < n; ++i)
+    out[i] = static_cast<char>('0' + ((words[i / 64] >> (i % 64)) & 1u));
+}
+
+// -- AVX-512BW: 64 characters per compare, masked tail --
+
+__attribute__((target("avx512f,avx512bw"))) bool
+parse_avx512(const char *text, size_t n, uint64_t *words) {
+  const __m512i one = _mm512_set1_epi8('1');
+  const __m512i low = _mm512_set1_epi8(1);
+  for (size_t w = 0; w * 64 < n; ++w) {
+    size_t count = n - w * 64 < 64 ? n - w * 64 : 64;
+    __mmask64 k = count == 64 ? ~__mmask64(0) : (__mmask64(1) << count) - 1;
+    __m512i v = _mm512_maskz_loadu_epi8(k, text + w * 64);
+    __mmask64 ok =
+        _mm512_mask_cmpeq_epi8_mask(k, _mm512_or_si512(v, low), one);
+    if (ok != k)
+      return false;
+    words[w] = _mm512_mask_cmpeq_epi8_mask(k, v, one);
+  }
+  return true;
+}
+
+__attribute__((target("avx512f,avx512bw"))) void
+format_avx512(const uint64_t *words, size_t n, char *out) {
+  const __m512i zero_char = _mm512_set1_epi8('0');
+  const __m512i one_char = _mm512_set1_epi8('1');
+  for (size_t w = 0; w * 64 < n; ++w) {
+    size_t count = n - w * 64 < 64 ? n - w * 64 : 64;
+    __mmask64 k = count == 64 ? ~__mmask64(0) : (__mmask64(1) << count) - 1;
+    __m512i v = _mm512_mask_blend_epi8(words[w], zero_char, one_char);
+    _mm512_mask_storeu_epi8(out + w * 64, k, v);
+  }
+}
+
+#endif // BITTEXT_X86
+
+struct Kernel {
+  parse_fn parse;
+  format_fn format;
+  const char *name;
+};
+
+// The kernels this CPU can run, best first
+std::vector<Kernel> usable_kernels() {
+  std::vector<Kernel> out;
+#ifdef BITTEXT_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512bw"))
+    out.push_back({parse_avx512, format_avx512, "avx512"});
+  if (__builtin_cpu_supports("avx2"))
+    out.push_back({parse_avx2, format_avx2, "avx2"});
+#endif
+  out.push_back({parse_generic, format_generic, "generic"});
+  return out;
+}
+
+Kernel &kernel() {
+  static Kernel k = usable_kernels().front(); // thread-safe one-time dispatch
+  return k;
+}
+
+} // namespace
+
+bool parse_bits(const char *text, size_t n, uint64_t *words) {
+  // Short strings skip the dispatch
+  if (n < 64)
+    return parse_generic(text, n, words);
+  return kernel().parse(text, n, words);
+}
+
+void format_bits(const uint64_t *words, size_t n, char *out) {
+  if (n < 64)
+    return format_generic(words, n, out);
+  kernel().format(words, n, out);
+}
+
+const char *bittext_kernel() { return kernel().name; }
+
+bool bittext_use_kernel(const char *name) {
+  for (const Kernel &k : usable_kernels())
+    if (std::strcmp(k.name, name) == 0) {
+      kernel() = k;
+      return true;
+    }
+  return false;
+}
@@ -1,20 +1,138 @@
 #include "bitvector.hpp"
+#include "bithash.hpp"
+#include "bittext.hpp"
+#include "parallel.hpp"
+#include "popcount.hpp"
+#include "prefetch.hpp"
+#include "snapshot.hpp"
 
-#include <algorithm> // std::max, std::fill_n
+#include <algorithm> // std::min, std::fill_n
 #include <bit>
 #include <bitset>
 #include <climits>
 #include <cstddef>
 #include <cstring> // std::memcpy, std::strlen
+#include <fstream>
 #include <iostream>
+#include <new> // std::align_val_t
 #include <stdexcept>
 #include <string>
 
-// -- static helper --
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BITVECTOR_HAS_MMAP 1
+#else
+#define BITVECTOR_HAS_MMAP 0
+#endif
+
+// -- static helpers --
 size_t BitVector::bytes_for_bits(size_t bits) {
   return (bits + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
 }
 
+size_t BitVector::words_for_bits(size_t bits) {
+  return (bits + BITS_PER_WORD - 1) / BITS_PER_WORD;
+}
+
+// -- word storage --
+BitVector::WordStorage::WordStorage(size_t nwords) {
+  void *raw = ::operator new[](nwords * sizeof(word_t),
+                               std::align_val_t{WORD_ALIGNMENT});
+  ptr = static_cast<word_t *>(raw);
+}
+
+BitVector::WordStorage
+BitVector::WordStorage::borrowed(word_t *words) noexcept {
+  WordStorage s;
+  s.ptr = words;
+  s.owner = Kind::Borrowed;
+  return s;
+}
+
+BitVector::WordStorage BitVector::WordStorage::mapped(word_t *words,
+                                                      size_t bytes) noexcept {
+  WordStorage s;
+  s.ptr = words;
+  s.map_bytes = bytes;
+  s.owner = Kind::Mapped;
+  return s;
+}
+
+BitVector::WordStorage BitVector::WordStorage::shared(size_t nwords) {
+  // The count takes the cache line before the words, which keeps them
+  // aligned like an owned block
+  void *raw = ::operator new[](WORD_ALIGNMENT + nwords * sizeof(word_t),
+                               std::align_val_t{WORD_ALIGNMENT});
+  new (raw) std::atomic<size_t>(1);
+  WordStorage s;
+  s.ptr = reinterpret_cast<word_t *>(static_cast<std::byte *>(raw) +
+                                     WORD_ALIGNMENT);
+  s.owner = Kind::Shared;
+  return s;
+}
+
+BitVector::WordStorage BitVector::WordStorage::share() const noexcept {
+  refs().fetch_add(1, std::memory_order_relaxed);
+  WordStorage s;
+  s.ptr = ptr;
+  s.owner = Kind::Shared;
+  return s;
+}
+
+BitVector::WordStorage::WordStorage(WordStorage &&other) noexcept
+    : ptr(std::exchange(other.ptr, nullptr)),
+      map_bytes(std::exchange(other.map_bytes, 0)),
+      owner(std::exchange(other.owner, Kind::Owned)) {}
+
+BitVector::WordStorage &
+BitVector::WordStorage::operator=(WordStorage &&other) noexcept {
+  if (this != &other) {
+    reset();
+    ptr = std::exchange(other.ptr, nullptr);
+    map_bytes = std::exchange(other.map_bytes, 0);
+    owner = std::exchange(other.owner, Kind::Owned);
+  }
+  return *this;
+}
+
+BitVector::WordStorage::~WordStorage() { reset(); }
+
+void BitVector::WordStorage::swap(WordStorage &other) noexcept {
+  std::swap(ptr, other.ptr);
+  std::swap(map_bytes, other.map_bytes);
+  std::swap(owner, other.owner);
+}
+
+void BitVector::WordStorage::reset() noexcept {
+  if (ptr) {
+    switch (owner) {
+    case Kind::Owned:
+      ::operator delete[](ptr, std::align_val_t{WORD_ALIGNMENT});
+      break;
+    case Kind::Mapped:
+#if BITVECTOR_HAS_MMAP
+      ::munmap(ptr, map_bytes);
+#endif
+      break;
+    case Kind::Borrowed:
+      break;
+    case Kind::Shared:
+      if (refs().fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        void *raw = reinterpret_cast<std::byte *>(ptr) - WORD_ALIGNMENT;
+        refs().~atomic();
+        ::operator delete[](raw, std::align_val_t{WORD_ALIGNMENT});
+      }
+      break;
+    }
+  }
+  ptr = nullptr;
+  map_bytes = 0;
+  owner = Kind::Owned;
+}
+
 // -- last_byte_mask --
 byte_t BitVector::last_byte_mask() const {
   size_t rem = nbits % BITS_PER_BYTE;
@@ -23,6 +141,19 @@ byte_t BitVector::last_byte_mask() const {
   return static_cast<byte_t>((1u << rem) - 1u);
 }
 
+// -- last_word_mask --
+word_t BitVector::last_word_mask() const {
+  size_t rem = nbits % BITS_PER_WORD;
+  if (rem == 0)
+    return ~word_t(0);
+  return (word_t(1) << rem) - 1;
+}
+
+void BitVector::clear_tail() noexcept {
+  if (nbits % BITS_PER_WORD != 0)
+    data[words_for_bits(nbits) - 1] &= last_word_mask();
+}
+
 // -- check_index --
 void BitVector::check_index(size_t i) const {
   if (i >= nbits)
@@ -31,20 +162,20 @@ void BitVector::check_index(size_t i) const {
 
 // -- coord --
 pair BitVector::coord(size_t i) const {
-  size_t b = i / BITS_PER_BYTE;
-  size_t off = i % BITS_PER_BYTE;
-  return {b, off};
+  size_t w = i / BITS_PER_WORD;
+  size_t off = i % BITS_PER_WORD;
+  return {w, off};
 }
 
 // -- constructors / assignment --
 
 BitVector::BitVector(size_t size, bool value) : nbits(size) {
-  size_t nbytes = bytes_for_bits(size);
-  if (nbytes) {
-    data = std::make_unique<byte_t[]>(nbytes);
-    std::fill_n(data.get(), nbytes, value ? byte_t(0xFF) : byte_t(0x00));
-    if (value && (nbits % BITS_PER_BYTE != 0))
-      data[nbytes - 1] &= last_byte_mask();
+  size_t nwords = words_for_bits(size);
+  if (nwords) {
+    data = WordStorage(nwords);
+    std::fill_n(data.get(), nwords, value ? ~word_t(0) : word_t(0));
+    if (value)
+      clear_tail();
   }
 }
 
@@ -52,41 +183,56 @@ BitVector::BitVector(const char *bitstr) {
   if (!bitstr)
     throw std::invalid_argument("Null string");
   nbits = std::strlen(bitstr);
-  size_t nbytes = bytes_for_bits(nbits);
-  if (nbytes) {
-    data = std::make_unique<byte_t[]>(nbytes);
-    std::fill_n(data.get(), nbytes, byte_t(0x00));
-    for (size_t i = 0; i < nbits; ++i) {
-      char c = bitstr[i];
-      if (c != '0' && c != '1')
-        throw std::invalid_argument("Bit string must be '0' or '1'");
-      if (c == '1')
-        data[i / BITS_PER_BYTE] |=
-            static_cast<byte_t>(1u << (i % BITS_PER_BYTE));
-    }
+  size_t nwords = words_for_bits(nbits);
+  if (nwords) {
+    data = WordStorage(nwords);
+    if (!parse_bits(bitstr, nbits, data.get()))
+      throw std::invalid_argument("Bit string must be '0' or '1'");
   }
 }
 
-BitVector::BitVector(const BitVector &other) : nbits(other.nbits) {
-  size_t nbytes = bytes_for_bits(nbits);
-  if (nbytes) {
-    data = std::make_unique<byte_t[]>(nbytes);
-    std::memcpy(data.get(), other.data.get(), nbytes);
+BitVector::BitVector(const BitVector &other)
+    : nbits(other.nbits), inverted(other.inverted),
+      hash_cache(other.hash_cache) {
+  size_t nwords = words_for_bits(nbits);
+  if (other.data.kind() == WordStorage::Kind::Shared) {
+    data = other.data.share();
+  } else if (nwords) {
+    data = WordStorage(nwords);
+    std::memcpy(data.get(), other.data.get(), nwords * sizeof(word_t));
   }
 }
 
 BitVector &BitVector::operator=(const BitVector &other) {
   if (this == &other)
     return *this;
-  size_t nbytes = bytes_for_bits(other.nbits);
-  if (nbytes) {
-    auto tmp = std::unique_ptr<byte_t[]>(new byte_t[nbytes]);
-    std::memcpy(tmp.get(), other.data.get(), nbytes);
-    data.swap(tmp);
+  drop_caches();
+  size_t nwords = words_for_bits(other.nbits);
+  // Borrowed or mapped words are overwritten in place, whatever the source's
+  // storage; only a different word count switches them to owned words
+  if (foreign_words() && nwords == words_for_bits(nbits)) {
+    if (nwords)
+      std::memcpy(data.get(), other.data.get(), nwords * sizeof(word_t));
+  } else if (other.data.kind() == WordStorage::Kind::Shared) {
+    data = other.data.share();
+  } else if (nwords) {
+    // Reuse the buffer when the word count already matches and no other
+    // vector reads it
+    if (nwords != words_for_bits(nbits) || !data || !data.exclusive()) {
+      WordStorage tmp = fresh_words(nwords);
+      data.swap(tmp);
+    }
+    std::memcpy(data.get(), other.data.get(), nwords * sizeof(word_t));
   } else {
     data.reset();
   }
   nbits = other.nbits;
+  inverted = other.inverted;
+  hash_cache = other.hash_cache;
+  // The copied words may be the complement; words someone else owns must
+  // hold the bits as read
+  if (foreign_words())
+    materialize();
   return *this;
 }
 
@@ -94,6 +240,9 @@ BitVector &BitVector::operator=(const BitVector &other) {
 void BitVector::swap(BitVector &other) noexcept {
   data.swap(other.data);
   std::swap(nbits, other.nbits);
+  std::swap(inverted, other.inverted);
+  rank_index.swap(other.rank_index);
+  hash_cache.swap(other.hash_cache);
 }
 void swap(BitVector &a, BitVector &b) noexcept { a.swap(b); }
 
@@ -133,61 +282,280 @@ int BitVector::value() const {
 bool BitVector::get(size_t i) const {
   check_index(i);
   pair position = coord(i);
-  return (data[position.first] >> position.second) & 1u;
+  return ((data[position.first] >> position.second) & 1u) != inverted;
 }
 
 void BitVector::set(size_t i, bool value) {
-  check_index(i);
+  check_index(i); // before detach(), so a bad index changes nothing
+  detach();
   pair b = coord(i);
-  byte_t mask = static_cast<byte_t>(1u << b.second);
+  word_t mask = word_t(1) << b.second;
   if (value)
     data[b.first] |= mask;
   else
-    data[b.first] &= static_cast<byte_t>(~mask);
+    data[b.first] &= ~mask;
 }
 
 void BitVector::flip(size_t i) {
   check_index(i);
+  detach();
   pair b = coord(i);
-  data[b.first] ^= static_cast<byte_t>(1u << b.second);
+  data[b.first] ^= word_t(1) << b.second;
 }
 
 void BitVector::flipAll() {
-  size_t nbytes = bytes_for_bits(nbits);
-  for (size_t i = 0; i < nbytes; ++i)
-    data[i] = static_cast<byte_t>(~data[i]);
-  if (nbytes && (nbits % BITS_PER_BYTE != 0))
-    data[nbytes - 1] &= last_byte_mask();
+  drop_caches();
+  inverted = !inverted;
+  // Words someone else owns must show the change now
+  if (foreign_words())
+    materialize();
+}
+
+bool BitVector::complement_pending() const noexcept { return inverted; }
+
+void BitVector::materialize() {
+  if (!inverted)
+    return;
+  size_t nwords = words_for_bits(nbits);
+  // Shared words are complemented into a private buffer, no copy first
+  WordStorage fresh;
+  const word_t *src = data.get();
+  word_t *dst = data.get();
+  if (!data.exclusive()) {
+    fresh = WordStorage::shared(nwords);
+    dst = fresh.get();
+  }
+  parallel_words(nwords, [&](size_t b, size_t e) {
+    for (size_t i = b; i < e; ++i)
+      dst[i] = ~src[i];
+  });
+  if (dst != data.get())
+    data.swap(fresh);
+  inverted = false;
+  if (nwords)
+    data[nwords - 1] &= last_word_mask();
 }
 
 // -- ranges and setAll --
+// Only the partial head and tail words are masked; the words in between are
+// written whole.
+
+// Mask of the bits of word w that fall inside [from, to), with from < to
+static word_t range_word_mask(size_t w, size_t from, size_t to) {
+  word_t mask = ~word_t(0);
+  if (w == from / BITS_PER_WORD)
+    mask &= ~word_t(0) << (from % BITS_PER_WORD);
+  if (w == (to - 1) / BITS_PER_WORD)
+    mask &= ~word_t(0) >> (BITS_PER_WORD - 1 - (to - 1) % BITS_PER_WORD);
+  return mask;
+}
+
 void BitVector::setRange(size_t i, size_t k, bool value) {
   if (k == 0)
     return;
-  if (i + k > nbits)
+  if (i > nbits || k > nbits - i)
+    throw std::out_of_range("Range out of bounds");
+  detach();
+  size_t first = i / BITS_PER_WORD;
+  size_t last = (i + k - 1) / BITS_PER_WORD;
+  word_t head = range_word_mask(first, i, i + k);
+  word_t tail = range_word_mask(last, i, i + k);
+  data[first] = value ? data[first] | head : data[first] & ~head;
+  if (first == last)
+    return;
+  std::fill_n(data.get() + first + 1, last - first - 1,
+              value ? ~word_t(0) : word_t(0));
+  data[last] = value ? data[last] | tail : data[last] & ~tail;
+}
+
+void BitVector::flipRange(size_t i, size_t k) {
+  if (k == 0)
+    return;
+  if (i > nbits || k > nbits - i)
     throw std::out_of_range("Range out of bounds");
-  for (size_t pos = i; pos < i + k; ++pos)
-    set(pos, value);
+  detach();
+  size_t first = i / BITS_PER_WORD;
+  size_t last = (i + k - 1) / BITS_PER_WORD;
+  data[first] ^= range_word_mask(first, i, i + k);
+  if (first == last)
+    return;
+  for (size_t w = first + 1; w < last; ++w)
+    data[w] = ~data[w];
+  data[last] ^= range_word_mask(last, i, i + k);
 }
 
 void BitVector::setAll(bool value) {
-  size_t nbytes = bytes_for_bits(nbits);
-  if (nbytes == 0)
+  inverted = false; // every word is overwritten
+  detach();
+  size_t nwords = words_for_bits(nbits);
+  if (nwords == 0)
     return;
-  for (size_t pos = 0; pos < nbits; ++pos)
-    set(pos, value);
-  if (value && (nbits % BITS_PER_BYTE != 0))
-    data[nbytes - 1] &= last_byte_mask();
+  std::fill_n(data.get(), nwords, value ? ~word_t(0) : word_t(0));
+  if (value)
+    clear_tail();
 }
 
 // -- weight --
+// A pending complement turns the stored count c of n bits into n - c
 size_t BitVector::weight() const {
-  size_t cnt = 0;
-  for (size_t i = 0; i < nbits; ++i) {
-    if (get(i))
-      ++cnt;
+  size_t cnt =
+      parallel_sum_words(words_for_bits(nbits), [&](size_t b, size_t e) {
+        return popcount_words(data.get() + b, e - b);
+      });
+  return inverted ? nbits - cnt : cnt;
+}
+
+size_t BitVector::weight(size_t from, size_t to) const {
+  if (from > to || to > nbits)
+    throw std::out_of_range("Range out of bounds");
+  if (from == to)
+    return 0;
+  size_t first = from / BITS_PER_WORD;
+  size_t last = (to - 1) / BITS_PER_WORD;
+  word_t head = ~word_t(0) << (from % BITS_PER_WORD);
+  word_t tail = ~word_t(0) >> (BITS_PER_WORD - 1 - (to - 1) % BITS_PER_WORD);
+  size_t cnt;
+  if (first == last) {
+    cnt = static_cast<size_t>(std::popcount(data[first] & head & tail));
+  } else {
+    cnt = static_cast<size_t>(std::popcount(data[first] & head));
+    cnt += popcount_words(data.get() + first + 1, last - first - 1);
+    cnt += static_cast<size_t>(std::popcount(data[last] & tail));
+  }
+  return inverted ? (to - from) - cnt : cnt;
+}
+
+// -- set-bit search --
+// Skip whole zero words, then count trailing/leading zeros inside the word.
+
+size_t BitVector::find_first() const noexcept {
+  size_t nwords = words_for_bits(nbits);
+  for (size_t w = 0; w < nwords; ++w)
+    if (word_t word = word_at(w))
+      return w * BITS_PER_WORD + static_cast<size_t>(std::countr_zero(word));
+  return npos;
+}
+
+size_t BitVector::find_next(size_t i) const noexcept {
+  if (i == npos || i + 1 >= nbits)
+    return npos;
+  size_t j = i + 1;
+  size_t nwords = words_for_bits(nbits);
+  size_t w = j / BITS_PER_WORD;
+  word_t word = word_at(w) & (~word_t(0) << (j % BITS_PER_WORD));
+  while (true) {
+    if (word)
+      return w * BITS_PER_WORD + static_cast<size_t>(std::countr_zero(word));
+    if (++w >= nwords)
+      return npos;
+    word = word_at(w);
+  }
+}
+
+size_t BitVector::find_last() const noexcept { return find_prev(nbits); }
+
+size_t BitVector::find_prev(size_t i) const noexcept {
+  if (i == 0 || nbits == 0)
+    return npos;
+  size_t j = std::min(i, nbits) - 1;
+  size_t w = j / BITS_PER_WORD;
+  word_t word =
+      word_at(w) & (~word_t(0) >> (BITS_PER_WORD - 1 - j % BITS_PER_WORD));
+  while (true) {
+    if (word)
+      return w * BITS_PER_WORD + BITS_PER_WORD - 1 -
+             static_cast<size_t>(std::countl_zero(word));
+    if (w == 0)
+      return npos;
+    word = word_at(--w);
+  }
+}
+
+// -- index batches --
+
+// Largest index, checked once instead of per element
+static void check_indices(std::span<const size_t> indices, size_t nbits) {
+  size_t top = 0;
+  for (size_t i : indices)
+    top = std::max(top, i);
+  if (!indices.empty() && top >= nbits)
+    throw std::out_of_range("Index");
+}
+
+void BitVector::set_bits(std::span<const size_t> indices, bool value) {
+  check_indices(indices, nbits);
+  if (indices.empty())
+    return;
+  detach();
+  word_t *w = data.get();
+  size_t n = indices.size();
+  for (size_t k = 0; k < n; ++k) {
+    if (k + PREFETCH_AHEAD < n)
+      prefetch_write(w + indices[k + PREFETCH_AHEAD] / BITS_PER_WORD);
+    word_t mask = word_t(1) << (indices[k] % BITS_PER_WORD);
+    if (value)
+      w[indices[k] / BITS_PER_WORD] |= mask;
+    else
+      w[indices[k] / BITS_PER_WORD] &= ~mask;
+  }
+}
+
+void BitVector::test_bits(std::span<const size_t> indices,
+                          BitVector &out) const {
+  check_indices(indices, nbits);
+  BitVector found(indices.size());
+  const word_t *w = data.get();
+  size_t n = indices.size();
+  // Answers are packed 64 at a time; the pending complement is applied to
+  // each packed word
+  for (size_t base = 0; base < n; base += BITS_PER_WORD) {
+    size_t len = std::min(BITS_PER_WORD, n - base);
+    word_t hits = 0;
+    for (size_t k = base; k < base + len; ++k) {
+      if (k + PREFETCH_AHEAD < n)
+        prefetch_read(w + indices[k + PREFETCH_AHEAD] / BITS_PER_WORD);
+      size_t i = indices[k];
+      hits |= ((w[i / BITS_PER_WORD] >> (i % BITS_PER_WORD)) & 1u)
+              << (k - base);
+    }
+    found.data[base / BITS_PER_WORD] = hits ^ flip_mask();
   }
-  return cnt;
+  if (n)
+    found.clear_tail();
+  out = std::move(found);
+}
+
+// -- rank/select --
+
+void BitVector::build_rank_select() {
+  materialize(); // the index counts the stored words
+  rank_index = std::make_unique<RankSelect>(data.get(), words_for_bits(nbits));
+}
+
+bool BitVector::has_rank_select() const noexcept {
+  return rank_index != nullptr;
+}
+
+size_t BitVector::rank1(size_t i) const {
+  if (i > nbits)
+    throw std::out_of_range("Index");
+  if (rank_index)
+    return rank_index->rank1(data.get(), i);
+  return weight(0, i);
+}
+
+size_t BitVector::select1(size_t k) const {
+  if (rank_index)
+    return k < rank_index->ones() ? rank_index->select1(data.get(), k) : npos;
+  size_t nwords = words_for_bits(nbits);
+  for (size_t w = 0; w < nwords; ++w) {
+    word_t word = word_at(w);
+    size_t cnt = static_cast<size_t>(std::popcount(word));
+    if (k < cnt)
+      return w * BITS_PER_WORD + select_in_word(word, k);
+    k -= cnt;
+  }
+  return npos;
 }
 
 // -- operator[] --
@@ -199,111 +567,537 @@ BitVector::BoolRef BitVector::operator[](size_t i) {
 bool BitVector::operator[](size_t i) const { return get(i); }
 
 // -- comparison --
-bool BitVector::operator==(BitVector &rhs) const {
+bool BitVector::operator==(const BitVector &rhs) const {
   if (nbits != rhs.nbits) {
     return false;
   }
-  for (size_t i = 0; i < nbits; i++) {
-    if (get(i) != rhs.get(i))
-      return false;
+  size_t nwords = words_for_bits(nbits);
+  if (inverted != rhs.inverted) { // one side is read complemented
+    for (size_t w = 0; w < nwords; ++w)
+      if (word_at(w) != rhs.word_at(w))
+        return false;
+    return true;
   }
-  return true;
+  // Tail bits agree on both sides, so whole stored words compare; each
+  // range counts 1 on a mismatch
+  size_t mismatches = parallel_sum_words(nwords, [&](size_t b, size_t e) {
+    return std::equal(data.get() + b, data.get() + e, rhs.data.get() + b)
+               ? size_t(0)
+               : size_t(1);
+  });
+  return mismatches == 0;
 }
 
-// -- bitwise ops --
-BitVector BitVector::operator&(const BitVector &rhs) const {
-  BitVector out(*this);
-  size_t nbytes = bytes_for_bits(std::max(nbits, rhs.nbits));
-  for (size_t i = 0; i < nbytes; ++i)
-    out.data[i] &= rhs.data[i];
-  if (nbytes && (std::max(nbits, rhs.nbits) % BITS_PER_BYTE != 0))
-    out.data[nbytes - 1] &= out.last_byte_mask();
+std::strong_ordering BitVector::operator<=>(const BitVector &rhs) const {
+  size_t common = std::min(nbits, rhs.nbits);
+  size_t full = common / BITS_PER_WORD;
+  const word_t *a = data.get();
+  const word_t *b = rhs.data.get();
+  // Stored words differ where the bits read differ, up to the two flags
+  word_t rel = flip_mask() ^ rhs.flip_mask();
+  size_t w = static_cast<size_t>(
+      std::mismatch(a, a + full, b,
+                    [rel](word_t x, word_t y) { return x == (y ^ rel); })
+          .first -
+      a);
+  word_t diff = 0;
+  if (w < full)
+    diff = a[w] ^ b[w] ^ rel;
+  else if (common % BITS_PER_WORD != 0)
+    diff = (a[w] ^ b[w] ^ rel) & ((word_t(1) << (common % BITS_PER_WORD)) - 1);
+  if (diff != 0) // the lowest differing bit decides
+    return ((a[w] ^ flip_mask()) >> std::countr_zero(diff)) & 1u
+               ? std::strong_ordering::greater
+               : std::strong_ordering::less;
+  return nbits <=> rhs.nbits;
+}
+
+// -- hashing --
+size_t BitVector::hash() const noexcept {
+  if (hash_cache)
+    return *hash_cache;
+  size_t nwords = words_for_bits(nbits);
+  if (inverted)
+    return static_cast<size_t>(
+        hash_words_complement(data.get(), nwords, nbits, last_word_mask()));
+  return static_cast<size_t>(hash_words(data.get(), nwords, nbits));
+}
+
+void BitVector::cache_hash() {
+  hash_cache.reset();
+  hash_cache = hash();
+}
+
+// -- word view --
+const word_t *BitVector::words() {
+  materialize();
+  return data.get();
+}
+
+const word_t *BitVector::words(std::vector<word_t> &scratch) const {
+  if (!inverted)
+    return data.get();
+  scratch = to_words();
+  return scratch.data();
+}
+
+size_t BitVector::word_count() const noexcept { return words_for_bits(nbits); }
+
+// -- word conversion --
+BitVector BitVector::from_words(std::span<const word_t> words, size_t size) {
+  size_t nwords = words_for_bits(size);
+  if (words.size() < nwords)
+    throw std::invalid_argument("Not enough words for the bit count");
+  BitVector out;
+  out.nbits = size;
+  if (nwords) {
+    out.data = WordStorage(nwords);
+    std::memcpy(out.data.get(), words.data(), nwords * sizeof(word_t));
+    out.clear_tail();
+  }
   return out;
 }
+
+std::vector<word_t> BitVector::to_words() const {
+  std::vector<word_t> out(words_for_bits(nbits));
+  for (size_t w = 0; w < out.size(); ++w)
+    out[w] = word_at(w);
+  return out;
+}
+
+uint64_t BitVector::to_uint64() const {
+  size_t nwords = words_for_bits(nbits);
+  for (size_t w = 1; w < nwords; ++w)
+    if (word_at(w) != 0)
+      throw std::overflow_error("BitVector does not fit in 64 bits");
+  return nwords ? word_at(0) : 0;
+}
+
+void BitVector::check_field(size_t pos, size_t width) const {
+  if (width > BITS_PER_WORD)
+    throw std::invalid_argument("Field wider than 64 bits");
+  if (pos > nbits || width > nbits - pos)
+    throw std::out_of_range("Range out of bounds");
+}
+
+uint64_t BitVector::extract(size_t pos, size_t width) const {
+  check_field(pos, width);
+  if (width == 0)
+    return 0;
+  size_t w = pos / BITS_PER_WORD, off = pos % BITS_PER_WORD;
+  word_t v = word_at(w) >> off;
+  if (off + width > BITS_PER_WORD) // straddles two words
+    v |= word_at(w + 1) << (BITS_PER_WORD - off);
+  return width == BITS_PER_WORD ? v : v & ((word_t(1) << width) - 1);
+}
+
+void BitVector::deposit(size_t pos, size_t width, uint64_t value) {
+  check_field(pos, width);
+  if (width == 0)
+    return;
+  detach();
+  size_t w = pos / BITS_PER_WORD, off = pos % BITS_PER_WORD;
+  word_t mask = width == BITS_PER_WORD ? ~word_t(0) : (word_t(1) << width) - 1;
+  value &= mask;
+  data[w] = (data[w] & ~(mask << off)) | (value << off);
+  if (off + width > BITS_PER_WORD) {
+    size_t low_bits = BITS_PER_WORD - off; // already written to word w
+    data[w + 1] = (data[w + 1] & ~(mask >> low_bits)) | (value >> low_bits);
+  }
+}
+
+// -- bitwise ops (in place) --
+// The result keeps this vector's length; missing rhs words read as zero.
+// A complemented operand goes through the expression path, which reads it
+// complemented without writing it out first.
 BitVector &BitVector::operator&=(const BitVector &rhs) {
-  *this = *this & rhs;
+  if (inverted || rhs.inverted)
+    return *this = *this & rhs;
+  detach();
+  size_t nwords = words_for_bits(nbits);
+  size_t common = std::min(nwords, words_for_bits(rhs.nbits));
+  parallel_words(common, [&](size_t b, size_t e) {
+    for (size_t i = b; i < e; ++i)
+      data[i] &= rhs.data[i];
+  });
+  for (size_t i = common; i < nwords; ++i)
+    data[i] = 0;
+  if (nwords)
+    clear_tail();
   return *this;
 }
 
-BitVector BitVector::operator|(const BitVector &rhs) const {
-  BitVector out(*this);
-  size_t nbytes = bytes_for_bits(std::max(nbits, rhs.nbits));
-  for (size_t i = 0; i < nbytes; ++i)
-    out.data[i] |= rhs.data[i];
-  if (nbytes && (std::max(nbits, rhs.nbits) % BITS_PER_BYTE != 0))
-    out.data[nbytes - 1] &= out.last_byte_mask();
-  return out;
-}
 BitVector &BitVector::operator|=(const BitVector &rhs) {
-  *this = *this | rhs;
+  if (inverted || rhs.inverted)
+    return *this = *this | rhs;
+  detach();
+  size_t nwords = words_for_bits(nbits);
+  size_t common = std::min(nwords, words_for_bits(rhs.nbits));
+  parallel_words(common, [&](size_t b, size_t e) {
+    for (size_t i = b; i < e; ++i)
+      data[i] |= rhs.data[i];
+  });
+  if (nwords)
+    clear_tail();
   return *this;
 }
 
-BitVector BitVector::operator^(const BitVector &rhs) const {
-  BitVector out(*this);
-  size_t nbytes = bytes_for_bits(std::max(nbits, rhs.nbits));
-  for (size_t i = 0; i < nbytes; ++i)
-    out.data[i] ^= rhs.data[i];
-  if (nbytes && (std::max(nbits, rhs.nbits) % BITS_PER_BYTE != 0))
-    out.data[nbytes - 1] &= out.last_byte_mask();
-  return out;
-}
 BitVector &BitVector::operator^=(const BitVector &rhs) {
-  *this = *this ^ rhs;
+  if (inverted || rhs.inverted)
+    return *this = *this ^ rhs;
+  detach();
+  size_t nwords = words_for_bits(nbits);
+  size_t common = std::min(nwords, words_for_bits(rhs.nbits));
+  parallel_words(common, [&](size_t b, size_t e) {
+    for (size_t i = b; i < e; ++i)
+      data[i] ^= rhs.data[i];
+  });
+  if (nwords)
+    clear_tail();
   return *this;
 }
 
-// bitwise NOT
-BitVector BitVector::operator~() const {
-  BitVector out(*this);
-  size_t nbytes = bytes_for_bits(nbits);
-  for (size_t i = 0; i < nbytes; ++i)
-    out.data[i] = static_cast<byte_t>(~out.data[i]);
-  if (nbytes && (nbits % BITS_PER_BYTE != 0))
-    out.data[nbytes - 1] &= out.last_byte_mask();
-  return out;
+// -- word shift kernels --
+// Both move whole words and funnel-shift the remainder in from the
+// neighbouring word: out = (w[k] >> r) | (w[k + 1] << (64 - r)).
+
+// Bit i of dst becomes bit i + off of src (towards index 0)
+void BitVector::shift_words_down(word_t *dst, const word_t *src, size_t nwords,
+                                 size_t off) {
+  size_t q = off / BITS_PER_WORD;
+  size_t r = off % BITS_PER_WORD;
+  size_t w = 0;
+  if (q < nwords) {
+    size_t last = nwords - q - 1; // last dst word that still has a source
+    if (r == 0) {
+      std::memmove(dst, src + q, (last + 1) * sizeof(word_t));
+      w = last + 1;
+    } else {
+      for (; w < last; ++w)
+        dst[w] = (src[w + q] >> r) | (src[w + q + 1] << (BITS_PER_WORD - r));
+      dst[w] = src[w + q] >> r;
+      ++w;
+    }
+  }
+  for (; w < nwords; ++w)
+    dst[w] = 0;
 }
 
-// shifts
-BitVector BitVector::operator<<(const size_t off) const {
-  if (off >= nbits)
-    return BitVector(nbits, false);
+// Bit i + off of dst becomes bit i of src (towards the end).
+// Walks from the top so an in-place shift never reads a word it already wrote.
+void BitVector::shift_words_up(word_t *dst, const word_t *src, size_t nwords,
+                               size_t off) {
+  size_t q = off / BITS_PER_WORD;
+  size_t r = off % BITS_PER_WORD;
+  size_t w = nwords;
+  if (r == 0) {
+    if (q < nwords)
+      std::memmove(dst + q, src, (nwords - q) * sizeof(word_t));
+    w = std::min(q, nwords);
+  } else {
+    for (; w > q + 1; --w)
+      dst[w - 1] =
+          (src[w - 1 - q] << r) | (src[w - 2 - q] >> (BITS_PER_WORD - r));
+    if (w > q) {
+      dst[q] = src[0] << r;
+      w = q;
+    }
+  }
+  for (; w > 0; --w)
+    dst[w - 1] = 0;
+}
 
-  BitVector out(nbits, false);
-  for (size_t i = 0; i < nbits - off; ++i) {
-    if (get(i + off)) {
-      out.set(i, true);
+void BitVector::copy_words_from(word_t *dst, size_t count, size_t pos) const {
+  size_t nwords = words_for_bits(nbits);
+  size_t q = pos / BITS_PER_WORD;
+  size_t r = pos % BITS_PER_WORD;
+  for (size_t w = 0; w < count; ++w) {
+    size_t s = q + w;
+    word_t lo = s < nwords ? data[s] : 0;
+    if (r == 0) {
+      dst[w] = lo;
+    } else {
+      word_t hi = s + 1 < nwords ? data[s + 1] : 0;
+      dst[w] = (lo >> r) | (hi << (BITS_PER_WORD - r));
     }
   }
+}
+
+void BitVector::or_words_at(const word_t *src, size_t count, size_t pos) {
+  size_t nwords = words_for_bits(nbits);
+  size_t q = pos / BITS_PER_WORD;
+  size_t r = pos % BITS_PER_WORD;
+  for (size_t j = 0; j < count && q + j < nwords; ++j) {
+    data[q + j] |= src[j] << r;
+    if (r != 0 && q + j + 1 < nwords)
+      data[q + j + 1] |= src[j] >> (BITS_PER_WORD - r);
+  }
+  if (nwords)
+    clear_tail();
+}
+
+// shifts
+BitVector BitVector::operator<<(const size_t off) const {
+  if (inverted) {
+    BitVector out(*this);
+    out <<= off;
+    return out;
+  }
+  BitVector out(nbits, false);
+  if (off < nbits)
+    shift_words_down(out.data.get(), data.get(), words_for_bits(nbits), off);
   return out;
 }
 BitVector &BitVector::operator<<=(const size_t off) {
-  *this = *this << off;
+  detach();
+  if (off >= nbits)
+    setAll(false);
+  else if (off != 0)
+    shift_words_down(data.get(), data.get(), words_for_bits(nbits), off);
   return *this;
 }
 
 BitVector BitVector::operator>>(const size_t off) const {
-  if (off >= nbits)
-    return BitVector(nbits, false);
-
+  if (inverted) {
+    BitVector out(*this);
+    out >>= off;
+    return out;
+  }
   BitVector out(nbits, false);
-  for (size_t i = 0; i < nbits - off; ++i) {
-    if (get(i)) {
-      out.set(i + off, true);
-    }
+  if (off < nbits) {
+    shift_words_up(out.data.get(), data.get(), words_for_bits(nbits), off);
+    out.clear_tail();
   }
   return out;
 }
 
 BitVector &BitVector::operator>>=(const size_t off) {
-  *this = *this >> off;
+  detach();
+  if (off >= nbits) {
+    setAll(false);
+  } else if (off != 0) {
+    shift_words_up(data.get(), data.get(), words_for_bits(nbits), off);
+    clear_tail();
+  }
   return *this;
 }
 
+// -- rotations --
+// Only the k <= n/2 bits that wrap around are saved aside; the rest moves in
+// place with the word shifts above.
+void BitVector::rotateLeft(size_t k) {
+  detach();
+  if (nbits == 0)
+    return;
+  k %= nbits;
+  if (k == 0)
+    return;
+  if (k > nbits / 2) {
+    rotateRight(nbits - k);
+    return;
+  }
+  size_t count = words_for_bits(k);
+  WordStorage wrapped(count);
+  copy_words_from(wrapped.get(), count, 0);
+  if (k % BITS_PER_WORD != 0)
+    wrapped[count - 1] &= (word_t(1) << (k % BITS_PER_WORD)) - 1;
+  *this <<= k;
+  or_words_at(wrapped.get(), count, nbits - k);
+}
+
+void BitVector::rotateRight(size_t k) {
+  detach();
+  if (nbits == 0)
+    return;
+  k %= nbits;
+  if (k == 0)
+    return;
+  if (k > nbits / 2) {
+    rotateLeft(nbits - k);
+    return;
+  }
+  size_t count = words_for_bits(k);
+  WordStorage wrapped(count);
+  copy_words_from(wrapped.get(), count, nbits - k); // tail bits are zero
+  *this >>= k;
+  or_words_at(wrapped.get(), count, 0);
+}
+
+// -- storage --
+
+BitVector::WordStorage BitVector::fresh_words(size_t nwords) const {
+  if (data.kind() == WordStorage::Kind::Shared)
+    return WordStorage::shared(nwords);
+  return WordStorage(nwords);
+}
+
+void BitVector::copy_shared_words() {
+  size_t nwords = words_for_bits(nbits);
+  WordStorage copy = WordStorage::shared(nwords);
+  std::memcpy(copy.get(), data.get(), nwords * sizeof(word_t));
+  data = std::move(copy);
+}
+
+void BitVector::make_shareable() {
+  if (!data || data.kind() != WordStorage::Kind::Owned)
+    return;
+  size_t nwords = words_for_bits(nbits);
+  WordStorage copy = WordStorage::shared(nwords);
+  std::memcpy(copy.get(), data.get(), nwords * sizeof(word_t));
+  data = std::move(copy);
+}
+
+bool BitVector::shares_words() const noexcept { return !data.exclusive(); }
+
+BitVector BitVector::borrow(std::span<word_t> words, size_t size) {
+  if (words.size() < words_for_bits(size))
+    throw std::invalid_argument("Not enough words for the bit count");
+  BitVector out;
+  out.nbits = size;
+  if (size != 0) {
+    out.data = WordStorage::borrowed(words.data());
+    out.clear_tail();
+  }
+  return out;
+}
+
+BitVector BitVector::map_file(const std::string &path, size_t size,
+                              MapMode mode) {
+  BitVector out;
+  out.nbits = size;
+  size_t bytes = words_for_bits(size) * sizeof(word_t);
+#if BITVECTOR_HAS_MMAP
+  bool shared = mode == MapMode::ReadWrite;
+  int fd = ::open(path.c_str(), shared ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+  if (fd < 0)
+    throw std::runtime_error("Cannot open " + path);
+  struct stat st{};
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw std::runtime_error("Cannot stat " + path);
+  }
+  if (static_cast<size_t>(st.st_size) < bytes) {
+    if (!shared || ::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+      ::close(fd);
+      throw std::runtime_error("File too small for the bit count: " + path);
+    }
+  }
+  if (bytes == 0) {
+    ::close(fd);
+    return out;
+  }
+  // A private mapping is still writable; writes stay in this process
+  void *p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                   shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+  ::close(fd); // the mapping keeps the file alive
+  if (p == MAP_FAILED)
+    throw std::runtime_error("Cannot map " + path);
+  out.data = WordStorage::mapped(static_cast<word_t *>(p), bytes);
+  // Opening never writes the file: padding bits past size are cleared only
+  // in a private mapping, and a shared one must already have them clear
+  if (!shared)
+    out.clear_tail();
+  else if ((out.data[bytes / sizeof(word_t) - 1] & ~out.last_word_mask()) != 0)
+    throw std::runtime_error("Bits set past the bit count in " + path);
+  return out;
+#else
+  (void)path;
+  (void)mode;
+  (void)bytes;
+  throw std::runtime_error("Memory-mapped BitVector needs POSIX mmap");
+#endif
+}
+
+void BitVector::sync() const {
+#if BITVECTOR_HAS_MMAP
+  if (data.kind() == WordStorage::Kind::Mapped &&
+      ::msync(const_cast<word_t *>(data.get()), data.mapped_bytes(),
+              MS_SYNC) != 0)
+    throw std::runtime_error("msync failed");
+#endif
+}
+
+// -- binary snapshots --
+
+void BitVector::save(std::ostream &os) const {
+  std::vector<word_t> scratch;
+  const word_t *w = words(scratch);
+  size_t nwords = words_for_bits(nbits);
+  SnapshotHeader h;
+  h.rows = 1;
+  h.columns = nbits;
+  h.checksum = snapshot_checksum(w, nwords);
+  write_snapshot_header(os, h);
+  write_snapshot_words(os, w, nwords);
+}
+
+void BitVector::save(const std::string &path) const {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out)
+    throw std::runtime_error("Cannot open " + path);
+  save(out);
+  if (!out.flush())
+    throw std::runtime_error("Cannot write " + path);
+}
+
+BitVector BitVector::load(std::istream &is) {
+  SnapshotHeader h = read_snapshot_header(is);
+  if (h.rows != 1)
+    throw std::runtime_error("Snapshot does not hold a single vector");
+  size_t nwords = words_for_bits(h.columns);
+  if (!check_snapshot_length(is, nwords)) {
+    // Size unknown up front: buffer the words as they arrive
+    std::vector<word_t> words;
+    read_snapshot_words_chunked(is, words, nwords, h.foreign_order);
+    if (snapshot_checksum(words.data(), nwords) != h.checksum)
+      throw std::runtime_error("Snapshot checksum mismatch");
+    return from_words(words, h.columns);
+  }
+  BitVector out(h.columns);
+  read_snapshot_words(is, out.data.get(), nwords, h.foreign_order);
+  if (snapshot_checksum(out.data.get(), nwords) != h.checksum)
+    throw std::runtime_error("Snapshot checksum mismatch");
+  out.clear_tail();
+  return out;
+}
+
+BitVector BitVector::load(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    throw std::runtime_error("Cannot open " + path);
+  return load(in);
+}
+
+BitVector BitVector::view(std::span<std::byte> snapshot, bool verify) {
+  SnapshotHeader h = parse_snapshot_header(snapshot);
+  if (h.rows != 1)
+    throw std::runtime_error("Snapshot does not hold a single vector");
+  if (h.foreign_order)
+    throw std::runtime_error("Snapshot words are not in host byte order");
+  size_t nwords = h.total_words();
+  if (snapshot.size() - SNAPSHOT_HEADER_BYTES < nwords * sizeof(word_t))
+    throw std::runtime_error("Truncated snapshot");
+  std::byte *first = snapshot.data() + SNAPSHOT_HEADER_BYTES;
+  if (reinterpret_cast<uintptr_t>(first) % alignof(word_t) != 0)
+    throw std::invalid_argument("Snapshot buffer is not 8-byte aligned");
+  auto *words = reinterpret_cast<word_t *>(first);
+  if (verify && snapshot_checksum(words, nwords) != h.checksum)
+    throw std::runtime_error("Snapshot checksum mismatch");
+  return borrow(std::span<word_t>(words, nwords), h.columns);
+}
+
 // -- stream operators --
+// Text is expanded a block at a time and written with one write() per block
 std::ostream &operator<<(std::ostream &os, const BitVector &bv) {
-  for (size_t i = 0; i < bv.size(); ++i)
-    os << (bv[i] ? '1' : '0');
+  constexpr size_t BLOCK = size_t(1) << 16; // characters, a multiple of 64
+  std::string buf(std::min(bv.size(), BLOCK), '\0');
+  std::vector<word_t> scratch;
+  const word_t *words = bv.words(scratch);
+  for (size_t pos = 0; pos < bv.size(); pos += BLOCK) {
+    size_t count = std::min(BLOCK, bv.size() - pos);
+    format_bits(words + pos / BITS_PER_WORD, count, buf.data());
+    os.write(buf.data(), static_cast<std::streamsize>(count));
+  }
   return os;
 }
 
@@ -312,16 +1106,11 @@ std::istream &operator>>(std::istream &is, BitVector &bv) {
   if (!(is >> s))
     return is;
 
-  for (char c : s)
-    if (c != '0' && c != '1') {
-      is.setstate(std::ios::failbit);
-      return is;
-    }
-
-  bv = BitVector(s.size());
-  for (size_t i = 0; i < s.size(); ++i)
-    if (s[i] == '1')
-      bv.set(i, true);
-
+  BitVector parsed(s.size());
+  if (parsed.nbits != 0 && !parse_bits(s.data(), s.size(), parsed.data.get())) {
+    is.setstate(std::ios::failbit);
+    return is;
+  }
+  bv = std::move(parsed);
   return is;
 }
@@ -1,20 +1,42 @@
 #pragma once
 
+#include <atomic>
+#include <climits>
+#include <compare>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <iosfwd>
 #include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+#include "rank_select.hpp"
 
 using byte_t = uint8_t;
+using word_t = uint64_t;
 using pair = std::pair<size_t, size_t>;
 static constexpr size_t BITS_PER_BYTE = CHAR_BIT; // usually 8
+static constexpr size_t BITS_PER_WORD = sizeof(word_t) * BITS_PER_BYTE; // 64
+static constexpr size_t WORD_ALIGNMENT = 64; // one cache line
+
+// Lazy bitwise expressions, see bitvector.tpp. Only expression nodes
+// specialise this trait; a BitVector itself is a leaf operand.
+template <class T> struct is_bit_expr : std::false_type {};
+template <class T>
+concept BitExpr = is_bit_expr<std::remove_cvref_t<T>>::value;
+struct BitLeaf;
 
 class BitVector {
 public:
   // Byte to Bit converter
   static size_t bytes_for_bits(size_t bits);
+  // Word to Bit converter
+  static size_t words_for_bits(size_t bits);
 
   // Constructors / destructor / assignment
   BitVector() = default;
@@ -26,11 +48,12 @@ class BitVector {
   BitVector &operator=(BitVector &&) noexcept = default;
   ~BitVector() = default;
 
-  // position: byte and offset:
+  // position: word and offset:
   pair coord(size_t i) const;
 
   // Clean garbage bits and preserve valid bits (valid bit filter)
   byte_t last_byte_mask() const;
+  word_t last_word_mask() const;
 
   // Range Checker
   void check_index(size_t i) const;
@@ -42,7 +65,7 @@ class BitVector {
   // length
   size_t size() const noexcept;
 
-  // value
+  // value (bit 0 is the most significant; only for vectors of < 32 bits)
   int value() const;
 
   // BoolRef proxy
@@ -62,29 +85,93 @@ class BitVector {
   bool get(size_t i) const;
   void set(size_t i, bool value);
   void flip(size_t i);
+  // O(1): only a complement flag is toggled (see "lazy complement" below)
   void flipAll();
   void setRange(size_t i, size_t k, bool value);
+  void flipRange(size_t i, size_t k);
   void setAll(bool value);
   size_t weight() const;
+  size_t weight(size_t from, size_t to) const; // set bits in [from, to)
+
+  // set-bit search, npos when there is none
+  static constexpr size_t npos = static_cast<size_t>(-1);
+  size_t find_first() const noexcept;
+  size_t find_next(size_t i) const noexcept; // first set bit after i
+  size_t find_last() const noexcept;
+  size_t find_prev(size_t i) const noexcept; // last set bit before i
+
+  // visit(i) for every set bit i, in increasing order
+  template <class F> void for_each_set_bit(F &&visit) const;
+
+  // -- index batches --
+  // One range check for the whole list (std::out_of_range before anything
+  // is written), then a plain word update per index with the target word
+  // prefetched PREFETCH_AHEAD indices early (prefetch.hpp), so the cache
+  // misses of a long random list overlap. Any order, duplicates allowed.
+  void set_bits(std::span<const size_t> indices, bool value = true);
+  // out becomes indices.size() bits, bit k = get(indices[k])
+  void test_bits(std::span<const size_t> indices, BitVector &out) const;
+
+  // -- rank/select --
+  // build_rank_select() adds an index (about 3% of the size, see
+  // rank_select.hpp) that makes rank1 O(1) and select1 near-O(1). Any
+  // mutation through this vector drops it, and copies do not carry it.
+  // Without an index both fall back to a word scan.
+  void build_rank_select();
+  bool has_rank_select() const noexcept;
+  size_t rank1(size_t i) const;   // set bits in [0, i), i <= size()
+  size_t select1(size_t k) const; // k-th set bit (from 0), npos if none
 
   // operator[]
   BoolRef operator[](size_t i);
   bool operator[](size_t i) const;
 
-  // comparisons
-  bool operator==(BitVector &rhs) const;
+  // comparisons: == compares whole words; <=> is lexicographic over the
+  // bits in index order (the order of the text form), a prefix first
+  bool operator==(const BitVector &rhs) const;
+  std::strong_ordering operator<=>(const BitVector &rhs) const;
 
-  // bitwise operators
-  BitVector operator&(const BitVector &rhs) const;
-  BitVector &operator&=(const BitVector &rhs);
+  // -- hashing --
+  // 64-bit hash of the size and the words (bithash.hpp), also behind
+  // std::hash<BitVector>. cache_hash() keeps it so hash() is O(1) until
+  // the next mutation through this vector; copies carry it along.
+  size_t hash() const noexcept;
+  void cache_hash();
 
-  BitVector operator|(const BitVector &rhs) const;
+  // bitwise operators (in place; &, |, ^ and ~ build lazy expressions)
+  BitVector &operator&=(const BitVector &rhs);
   BitVector &operator|=(const BitVector &rhs);
-
-  BitVector operator^(const BitVector &rhs) const;
   BitVector &operator^=(const BitVector &rhs);
 
-  BitVector operator~() const;
+  // Fused evaluation of expressions such as (a & b) | (c ^ ~d): a single
+  // pass over the words, no temporaries
+  template <BitExpr E> BitVector(const E &expr);
+  template <BitExpr E> BitVector &operator=(const E &expr);
+  template <BitExpr E> BitVector &operator&=(const E &expr);
+  template <BitExpr E> BitVector &operator|=(const E &expr);
+  template <BitExpr E> BitVector &operator^=(const E &expr);
+
+  // raw word view (bits past size() in the last word are always zero).
+  // words() applies a pending flipAll() to the stored words first
+  // (allocating if they are shared), so it is not const. The const form
+  // never writes: it returns the stored words, or copies the bits into
+  // scratch while a complement is pending, and is safe from any thread.
+  const word_t *words();
+  const word_t *words(std::vector<word_t> &scratch) const;
+  size_t word_count() const noexcept;
+
+  // -- word conversion --
+  // Bit i is bit i % 64 of word i / 64, the storage layout, so these are
+  // plain copies. Unlike value(), bit 0 is the least significant.
+  // from_words reads words_for_bits(size) words and ignores bits past size.
+  static BitVector from_words(std::span<const word_t> words, size_t size);
+  std::vector<word_t> to_words() const;
+  // Bits [0, 64); throws std::overflow_error if a later bit is set
+  uint64_t to_uint64() const;
+  // Field of width <= 64 bits starting at pos, bit pos least significant.
+  // deposit writes the low width bits of value.
+  uint64_t extract(size_t pos, size_t width) const;
+  void deposit(size_t pos, size_t width, uint64_t value);
 
   // shifts
   BitVector operator<<(const size_t off) const;
@@ -93,11 +180,195 @@ class BitVector {
   BitVector operator>>(const size_t off) const;
   BitVector &operator>>=(const size_t off);
 
+  // rotations (bits pushed out of one end re-enter at the other)
+  void rotateLeft(size_t k);  // same direction as <<
+  void rotateRight(size_t k); // same direction as >>
+
+  // -- storage --
+  // Words are normally owned (aligned heap). A vector can also work on words
+  // it does not own; all operators then read and write them in place, and
+  // only an operation that changes the word count switches to owned words.
+  // Copies are owned (or shared, see make_shareable below); assigning a
+  // vector of the same word count writes the borrowed or mapped words.
+  enum class MapMode {
+    ReadOnly, // private mapping: the file is never written
+    ReadWrite // shared mapping: changes reach the file
+  };
+
+  // View over caller-owned words, at least words_for_bits(size) of them
+  static BitVector borrow(std::span<word_t> words, size_t size);
+  // Raw words of a file mapped into memory (host byte order, no header).
+  // ReadWrite creates or grows the file as needed and never writes it on
+  // open: it throws std::runtime_error if bits past size are set in the
+  // last word (ReadOnly just clears them in its private copy).
+  static BitVector map_file(const std::string &path, size_t size,
+                            MapMode mode = MapMode::ReadOnly);
+  // Flush a ReadWrite mapping to its file (no-op for other storage)
+  void sync() const;
+
+  // -- copy-on-write --
+  // make_shareable() moves owned words into a reference-counted buffer.
+  // Copies then share it in O(1), and the first copy to write takes a
+  // private copy. The mode sticks: copies of a shareable vector, and the
+  // buffers they take on write, are shareable too. Borrowed and mapped
+  // words are left as they are.
+  void make_shareable();
+  bool shares_words() const noexcept; // another vector holds these words
+
+  // -- lazy complement --
+  // flipAll() on owned or shared words only toggles a flag; every reader
+  // applies it word by word (weight() becomes size() minus the stored
+  // count) and an expression such as a & ~b folds it into the same pass.
+  // The words themselves are complemented once, by the first mutation,
+  // build_rank_select() or words(); const readers, save() included, never
+  // write them. Borrowed and mapped words are flipped at once, since their
+  // owner may read them at any time.
+  bool complement_pending() const noexcept;
+
+  // -- binary snapshots (format in snapshot.hpp) --
+  // About 1/8 of the text form; load() verifies the checksum
+  void save(std::ostream &os) const;
+  void save(const std::string &path) const;
+  static BitVector load(std::istream &is);
+  static BitVector load(const std::string &path);
+  // Zero-copy: the words are used in place, like borrow(), so the buffer
+  // (e.g. a mapped snapshot file) must outlive the vector and be 8-byte
+  // aligned. verify = false skips the checksum pass.
+  static BitVector view(std::span<std::byte> snapshot, bool verify = true);
+
 private:
-  std::unique_ptr<byte_t[]> data;
+  // Owner of the word buffer: an aligned heap block (cache-line aligned so
+  // the word loops vectorize cleanly), borrowed words that are never freed,
+  // a memory map that is unmapped on destruction, or a shared heap block
+  // whose reference count sits in the cache line before the words.
+  // get() is null while nothing is stored.
+  class WordStorage {
+  public:
+    enum class Kind : uint8_t { Owned, Borrowed, Mapped, Shared };
+
+    WordStorage() noexcept = default;
+    explicit WordStorage(size_t nwords); // owned
+    static WordStorage borrowed(word_t *words) noexcept;
+    static WordStorage mapped(word_t *words, size_t bytes) noexcept;
+    static WordStorage shared(size_t nwords); // one reference
+    // Another reference to a Shared buffer
+    WordStorage share() const noexcept;
+    WordStorage(WordStorage &&other) noexcept;
+    WordStorage &operator=(WordStorage &&other) noexcept;
+    ~WordStorage();
+
+    word_t *get() noexcept { return ptr; }
+    const word_t *get() const noexcept { return ptr; }
+    word_t &operator[](size_t i) noexcept { return ptr[i]; }
+    const word_t &operator[](size_t i) const noexcept { return ptr[i]; }
+    explicit operator bool() const noexcept { return ptr != nullptr; }
+    Kind kind() const noexcept { return owner; }
+    size_t mapped_bytes() const noexcept { return map_bytes; }
+    // False while another WordStorage holds the same Shared buffer
+    bool exclusive() const noexcept {
+      return owner != Kind::Shared ||
+             refs().load(std::memory_order_acquire) == 1;
+    }
+
+    void swap(WordStorage &other) noexcept;
+    void reset() noexcept;
+
+  private:
+    std::atomic<size_t> &refs() const noexcept {
+      return *reinterpret_cast<std::atomic<size_t> *>(
+          reinterpret_cast<std::byte *>(ptr) - WORD_ALIGNMENT);
+    }
+
+    word_t *ptr = nullptr;
+    size_t map_bytes = 0; // Mapped only
+    Kind owner = Kind::Owned;
+  };
+
+  // Range check for extract/deposit
+  void check_field(size_t pos, size_t width) const;
+
+  // Zero the unused bits of the last word
+  void clear_tail() noexcept;
+
+  // Word shift kernels, dst may alias src (used for in-place shifts)
+  static void shift_words_down(word_t *dst, const word_t *src, size_t nwords,
+                               size_t off);
+  static void shift_words_up(word_t *dst, const word_t *src, size_t nwords,
+                             size_t off);
+
+  // Copy bits [pos, pos + 64 * count) into dst / OR src in starting at pos
+  void copy_words_from(word_t *dst, size_t count, size_t pos) const;
+  void or_words_at(const word_t *src, size_t count, size_t pos);
+
+  // Evaluate an expression into this vector (bitvector.tpp)
+  template <class E> void assign_expr(const E &expr);
+
+  // The rank/select index and the cached hash are only valid for the
+  // words they were built from
+  void drop_caches() noexcept {
+    if (rank_index)
+      rank_index.reset();
+    hash_cache.reset();
+  }
+
+  // Called by every mutator before it writes: drops the caches, applies a
+  // pending complement and takes a private copy of words shared with
+  // another vector
+  void detach() {
+    drop_caches();
+    if (inverted)
+      materialize();
+    if (!data.exclusive())
+      copy_shared_words();
+  }
+  void copy_shared_words();
+  // Buffer of nwords of the same kind (owned or shared) as this one's
+  WordStorage fresh_words(size_t nwords) const;
+
+  // Borrowed or mapped: the owner may read the words at any time, so they
+  // never keep a pending complement
+  bool foreign_words() const noexcept {
+    return data.kind() == WordStorage::Kind::Borrowed ||
+           data.kind() == WordStorage::Kind::Mapped;
+  }
+  // XOR mask of the pending complement
+  word_t flip_mask() const noexcept { return inverted ? ~word_t(0) : 0; }
+  // Word w as the bits read, the complement applied and the tail cleared
+  word_t word_at(size_t w) const noexcept {
+    if (!inverted)
+      return data[w];
+    word_t x = ~data[w];
+    return w + 1 == word_count() ? x & last_word_mask() : x;
+  }
+  // Complement the stored words and clear the flag (into a new buffer
+  // when they are shared)
+  void materialize();
+
+  // Snapshots are written straight into the words
+  friend class AtomicBitVector;
+  // Probes read and set whole cache-line blocks
+  friend class BloomFilter;
+  // Batched cell writes go straight to the row words
+  friend class BitMatrix;
+
+  // Parses straight into the words (bittext.hpp)
+  friend std::istream &operator>>(std::istream &is, BitVector &bv);
+  // Expression leaves carry the complement flag (bitvector.tpp)
+  friend BitLeaf bit_operand(const BitVector &v) noexcept;
+
+  WordStorage data;
   size_t nbits = 0;
+  bool inverted = false; // stored words are the complement
+  std::unique_ptr<RankSelect> rank_index; // optional
+  std::optional<size_t> hash_cache;       // cache_hash()
+};
+
+template <> struct std::hash<BitVector> {
+  size_t operator()(const BitVector &bv) const noexcept { return bv.hash(); }
 };
 
 // stream operators (non-member)
 std::ostream &operator<<(std::ostream &os, const BitVector &bv);
 std::istream &operator>>(std::istream &is, BitVector &bv);
+
+#include "bitvector.tpp"
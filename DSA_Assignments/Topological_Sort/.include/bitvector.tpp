@@ -0,0 +1,216 @@
+#ifndef BITVECTOR_TPP
+#define BITVECTOR_TPP
+
+// Lazy bitwise expressions for BitVector.
+// a & b, a | b, a ^ b and ~a build small expression nodes instead of vectors.
+// Assigning a node to a BitVector evaluates the whole tree word by word in
+// one pass, so r = (a & b) | (c ^ ~d) allocates nothing but r itself.
+// Nodes reference their operands: evaluate them in the same full expression
+// (do not keep them in an `auto` variable past the operands' lifetime).
+
+#include "bitvector.hpp"
+#include "parallel.hpp"
+
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <type_traits>
+
+// -- word helpers --
+
+// Valid-bit mask of word i for a vector of nbits (zero past the end)
+inline word_t bit_word_mask(size_t i, size_t nbits) noexcept {
+  size_t full = nbits / BITS_PER_WORD;
+  if (i < full)
+    return ~word_t(0);
+  size_t rem = nbits % BITS_PER_WORD;
+  if (i > full || rem == 0)
+    return 0;
+  return (word_t(1) << rem) - 1;
+}
+
+// -- expression nodes --
+// Every node offers:
+//   size()        length of the result (the left operand's length)
+//   same_size(n)  true when every leaf has exactly n bits
+//   word(i)       word i, no bounds handling (used when same_size holds)
+//   word_ext(i)   word i with shorter operands zero-extended and longer
+//                 ones cut to size(), as if every node were a vector
+
+// flip is the vector's pending complement (all ones after flipAll()), so
+// a complemented vector is read in the same pass as everything else
+struct BitLeaf {
+  const word_t *w;
+  size_t nbits;
+  size_t nwords;
+  word_t flip;
+
+  size_t size() const noexcept { return nbits; }
+  bool same_size(size_t n) const noexcept { return nbits == n; }
+  word_t word(size_t i) const noexcept { return w[i] ^ flip; }
+  word_t word_ext(size_t i) const noexcept {
+    if (i >= nwords)
+      return 0;
+    return flip ? ~w[i] & bit_word_mask(i, nbits) : w[i];
+  }
+};
+
+struct BitAndOp {
+  word_t operator()(word_t a, word_t b) const noexcept { return a & b; }
+};
+struct BitOrOp {
+  word_t operator()(word_t a, word_t b) const noexcept { return a | b; }
+};
+struct BitXorOp {
+  word_t operator()(word_t a, word_t b) const noexcept { return a ^ b; }
+};
+
+template <class Op, class L, class R> struct BitBinaryExpr {
+  L lhs;
+  R rhs;
+
+  size_t size() const noexcept { return lhs.size(); }
+  bool same_size(size_t n) const noexcept {
+    return lhs.same_size(n) && rhs.same_size(n);
+  }
+  word_t word(size_t i) const noexcept {
+    return Op{}(lhs.word(i), rhs.word(i));
+  }
+  word_t word_ext(size_t i) const noexcept {
+    return Op{}(lhs.word_ext(i), rhs.word_ext(i)) & bit_word_mask(i, size());
+  }
+};
+
+template <class E> struct BitNotExpr {
+  E operand;
+
+  size_t size() const noexcept { return operand.size(); }
+  bool same_size(size_t n) const noexcept { return operand.same_size(n); }
+  // Tail garbage is cleared once, after the whole tree is evaluated
+  word_t word(size_t i) const noexcept { return ~operand.word(i); }
+  word_t word_ext(size_t i) const noexcept {
+    return ~operand.word_ext(i) & bit_word_mask(i, operand.size());
+  }
+};
+
+template <class Op, class L, class R>
+struct is_bit_expr<BitBinaryExpr<Op, L, R>> : std::true_type {};
+template <class E> struct is_bit_expr<BitNotExpr<E>> : std::true_type {};
+
+// -- operands --
+
+template <class T>
+concept BitOperand =
+    BitExpr<T> || std::derived_from<std::remove_cvref_t<T>, BitVector>;
+
+// Reads the stored words directly: words() would apply the complement
+inline BitLeaf bit_operand(const BitVector &v) noexcept {
+  return {v.data.get(), v.size(), v.word_count(), v.flip_mask()};
+}
+template <BitExpr E> const E &bit_operand(const E &expr) noexcept {
+  return expr;
+}
+
+template <class T>
+using bit_operand_t =
+    std::remove_cvref_t<decltype(bit_operand(std::declval<const T &>()))>;
+
+// -- operators --
+
+template <BitOperand L, BitOperand R>
+BitBinaryExpr<BitAndOp, bit_operand_t<L>, bit_operand_t<R>>
+operator&(const L &lhs, const R &rhs) {
+  return {bit_operand(lhs), bit_operand(rhs)};
+}
+
+template <BitOperand L, BitOperand R>
+BitBinaryExpr<BitOrOp, bit_operand_t<L>, bit_operand_t<R>>
+operator|(const L &lhs, const R &rhs) {
+  return {bit_operand(lhs), bit_operand(rhs)};
+}
+
+template <BitOperand L, BitOperand R>
+BitBinaryExpr<BitXorOp, bit_operand_t<L>, bit_operand_t<R>>
+operator^(const L &lhs, const R &rhs) {
+  return {bit_operand(lhs), bit_operand(rhs)};
+}
+
+template <BitOperand E> BitNotExpr<bit_operand_t<E>> operator~(const E &expr) {
+  return {bit_operand(expr)};
+}
+
+// -- evaluation --
+
+template <class E> void BitVector::assign_expr(const E &expr) {
+  drop_caches();
+  const size_t n = expr.size();
+  const size_t nwords = words_for_bits(n);
+
+  // The nodes are element-wise (word i only reads word i of each operand), so
+  // evaluating straight into our own buffer is safe even when *this is one
+  // of the operands. A new buffer is only needed when the length changes or
+  // the words are shared; every word is overwritten, so none are copied.
+  WordStorage fresh;
+  word_t *dst = data.get();
+  if (nwords != words_for_bits(nbits) || !data || !data.exclusive()) {
+    if (nwords)
+      fresh = fresh_words(nwords);
+    dst = fresh.get();
+  }
+
+  // Large vectors are evaluated range by range on the thread pool
+  const bool same = expr.same_size(n);
+  parallel_words(nwords, [&](size_t begin, size_t end) {
+    if (same) {
+      for (size_t i = begin; i < end; ++i)
+        dst[i] = expr.word(i);
+    } else {
+      for (size_t i = begin; i < end; ++i)
+        dst[i] = expr.word_ext(i);
+    }
+  });
+
+  if (dst != data.get())
+    data.swap(fresh);
+  nbits = n;
+  inverted = false; // the leaves applied it
+  if (nwords)
+    clear_tail();
+}
+
+template <BitExpr E> BitVector::BitVector(const E &expr) { assign_expr(expr); }
+
+template <BitExpr E> BitVector &BitVector::operator=(const E &expr) {
+  assign_expr(expr);
+  return *this;
+}
+
+template <BitExpr E> BitVector &BitVector::operator&=(const E &expr) {
+  assign_expr(*this & expr);
+  return *this;
+}
+
+template <BitExpr E> BitVector &BitVector::operator|=(const E &expr) {
+  assign_expr(*this | expr);
+  return *this;
+}
+
+template <BitExpr E> BitVector &BitVector::operator^=(const E &expr) {
+  assign_expr(*this ^ expr);
+  return *this;
+}
+
+// -- set-bit iteration --
+
+template <class F> void BitVector::for_each_set_bit(F &&visit) const {
+  size_t nwords = words_for_bits(nbits);
+  for (size_t w = 0; w < nwords; ++w) {
+    word_t word = word_at(w);
+    while (word) {
+      visit(w * BITS_PER_WORD + static_cast<size_t>(std::countr_zero(word)));
+      word &= word - 1; // clear the lowest set bit
+    }
+  }
+}
+
+#endif // BITVECTOR_TPP
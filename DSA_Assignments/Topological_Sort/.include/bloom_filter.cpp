@@ -0,0 +1,186 @@
+#include "bloom_filter.hpp"
+#include "prefetch.hpp"
+
+#include <algorithm> // std::min
+#include <cmath>
+#include <stdexcept>
+
+// Keys hashed and prefetched ahead of the probes in the batched calls
+static constexpr size_t BATCH_KEYS = 32;
+
+// Odd multipliers of the split-block scheme, one per word of a block; the
+// top 6 bits of (low hash half * salt) pick the bit in that word
+static constexpr uint32_t SALTS[BloomFilter::HASHES] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+    0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u};
+
+static_assert(BloomFilter::BLOCK_WORDS == 8, "one 64-byte block per key");
+
+// The bit word j of the block gets for this hash. Probes build the masks
+// in registers; staging them in an array costs a store-forwarding stall.
+static word_t block_mask(uint64_t hash, size_t j) {
+  uint32_t low = static_cast<uint32_t>(hash);
+  return word_t(1) << ((low * SALTS[j]) >> 26);
+}
+
+// Block of a hash among blocks: multiply-shift range reduction of the high
+// half, a modulo only past 2^32 blocks
+static size_t block_index(uint64_t hash, uint64_t blocks) {
+  if (blocks <= UINT32_MAX)
+    return static_cast<size_t>(((hash >> 32) * blocks) >> 32);
+  return static_cast<size_t>(hash % blocks);
+}
+
+static void set_block(word_t *block, uint64_t hash) {
+  for (size_t j = 0; j < BloomFilter::BLOCK_WORDS; ++j)
+    block[j] |= block_mask(hash, j);
+}
+
+static bool test_block(const word_t *block, uint64_t hash) {
+  word_t missing = 0;
+  for (size_t j = 0; j < BloomFilter::BLOCK_WORDS; ++j)
+    missing |= block_mask(hash, j) & ~block[j];
+  return missing == 0;
+}
+
+// -- constructors --
+
+BloomFilter::BloomFilter(size_t bits, uint64_t seed)
+    : filter_bits(std::max<size_t>(1, (bits + BLOCK_BITS - 1) / BLOCK_BITS) *
+                  BLOCK_BITS),
+      hash_seed(seed) {}
+
+BloomFilter BloomFilter::for_capacity(size_t keys, double false_positive_rate,
+                                      uint64_t seed) {
+  if (!(false_positive_rate > 0 && false_positive_rate < 1))
+    throw std::invalid_argument("False positive rate must be in (0, 1)");
+  // p = (1 - e^(-k n / m))^k solved for m, k = HASHES
+  double k = static_cast<double>(HASHES);
+  double bits = -k * static_cast<double>(keys) /
+                std::log(1 - std::pow(false_positive_rate, 1 / k));
+  return BloomFilter(static_cast<size_t>(std::ceil(bits)), seed);
+}
+
+// -- properties --
+
+size_t BloomFilter::size() const noexcept { return filter_bits.size(); }
+
+size_t BloomFilter::block_count() const noexcept {
+  return filter_bits.size() / BLOCK_BITS;
+}
+
+uint64_t BloomFilter::seed() const noexcept { return hash_seed; }
+
+const BitVector &BloomFilter::bits() const noexcept { return filter_bits; }
+
+double BloomFilter::fill_ratio() const {
+  if (size() == 0)
+    return 0;
+  return static_cast<double>(filter_bits.weight()) /
+         static_cast<double>(size());
+}
+
+// -- hashing --
+
+uint64_t BloomFilter::key_hash(uint64_t key) const noexcept {
+  // murmur3 finaliser over the seeded key: a bijection, so distinct keys
+  // never share a hash
+  uint64_t h = key ^ (0x9e3779b97f4a7c15u * (hash_seed + 1));
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdu;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53u;
+  h ^= h >> 33;
+  return h;
+}
+
+// -- probes --
+
+void BloomFilter::insert(uint64_t key) {
+  if (size() == 0)
+    throw std::runtime_error("Bloom filter has no blocks");
+  filter_bits.detach();
+  uint64_t hash = key_hash(key);
+  set_block(filter_bits.data.get() +
+                block_index(hash, block_count()) * BLOCK_WORDS,
+            hash);
+}
+
+bool BloomFilter::may_contain(uint64_t key) const {
+  if (size() == 0)
+    return false;
+  uint64_t hash = key_hash(key);
+  std::vector<word_t> scratch;
+  return test_block(filter_bits.words(scratch) +
+                        block_index(hash, block_count()) * BLOCK_WORDS,
+                    hash);
+}
+
+void BloomFilter::insert(std::span<const uint64_t> keys) {
+  if (keys.empty())
+    return;
+  if (size() == 0)
+    throw std::runtime_error("Bloom filter has no blocks");
+  filter_bits.detach();
+  word_t *base = filter_bits.data.get();
+  uint64_t blocks = block_count();
+  uint64_t hashes[BATCH_KEYS];
+  word_t *targets[BATCH_KEYS];
+  for (size_t i = 0; i < keys.size(); i += BATCH_KEYS) {
+    size_t len = std::min(BATCH_KEYS, keys.size() - i);
+    for (size_t k = 0; k < len; ++k) {
+      hashes[k] = key_hash(keys[i + k]);
+      targets[k] = base + block_index(hashes[k], blocks) * BLOCK_WORDS;
+      prefetch_write(targets[k]);
+    }
+    for (size_t k = 0; k < len; ++k)
+      set_block(targets[k], hashes[k]);
+  }
+}
+
+BitVector BloomFilter::may_contain(std::span<const uint64_t> keys) const {
+  BitVector found(keys.size());
+  if (size() == 0)
+    return found;
+  std::vector<word_t> scratch;
+  const word_t *base = filter_bits.words(scratch);
+  uint64_t blocks = block_count();
+  uint64_t hashes[BATCH_KEYS];
+  const word_t *targets[BATCH_KEYS];
+  // BATCH_KEYS divides 64, so a batch fills part of one result word
+  static_assert(BITS_PER_WORD % BATCH_KEYS == 0);
+  for (size_t i = 0; i < keys.size(); i += BATCH_KEYS) {
+    size_t len = std::min(BATCH_KEYS, keys.size() - i);
+    for (size_t k = 0; k < len; ++k) {
+      hashes[k] = key_hash(keys[i + k]);
+      targets[k] = base + block_index(hashes[k], blocks) * BLOCK_WORDS;
+      prefetch_read(targets[k]);
+    }
+    word_t hits = 0;
+    for (size_t k = 0; k < len; ++k)
+      hits |= word_t(test_block(targets[k], hashes[k])) << k;
+    found.data[i / BITS_PER_WORD] |= hits << (i % BITS_PER_WORD);
+  }
+  return found;
+}
+
+void BloomFilter::clear() { filter_bits.setAll(false); }
+
+// -- union --
+
+void BloomFilter::check_compatible(const BloomFilter &rhs) const {
+  if (size() != rhs.size() || hash_seed != rhs.hash_seed)
+    throw std::invalid_argument("Bloom filters differ in size or seed");
+}
+
+BloomFilter BloomFilter::operator|(const BloomFilter &rhs) const {
+  BloomFilter out(*this);
+  out |= rhs;
+  return out;
+}
+
+BloomFilter &BloomFilter::operator|=(const BloomFilter &rhs) {
+  check_compatible(rhs);
+  filter_bits |= rhs.filter_bits;
+  return *this;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// Cache-line blocked Bloom filter over BitVector words.
+// The bits are cut into blocks of one cache line (8 words). A key picks one
+// block from its hash and sets or tests one bit in each of the block's
+// words, the bit chosen by eight multiplicative hashes of the low hash
+// half, so every probe costs a single cache miss instead of one per hash.
+// The batched insert / may_contain hash a group of keys and prefetch their
+// blocks before touching any of them, keeping many misses in flight.
+// Keys are 64-bit values; hash anything else first (std::hash, hash_words).
+// Filters of the same size and seed combine with |.
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "bitvector.hpp"
+
+class BloomFilter {
+public:
+  static constexpr size_t BLOCK_WORDS = WORD_ALIGNMENT / sizeof(word_t);
+  static constexpr size_t BLOCK_BITS = BLOCK_WORDS * BITS_PER_WORD; // 512
+  static constexpr size_t HASHES = BLOCK_WORDS; // bits set per key
+
+  // Constructors. bits is rounded up to whole blocks (at least one).
+  BloomFilter() = default;
+  explicit BloomFilter(size_t bits, uint64_t seed = 0);
+  // Sized so that keys inserted keys give about false_positive_rate with
+  // HASHES hashes; the blocking costs a little on top of that estimate.
+  // std::invalid_argument unless 0 < false_positive_rate < 1.
+  static BloomFilter for_capacity(size_t keys, double false_positive_rate,
+                                  uint64_t seed = 0);
+
+  size_t size() const noexcept; // bits
+  size_t block_count() const noexcept;
+  uint64_t seed() const noexcept;
+  const BitVector &bits() const noexcept;
+  // Share of set bits, a gauge of how full the filter is
+  double fill_ratio() const;
+
+  // -- single keys --
+  void insert(uint64_t key);
+  bool may_contain(uint64_t key) const;
+
+  // -- batches (prefetched) --
+  void insert(std::span<const uint64_t> keys);
+  // bit i answers keys[i]
+  BitVector may_contain(std::span<const uint64_t> keys) const;
+
+  void clear();
+
+  // union (std::invalid_argument unless size and seed match)
+  BloomFilter operator|(const BloomFilter &rhs) const;
+  BloomFilter &operator|=(const BloomFilter &rhs);
+
+private:
+  uint64_t key_hash(uint64_t key) const noexcept;
+  void check_compatible(const BloomFilter &rhs) const;
+
+  BitVector filter_bits;
+  uint64_t hash_seed = 0;
+};
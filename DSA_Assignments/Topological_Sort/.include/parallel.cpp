@@ -0,0 +1,128 @@
+#include "parallel.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// One parallel_chunks call. Lives on the caller's stack; the caller waits
+// until no worker holds it any more.
+struct Job {
+  const std::function<void(size_t)> *task;
+  size_t chunks;
+  std::atomic<size_t> next{0};
+  size_t active = 0; // workers inside, guarded by the pool mutex
+};
+
+thread_local bool in_task = false;
+
+// Claims chunks until none are left
+void drain(Job &job) {
+  in_task = true;
+  for (size_t c; (c = job.next.fetch_add(1)) < job.chunks;)
+    (*job.task)(c);
+  in_task = false;
+}
+
+class ThreadPool {
+public:
+  explicit ThreadPool(size_t threads) {
+    for (size_t i = 1; i < threads; ++i)
+      workers.emplace_back([this] { worker_loop(); });
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lk(m);
+      stop = true;
+    }
+    cv_work.notify_all();
+    for (std::thread &t : workers)
+      t.join();
+  }
+
+  size_t threads() const noexcept { return workers.size() + 1; }
+
+  void run(size_t chunks, const std::function<void(size_t)> &task) {
+    std::lock_guard<std::mutex> one_job(run_mutex);
+    Job job{&task, chunks};
+    {
+      std::lock_guard<std::mutex> lk(m);
+      current = &job;
+      ++generation;
+    }
+    cv_work.notify_all();
+    drain(job);
+    std::unique_lock<std::mutex> lk(m);
+    current = nullptr; // no new worker may join
+    cv_done.wait(lk, [&] { return job.active == 0; });
+  }
+
+private:
+  void worker_loop() {
+    size_t seen = 0;
+    std::unique_lock<std::mutex> lk(m);
+    while (true) {
+      cv_work.wait(lk, [&] {
+        return stop || (current != nullptr && generation != seen);
+      });
+      if (stop)
+        return;
+      seen = generation;
+      Job *job = current;
+      ++job->active;
+      lk.unlock();
+      drain(*job);
+      lk.lock();
+      if (--job->active == 0)
+        cv_done.notify_all();
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::mutex run_mutex; // one job at a time
+  std::mutex m;
+  std::condition_variable cv_work, cv_done;
+  Job *current = nullptr;
+  size_t generation = 0;
+  bool stop = false;
+};
+
+size_t configured_threads() {
+  if (const char *env = std::getenv("BITVECTOR_THREADS")) {
+    try {
+      size_t n = std::stoul(env);
+      if (n != 0)
+        return n;
+    } catch (const std::exception &) {
+      // fall through to the hardware default
+    }
+  }
+  size_t hw = std::thread::hardware_concurrency();
+  return hw != 0 ? hw : 1;
+}
+
+ThreadPool &pool() {
+  static ThreadPool p(configured_threads()); // started on first use
+  return p;
+}
+
+} // namespace
+
+size_t parallel_threads() { return pool().threads(); }
+
+void parallel_chunks(size_t chunks, const std::function<void(size_t)> &task) {
+  if (chunks == 0)
+    return;
+  if (chunks == 1 || in_task || pool().threads() == 1) {
+    for (size_t c = 0; c < chunks; ++c)
+      task(c);
+    return;
+  }
+  pool().run(chunks, task);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+// Thread pool behind the bulk BitVector / BitMatrix operations.
+// Work is cut into chunks of a fixed number of words, independent of the
+// thread count, and partial results are combined in chunk order, so every
+// result is the same on 1 or 64 threads. Vectors below PARALLEL_MIN_WORDS
+// never leave the calling thread.
+// The pool has std::thread::hardware_concurrency() - 1 workers (the caller
+// is the last thread); the BITVECTOR_THREADS environment variable overrides
+// the total.
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+static constexpr size_t PARALLEL_MIN_WORDS = size_t(1) << 17;   // 1 MiB
+static constexpr size_t PARALLEL_GRAIN_WORDS = size_t(1) << 15; // 256 KiB
+
+// Threads that take part in a parallel operation (workers + caller)
+size_t parallel_threads();
+
+// Calls task(c) for every c in [0, chunks) and returns when all are done.
+// Runs inline for a single chunk, without workers, or when called from
+// inside another task. task must not throw.
+void parallel_chunks(size_t chunks, const std::function<void(size_t)> &task);
+
+// -- word ranges --
+
+inline size_t parallel_chunk_count(size_t nwords) {
+  return (nwords + PARALLEL_GRAIN_WORDS - 1) / PARALLEL_GRAIN_WORDS;
+}
+
+// body(begin, end) over consecutive word ranges covering [0, nwords)
+template <class F> void parallel_words(size_t nwords, F &&body) {
+  if (nwords < PARALLEL_MIN_WORDS) {
+    body(size_t(0), nwords);
+    return;
+  }
+  parallel_chunks(parallel_chunk_count(nwords), [&](size_t c) {
+    size_t begin = c * PARALLEL_GRAIN_WORDS;
+    body(begin, std::min(nwords, begin + PARALLEL_GRAIN_WORDS));
+  });
+}
+
+// Sum of part(begin, end) over the same ranges, added in range order
+template <class F> size_t parallel_sum_words(size_t nwords, F &&part) {
+  if (nwords < PARALLEL_MIN_WORDS)
+    return part(size_t(0), nwords);
+  size_t chunks = parallel_chunk_count(nwords);
+  std::vector<size_t> partial(chunks);
+  parallel_chunks(chunks, [&](size_t c) {
+    size_t begin = c * PARALLEL_GRAIN_WORDS;
+    partial[c] = part(begin, std::min(nwords, begin + PARALLEL_GRAIN_WORDS));
+  });
+  size_t sum = 0;
+  for (size_t p : partial)
+    sum += p;
+  return sum;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// Word popcount engine used by BitVector::weight().
+// The kernel (scalar popcnt, AVX2 Harley-Seal or AVX-512 VPOPCNTQ) is picked
+// once at runtime from the CPU features.
+
+#include <cstddef>
+#include <cstdint>
+
+// Number of set bits in words[0 .. n)
+size_t popcount_words(const uint64_t *words, size_t n);
+
+// Name of the selected kernel: "generic", "popcnt", "avx2" or "avx512"
+const char *popcount_kernel();
@@ -0,0 +1,27 @@
+#pragma once
+
+// Software prefetch hints for the random-access batch paths (Bloom filter
+// probes, BitVector::set_bits / test_bits, BitMatrix::set_cells).
+// Hints only: a no-op where __builtin_prefetch is missing.
+
+#include <cstddef>
+
+// Indices a streaming loop prefetches ahead of the one it updates: far
+// enough to cover a memory miss, close enough that the lines stay cached
+static constexpr size_t PREFETCH_AHEAD = 16;
+
+inline void prefetch_read(const void *p) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(p, 0);
+#else
+  (void)p;
+#endif
+}
+
+inline void prefetch_write(const void *p) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(p, 1);
+#else
+  (void)p;
+#endif
+}
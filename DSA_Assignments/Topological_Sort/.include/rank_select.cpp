@@ -0,0 +1,114 @@
+#include "rank_select.hpp"
+#include "popcount.hpp"
+
+#include <algorithm> // std::min
+#include <bit>
+
+// -- superblock entry layout --
+// bits  0..31  set bits before the superblock, relative to its region
+// bits 32..61  counts of blocks 0, 1 and 2 (10 bits each, at most 512)
+
+static constexpr uint64_t REL_MASK = 0xffffffffu;
+static constexpr uint64_t COUNT_MASK = 0x3ff;
+
+static uint64_t block_count(uint64_t entry, size_t b) {
+  return (entry >> (32 + 10 * b)) & COUNT_MASK;
+}
+
+size_t select_in_word(uint64_t w, size_t k) {
+  // Halve the window until it is one bit wide
+  size_t pos = 0;
+  for (unsigned width = 32; width != 0; width /= 2) {
+    uint64_t low = w & ((uint64_t(1) << width) - 1);
+    size_t cnt = static_cast<size_t>(std::popcount(low));
+    if (k >= cnt) {
+      k -= cnt;
+      w >>= width;
+      pos += width;
+    } else {
+      w = low;
+    }
+  }
+  return pos;
+}
+
+RankSelect::RankSelect(const uint64_t *words, size_t nwords)
+    : nsupers((nwords + SUPER_WORDS - 1) / SUPER_WORDS) {
+  supers.reserve(nsupers + 1);
+  regions.reserve(nsupers / REGION_SUPERS + 1);
+  size_t next_sample = 0;
+  for (size_t s = 0; s <= nsupers; ++s) {
+    if (s % REGION_SUPERS == 0)
+      regions.push_back(total);
+    uint64_t entry = total - regions.back();
+    size_t super_count = 0;
+    for (size_t b = 0; b < SUPER_WORDS / BLOCK_WORDS; ++b) {
+      size_t begin = std::min(nwords, s * SUPER_WORDS + b * BLOCK_WORDS);
+      size_t end = std::min(nwords, begin + BLOCK_WORDS);
+      size_t cnt = popcount_words(words + begin, end - begin);
+      if (b < 3)
+        entry |= uint64_t(cnt) << (32 + 10 * b);
+      super_count += cnt;
+    }
+    supers.push_back(entry);
+    // Every sample that falls in this superblock points at it
+    for (; next_sample < total + super_count; next_sample += SELECT_SAMPLE)
+      samples.push_back(static_cast<uint32_t>(s));
+    total += super_count;
+  }
+}
+
+size_t RankSelect::ones_before(size_t super) const noexcept {
+  return regions[super / REGION_SUPERS] + (supers[super] & REL_MASK);
+}
+
+size_t RankSelect::rank1(const uint64_t *words, size_t i) const {
+  size_t s = i / (SUPER_WORDS * 64);
+  uint64_t entry = supers[s];
+  size_t r = ones_before(s);
+  size_t b = (i / (BLOCK_WORDS * 64)) % (SUPER_WORDS / BLOCK_WORDS);
+  for (size_t j = 0; j < b; ++j)
+    r += block_count(entry, j);
+  size_t w = i / 64;
+  for (size_t x = s * SUPER_WORDS + b * BLOCK_WORDS; x < w; ++x)
+    r += static_cast<size_t>(std::popcount(words[x]));
+  if (i % 64 != 0)
+    r += static_cast<size_t>(
+        std::popcount(words[w] & ((uint64_t(1) << (i % 64)) - 1)));
+  return r;
+}
+
+size_t RankSelect::select1(const uint64_t *words, size_t k) const {
+  // The answer's superblock lies between two consecutive samples
+  size_t j = k / SELECT_SAMPLE;
+  size_t lo = samples[j];
+  size_t hi = j + 1 < samples.size() ? samples[j + 1] : nsupers - 1;
+  while (lo < hi) { // last superblock with ones_before <= k
+    size_t mid = lo + (hi - lo + 1) / 2;
+    if (ones_before(mid) <= k)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+
+  size_t rem = k - ones_before(lo);
+  uint64_t entry = supers[lo];
+  size_t b = 0;
+  for (; b < 3 && rem >= block_count(entry, b); ++b)
+    rem -= block_count(entry, b);
+
+  size_t w = lo * SUPER_WORDS + b * BLOCK_WORDS;
+  while (true) {
+    size_t cnt = static_cast<size_t>(std::popcount(words[w]));
+    if (rem < cnt)
+      return w * 64 + select_in_word(words[w], rem);
+    rem -= cnt;
+    ++w;
+  }
+}
+
+size_t RankSelect::bytes() const noexcept {
+  return regions.capacity() * sizeof(uint64_t) +
+         supers.capacity() * sizeof(uint64_t) +
+         samples.capacity() * sizeof(uint32_t);
+}
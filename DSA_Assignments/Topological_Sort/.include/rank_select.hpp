@@ -0,0 +1,45 @@
+#pragma once
+
+// Rank/select index over a word array, in the style of Poppy:
+//   - one 64-bit entry per 2048-bit superblock holds the set bits before it
+//     (relative to a 2^32-bit region) and the counts of its first three
+//     512-bit blocks (10 bits each); 3.1% of the bit vector;
+//   - one 64-bit region base per 2^32 bits;
+//   - the superblock of every SELECT_SAMPLE-th set bit, for select1.
+// rank1 is two table reads plus at most seven popcounts; select1 is a short
+// binary search between two samples, then blocks and words.
+// The index does not own the words and must be rebuilt when they change.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class RankSelect {
+public:
+  static constexpr size_t SUPER_WORDS = 32; // 2048 bits
+  static constexpr size_t BLOCK_WORDS = 8;  // 512 bits
+  static constexpr size_t REGION_SUPERS = size_t(1) << 21; // 2^32 bits
+  static constexpr size_t SELECT_SAMPLE = 8192;
+
+  RankSelect(const uint64_t *words, size_t nwords);
+
+  // Set bits in bits [0, i), i <= 64 * nwords
+  size_t rank1(const uint64_t *words, size_t i) const;
+  // Position of the k-th set bit (k from 0), k < ones()
+  size_t select1(const uint64_t *words, size_t k) const;
+
+  size_t ones() const noexcept { return total; }
+  size_t bytes() const noexcept;
+
+private:
+  size_t ones_before(size_t super) const noexcept;
+
+  std::vector<uint64_t> regions; // set bits before each 2^32-bit region
+  std::vector<uint64_t> supers;  // one entry per superblock, plus a sentinel
+  std::vector<uint32_t> samples; // superblock of set bit j * SELECT_SAMPLE
+  size_t nsupers = 0;
+  size_t total = 0;
+};
+
+// Position of the k-th set bit of w (k from 0, k < popcount(w))
+size_t select_in_word(uint64_t w, size_t k);
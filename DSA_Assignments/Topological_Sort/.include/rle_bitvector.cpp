@@ -0,0 +1,200 @@
+#include "rle_bitvector.hpp"
+
+#include <algorithm> // std::min, std::upper_bound
+#include <bit>
+#include <iterator> // std::prev
+#include <stdexcept>
+
+// -- word scan --
+
+// First index >= from whose bit equals value, n when there is none.
+// Uniform words are skipped whole.
+static size_t next_with_value(const word_t *words, size_t n, size_t from,
+                              bool value) {
+  if (from >= n)
+    return n;
+  size_t w = from / BITS_PER_WORD;
+  word_t flip = value ? 0 : ~word_t(0);
+  word_t x = (words[w] ^ flip) & (~word_t(0) << (from % BITS_PER_WORD));
+  size_t nwords = BitVector::words_for_bits(n);
+  while (x == 0) {
+    if (++w == nwords)
+      return n;
+    x = words[w] ^ flip;
+  }
+  return std::min(n, w * BITS_PER_WORD +
+                         static_cast<size_t>(std::countr_zero(x)));
+}
+
+// -- constructors --
+
+RleBitVector::RleBitVector(size_t size, bool value) : nbits(size) {
+  if (value && size != 0)
+    run_list.push_back({0, size});
+}
+
+RleBitVector::RleBitVector(const BitVector &bv) : nbits(bv.size()) {
+  std::vector<word_t> scratch;
+  const word_t *words = bv.words(scratch);
+  size_t start = next_with_value(words, nbits, 0, true);
+  while (start < nbits) {
+    size_t end = next_with_value(words, nbits, start, false);
+    run_list.push_back({start, end});
+    start = next_with_value(words, nbits, end, true);
+  }
+}
+
+BitVector RleBitVector::toBitVector() const {
+  BitVector out(nbits, false);
+  for (const Run &r : run_list)
+    out.setRange(r.start, r.end - r.start, true);
+  return out;
+}
+
+// -- access --
+
+void RleBitVector::check_index(size_t i) const {
+  if (i >= nbits)
+    throw std::out_of_range("Index");
+}
+
+size_t RleBitVector::size() const noexcept { return nbits; }
+
+bool RleBitVector::get(size_t i) const {
+  check_index(i);
+  // last run starting at or before i
+  auto it = std::upper_bound(
+      run_list.begin(), run_list.end(), i,
+      [](size_t x, const Run &r) { return x < r.start; });
+  return it != run_list.begin() && i < std::prev(it)->end;
+}
+
+bool RleBitVector::operator[](size_t i) const { return get(i); }
+
+void RleBitVector::set(size_t i, bool value) {
+  check_index(i);
+  setRange(i, 1, value);
+}
+
+void RleBitVector::setRange(size_t i, size_t k, bool value) {
+  if (k == 0)
+    return;
+  if (i + k > nbits)
+    throw std::out_of_range("Range out of bounds");
+  run_list = merge_runs(run_list, {{i, i + k}}, nbits, value ? '|' : '-');
+}
+
+size_t RleBitVector::weight() const noexcept {
+  size_t cnt = 0;
+  for (const Run &r : run_list)
+    cnt += r.end - r.start;
+  return cnt;
+}
+
+size_t RleBitVector::find_first() const noexcept {
+  return run_list.empty() ? npos : run_list.front().start;
+}
+
+const std::vector<RleBitVector::Run> &RleBitVector::runs() const noexcept {
+  return run_list;
+}
+
+size_t RleBitVector::run_count() const noexcept { return run_list.size(); }
+
+size_t RleBitVector::memoryUsage() const noexcept {
+  return run_list.capacity() * sizeof(Run);
+}
+
+// -- run merge --
+
+std::vector<RleBitVector::Run>
+RleBitVector::merge_runs(const std::vector<Run> &a, const std::vector<Run> &b,
+                         size_t nbits, char op) {
+  std::vector<Run> out;
+  size_t i = 0, j = 0;
+  size_t pos = 0;
+  // Each step covers [pos, next) where neither input changes value
+  while (pos < nbits) {
+    bool in_a = i < a.size() && a[i].start <= pos;
+    bool in_b = j < b.size() && b[j].start <= pos;
+    size_t next = nbits;
+    if (i < a.size())
+      next = std::min(next, in_a ? a[i].end : a[i].start);
+    if (j < b.size())
+      next = std::min(next, in_b ? b[j].end : b[j].start);
+
+    bool bit = false;
+    switch (op) {
+    case '&':
+      bit = in_a && in_b;
+      break;
+    case '|':
+      bit = in_a || in_b;
+      break;
+    case '^':
+      bit = in_a != in_b;
+      break;
+    case '-':
+      bit = in_a && !in_b;
+      break;
+    }
+    if (bit) {
+      if (!out.empty() && out.back().end == pos)
+        out.back().end = next; // extend rather than touch
+      else
+        out.push_back({pos, next});
+    }
+
+    pos = next;
+    if (in_a && a[i].end == pos)
+      ++i;
+    if (in_b && b[j].end == pos)
+      ++j;
+  }
+  return out;
+}
+
+// -- set algebra --
+
+RleBitVector RleBitVector::operator&(const RleBitVector &rhs) const {
+  RleBitVector out(*this);
+  out &= rhs;
+  return out;
+}
+
+RleBitVector RleBitVector::operator|(const RleBitVector &rhs) const {
+  RleBitVector out(*this);
+  out |= rhs;
+  return out;
+}
+
+RleBitVector RleBitVector::operator^(const RleBitVector &rhs) const {
+  RleBitVector out(*this);
+  out ^= rhs;
+  return out;
+}
+
+RleBitVector RleBitVector::operator~() const {
+  RleBitVector out(nbits);
+  out.run_list = merge_runs({{0, nbits}}, run_list, nbits, '-');
+  return out;
+}
+
+RleBitVector &RleBitVector::operator&=(const RleBitVector &rhs) {
+  run_list = merge_runs(run_list, rhs.run_list, nbits, '&');
+  return *this;
+}
+
+RleBitVector &RleBitVector::operator|=(const RleBitVector &rhs) {
+  run_list = merge_runs(run_list, rhs.run_list, nbits, '|');
+  return *this;
+}
+
+RleBitVector &RleBitVector::operator^=(const RleBitVector &rhs) {
+  run_list = merge_runs(run_list, rhs.run_list, nbits, '^');
+  return *this;
+}
+
+bool RleBitVector::operator==(const RleBitVector &rhs) const {
+  return nbits == rhs.nbits && run_list == rhs.run_list;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// Run-length encoded bit vector for bits that come in long uniform runs
+// (cleared matrix rows, activity masks over time).
+// Only the runs of 1s are stored, as sorted, disjoint, non-adjacent
+// [start, end) intervals, so memory, weight() and every boolean operator
+// are O(runs) whatever the length: &, |, ^ sweep both run lists at once and
+// never expand to words. get() is a binary search; set() and setRange()
+// rebuild the list around the change.
+// Same surface as RoaringBitmap, including conversion to and from BitVector.
+
+#include <cstddef>
+#include <vector>
+
+#include "bitvector.hpp"
+
+class RleBitVector {
+public:
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  struct Run {
+    size_t start;
+    size_t end; // exclusive
+    bool operator==(const Run &) const = default;
+  };
+
+  // Constructors (size bits, all value / copy of a dense vector)
+  RleBitVector() = default;
+  explicit RleBitVector(size_t size, bool value = false);
+  explicit RleBitVector(const BitVector &bv);
+
+  BitVector toBitVector() const;
+
+  // length and value
+  size_t size() const noexcept;
+  bool get(size_t i) const;
+  void set(size_t i, bool value);
+  void setRange(size_t i, size_t k, bool value); // bits [i, i + k)
+  bool operator[](size_t i) const;
+  size_t weight() const noexcept;
+  size_t find_first() const noexcept;
+
+  // the runs of 1s, in increasing order
+  const std::vector<Run> &runs() const noexcept;
+  size_t run_count() const noexcept;
+
+  // set algebra (result has the left operand's length)
+  RleBitVector operator&(const RleBitVector &rhs) const;
+  RleBitVector operator|(const RleBitVector &rhs) const;
+  RleBitVector operator^(const RleBitVector &rhs) const;
+  RleBitVector operator~() const;
+  RleBitVector &operator&=(const RleBitVector &rhs);
+  RleBitVector &operator|=(const RleBitVector &rhs);
+  RleBitVector &operator^=(const RleBitVector &rhs);
+
+  bool operator==(const RleBitVector &rhs) const;
+
+  // Bytes held by the run list (without the object itself)
+  size_t memoryUsage() const noexcept;
+
+private:
+  // One sweep over both lists; op is '&', '|', '^' or '-' (a & ~b).
+  // Runs of b past nbits are ignored.
+  static std::vector<Run> merge_runs(const std::vector<Run> &a,
+                                     const std::vector<Run> &b, size_t nbits,
+                                     char op);
+
+  void check_index(size_t i) const;
+
+  std::vector<Run> run_list; // sorted, disjoint, never adjacent
+  size_t nbits = 0;
+};
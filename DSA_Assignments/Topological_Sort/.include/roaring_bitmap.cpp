@@ -0,0 +1,458 @@
+#include "roaring_bitmap.hpp"
+#include "popcount.hpp"
+
+#include <algorithm> // std::lower_bound, std::set_*
+#include <bit>
+#include <iterator> // std::back_inserter
+#include <stdexcept>
+#include <utility>
+
+// -- container kernels --
+
+bool RoaringBitmap::container_get(const Container &c, uint16_t v) {
+  switch (c.kind) {
+  case Container::Kind::Array:
+    return std::binary_search(c.values.begin(), c.values.end(), v);
+  case Container::Kind::Bitmap:
+    return (c.bits[v / BITS_PER_WORD] >> (v % BITS_PER_WORD)) & 1u;
+  case Container::Kind::Run: {
+    // last run starting at or before v
+    auto it = std::upper_bound(
+        c.runs.begin(), c.runs.end(), v,
+        [](uint16_t x, const Run &r) { return x < r.start; });
+    return it != c.runs.begin() && v <= std::prev(it)->last;
+  }
+  }
+  return false;
+}
+
+std::vector<word_t> RoaringBitmap::container_words(const Container &c) {
+  if (c.kind == Container::Kind::Bitmap)
+    return c.bits;
+  std::vector<word_t> bits(CHUNK_WORDS, 0);
+  for (uint16_t v : container_values(c))
+    bits[v / BITS_PER_WORD] |= word_t(1) << (v % BITS_PER_WORD);
+  return bits;
+}
+
+std::vector<uint16_t> RoaringBitmap::container_values(const Container &c) {
+  std::vector<uint16_t> values;
+  switch (c.kind) {
+  case Container::Kind::Array:
+    return c.values;
+  case Container::Kind::Bitmap:
+    values.reserve(c.card);
+    for (size_t w = 0; w < CHUNK_WORDS; ++w) {
+      word_t word = c.bits[w];
+      while (word) {
+        values.push_back(static_cast<uint16_t>(
+            w * BITS_PER_WORD + static_cast<size_t>(std::countr_zero(word))));
+        word &= word - 1;
+      }
+    }
+    break;
+  case Container::Kind::Run:
+    values.reserve(c.card);
+    for (const Run &r : c.runs)
+      for (uint32_t v = r.start; v <= r.last; ++v)
+        values.push_back(static_cast<uint16_t>(v));
+    break;
+  }
+  return values;
+}
+
+// Bitmap above ARRAY_MAX set bits, array otherwise
+RoaringBitmap::Container
+RoaringBitmap::container_from_words(std::vector<word_t> bits) {
+  Container c;
+  c.card = static_cast<uint32_t>(popcount_words(bits.data(), bits.size()));
+  c.kind = Container::Kind::Bitmap;
+  c.bits = std::move(bits);
+  if (c.card <= ARRAY_MAX) {
+    c.values = container_values(c); // read back from the bitmap
+    c.bits = {};
+    c.kind = Container::Kind::Array;
+  }
+  return c;
+}
+
+// values must be sorted and unique
+RoaringBitmap::Container
+RoaringBitmap::container_from_values(std::vector<uint16_t> values) {
+  if (values.size() > ARRAY_MAX) {
+    std::vector<word_t> bits(CHUNK_WORDS, 0);
+    for (uint16_t v : values)
+      bits[v / BITS_PER_WORD] |= word_t(1) << (v % BITS_PER_WORD);
+    return container_from_words(std::move(bits));
+  }
+  Container c;
+  c.card = static_cast<uint32_t>(values.size());
+  c.values = std::move(values);
+  return c;
+}
+
+void RoaringBitmap::container_set(Container &c, uint16_t v, bool value) {
+  if (c.kind == Container::Kind::Run)
+    c = container_from_values(container_values(c));
+
+  if (c.kind == Container::Kind::Array) {
+    auto it = std::lower_bound(c.values.begin(), c.values.end(), v);
+    bool present = it != c.values.end() && *it == v;
+    if (value && !present) {
+      c.values.insert(it, v);
+      if (++c.card > ARRAY_MAX)
+        c = container_from_values(std::move(c.values));
+    } else if (!value && present) {
+      c.values.erase(it);
+      --c.card;
+    }
+    return;
+  }
+
+  word_t &word = c.bits[v / BITS_PER_WORD];
+  word_t mask = word_t(1) << (v % BITS_PER_WORD);
+  if (value == static_cast<bool>(word & mask))
+    return;
+  word ^= mask;
+  if (value) {
+    ++c.card;
+  } else if (--c.card <= ARRAY_MAX) {
+    c = container_from_words(std::move(c.bits));
+  }
+}
+
+// Sorted merges for two arrays; otherwise the array side is applied to the
+// other side's words, or both sides are combined word by word
+RoaringBitmap::Container RoaringBitmap::container_op(const Container &a,
+                                                     const Container &b,
+                                                     char op) {
+  using Kind = Container::Kind;
+  if (a.kind == Kind::Array && b.kind == Kind::Array) {
+    std::vector<uint16_t> out;
+    auto sink = std::back_inserter(out);
+    switch (op) {
+    case '&':
+      std::set_intersection(a.values.begin(), a.values.end(),
+                            b.values.begin(), b.values.end(), sink);
+      break;
+    case '|':
+      std::set_union(a.values.begin(), a.values.end(), b.values.begin(),
+                     b.values.end(), sink);
+      break;
+    default:
+      std::set_symmetric_difference(a.values.begin(), a.values.end(),
+                                    b.values.begin(), b.values.end(), sink);
+      break;
+    }
+    return container_from_values(std::move(out));
+  }
+
+  if (a.kind == Kind::Array || b.kind == Kind::Array) {
+    const Container &small = a.kind == Kind::Array ? a : b;
+    const Container &other = a.kind == Kind::Array ? b : a;
+    if (op == '&') {
+      std::vector<uint16_t> out;
+      for (uint16_t v : small.values)
+        if (container_get(other, v))
+          out.push_back(v);
+      return container_from_values(std::move(out));
+    }
+    std::vector<word_t> bits = container_words(other);
+    for (uint16_t v : small.values) {
+      word_t mask = word_t(1) << (v % BITS_PER_WORD);
+      if (op == '|')
+        bits[v / BITS_PER_WORD] |= mask;
+      else
+        bits[v / BITS_PER_WORD] ^= mask;
+    }
+    return container_from_words(std::move(bits));
+  }
+
+  std::vector<word_t> bits = container_words(a);
+  std::vector<word_t> rhs = container_words(b);
+  for (size_t w = 0; w < CHUNK_WORDS; ++w) {
+    switch (op) {
+    case '&':
+      bits[w] &= rhs[w];
+      break;
+    case '|':
+      bits[w] |= rhs[w];
+      break;
+    default:
+      bits[w] ^= rhs[w];
+      break;
+    }
+  }
+  return container_from_words(std::move(bits));
+}
+
+// Keep only offsets below limit
+void RoaringBitmap::container_truncate(Container &c, uint32_t limit) {
+  switch (c.kind) {
+  case Container::Kind::Array: {
+    auto it = std::lower_bound(c.values.begin(), c.values.end(), limit);
+    c.values.erase(it, c.values.end());
+    c.card = static_cast<uint32_t>(c.values.size());
+    break;
+  }
+  case Container::Kind::Bitmap: {
+    size_t w = limit / BITS_PER_WORD;
+    if (limit % BITS_PER_WORD != 0)
+      c.bits[w++] &= (word_t(1) << (limit % BITS_PER_WORD)) - 1;
+    std::fill(c.bits.begin() + static_cast<std::ptrdiff_t>(w), c.bits.end(),
+              word_t(0));
+    c = container_from_words(std::move(c.bits));
+    break;
+  }
+  case Container::Kind::Run:
+    while (!c.runs.empty() && c.runs.back().start >= limit)
+      c.runs.pop_back();
+    if (!c.runs.empty() && c.runs.back().last >= limit)
+      c.runs.back().last = static_cast<uint16_t>(limit - 1);
+    c.card = 0;
+    for (const Run &r : c.runs)
+      c.card += uint32_t(r.last) - r.start + 1;
+    break;
+  }
+}
+
+// Runs cost 4 bytes each, array entries 2 bytes, a bitmap 8 KiB
+void RoaringBitmap::container_run_optimize(Container &c) {
+  std::vector<uint16_t> values = container_values(c);
+  std::vector<Run> runs;
+  for (uint16_t v : values) {
+    if (!runs.empty() && uint32_t(runs.back().last) + 1 == v)
+      runs.back().last = v;
+    else
+      runs.push_back({v, v});
+  }
+  size_t run_bytes = runs.size() * sizeof(Run);
+  size_t plain_bytes = c.card > ARRAY_MAX ? CHUNK_WORDS * sizeof(word_t)
+                                          : c.card * sizeof(uint16_t);
+  if (run_bytes < plain_bytes) {
+    uint32_t card = c.card;
+    c = Container{};
+    c.kind = Container::Kind::Run;
+    c.card = card;
+    c.runs = std::move(runs);
+  } else if (c.kind == Container::Kind::Run) {
+    c = container_from_values(std::move(values));
+  }
+}
+
+bool RoaringBitmap::container_equal(const Container &a, const Container &b) {
+  if (a.card != b.card)
+    return false;
+  if (a.kind == b.kind) {
+    switch (a.kind) {
+    case Container::Kind::Array:
+      return a.values == b.values;
+    case Container::Kind::Bitmap:
+      return a.bits == b.bits;
+    case Container::Kind::Run:
+      return std::equal(a.runs.begin(), a.runs.end(), b.runs.begin(),
+                        b.runs.end(), [](const Run &x, const Run &y) {
+                          return x.start == y.start && x.last == y.last;
+                        });
+    }
+  }
+  return container_values(a) == container_values(b);
+}
+
+// -- private helpers --
+
+void RoaringBitmap::check_index(size_t i) const {
+  if (i >= nbits)
+    throw std::out_of_range("Index");
+}
+
+void RoaringBitmap::trim() {
+  size_t key_limit = nbits >> 16;
+  uint32_t low = static_cast<uint32_t>(nbits & (CHUNK_BITS - 1));
+  while (!chunks.empty() && (chunks.back().key > key_limit ||
+                             (chunks.back().key == key_limit && low == 0)))
+    chunks.pop_back();
+  if (!chunks.empty() && chunks.back().key == key_limit) {
+    container_truncate(chunks.back().c, low);
+    if (chunks.back().c.card == 0)
+      chunks.pop_back();
+  }
+}
+
+// Walks both sorted chunk lists once; a chunk present on one side only is
+// copied (| and ^) or dropped (&)
+RoaringBitmap RoaringBitmap::chunk_wise_op(const RoaringBitmap &rhs,
+                                           char op) const {
+  RoaringBitmap result;
+  result.nbits = nbits;
+  size_t i = 0, j = 0;
+  while (i < chunks.size() || j < rhs.chunks.size()) {
+    if (j == rhs.chunks.size() ||
+        (i < chunks.size() && chunks[i].key < rhs.chunks[j].key)) {
+      if (op != '&')
+        result.chunks.push_back(chunks[i]);
+      ++i;
+    } else if (i == chunks.size() || rhs.chunks[j].key < chunks[i].key) {
+      if (op != '&')
+        result.chunks.push_back(rhs.chunks[j]);
+      ++j;
+    } else {
+      Container c = container_op(chunks[i].c, rhs.chunks[j].c, op);
+      if (c.card != 0)
+        result.chunks.push_back({chunks[i].key, std::move(c)});
+      ++i;
+      ++j;
+    }
+  }
+  if (rhs.nbits > nbits)
+    result.trim();
+  return result;
+}
+
+// -- constructors / conversion --
+
+RoaringBitmap::RoaringBitmap(size_t size) : nbits(size) {}
+
+RoaringBitmap::RoaringBitmap(const BitVector &bv) : nbits(bv.size()) {
+  std::vector<word_t> scratch;
+  const word_t *words = bv.words(scratch);
+  size_t nwords = bv.word_count();
+  for (size_t begin = 0; begin < nwords; begin += CHUNK_WORDS) {
+    size_t count = std::min(CHUNK_WORDS, nwords - begin);
+    size_t card = popcount_words(words + begin, count);
+    if (card == 0)
+      continue;
+    std::vector<word_t> bits(CHUNK_WORDS, 0);
+    std::copy(words + begin, words + begin + count, bits.begin());
+    Chunk chunk{static_cast<uint32_t>(begin / CHUNK_WORDS),
+                container_from_words(std::move(bits))};
+    container_run_optimize(chunk.c);
+    chunks.push_back(std::move(chunk));
+  }
+}
+
+BitVector RoaringBitmap::toBitVector() const {
+  BitVector out(nbits, false);
+  for (const Chunk &chunk : chunks) {
+    size_t base = size_t(chunk.key) << 16;
+    if (chunk.c.kind == Container::Kind::Run) {
+      for (const Run &r : chunk.c.runs)
+        out.setRange(base + r.start, size_t(r.last) - r.start + 1, true);
+      continue;
+    }
+    for (uint16_t v : container_values(chunk.c))
+      out.set(base + v, true);
+  }
+  return out;
+}
+
+// -- access --
+
+size_t RoaringBitmap::size() const noexcept { return nbits; }
+
+bool RoaringBitmap::get(size_t i) const {
+  check_index(i);
+  uint32_t key = static_cast<uint32_t>(i >> 16);
+  auto it = std::lower_bound(
+      chunks.begin(), chunks.end(), key,
+      [](const Chunk &chunk, uint32_t k) { return chunk.key < k; });
+  if (it == chunks.end() || it->key != key)
+    return false;
+  return container_get(it->c, static_cast<uint16_t>(i));
+}
+
+void RoaringBitmap::set(size_t i, bool value) {
+  check_index(i);
+  uint32_t key = static_cast<uint32_t>(i >> 16);
+  auto it = std::lower_bound(
+      chunks.begin(), chunks.end(), key,
+      [](const Chunk &chunk, uint32_t k) { return chunk.key < k; });
+  if (it == chunks.end() || it->key != key) {
+    if (!value)
+      return;
+    it = chunks.insert(it, Chunk{key, Container{}});
+  }
+  container_set(it->c, static_cast<uint16_t>(i), value);
+  if (it->c.card == 0)
+    chunks.erase(it);
+}
+
+bool RoaringBitmap::operator[](size_t i) const { return get(i); }
+
+size_t RoaringBitmap::weight() const noexcept {
+  size_t cnt = 0;
+  for (const Chunk &chunk : chunks)
+    cnt += chunk.c.card;
+  return cnt;
+}
+
+size_t RoaringBitmap::find_first() const noexcept {
+  if (chunks.empty())
+    return npos;
+  const Container &c = chunks.front().c;
+  size_t base = size_t(chunks.front().key) << 16;
+  switch (c.kind) {
+  case Container::Kind::Array:
+    return base + c.values.front();
+  case Container::Kind::Run:
+    return base + c.runs.front().start;
+  case Container::Kind::Bitmap:
+    for (size_t w = 0; w < CHUNK_WORDS; ++w)
+      if (c.bits[w])
+        return base + w * BITS_PER_WORD +
+               static_cast<size_t>(std::countr_zero(c.bits[w]));
+    break;
+  }
+  return npos;
+}
+
+// -- set algebra --
+
+RoaringBitmap RoaringBitmap::operator&(const RoaringBitmap &rhs) const {
+  return chunk_wise_op(rhs, '&');
+}
+RoaringBitmap RoaringBitmap::operator|(const RoaringBitmap &rhs) const {
+  return chunk_wise_op(rhs, '|');
+}
+RoaringBitmap RoaringBitmap::operator^(const RoaringBitmap &rhs) const {
+  return chunk_wise_op(rhs, '^');
+}
+
+RoaringBitmap &RoaringBitmap::operator&=(const RoaringBitmap &rhs) {
+  *this = chunk_wise_op(rhs, '&');
+  return *this;
+}
+RoaringBitmap &RoaringBitmap::operator|=(const RoaringBitmap &rhs) {
+  *this = chunk_wise_op(rhs, '|');
+  return *this;
+}
+RoaringBitmap &RoaringBitmap::operator^=(const RoaringBitmap &rhs) {
+  *this = chunk_wise_op(rhs, '^');
+  return *this;
+}
+
+bool RoaringBitmap::operator==(const RoaringBitmap &rhs) const {
+  if (nbits != rhs.nbits || chunks.size() != rhs.chunks.size())
+    return false;
+  for (size_t i = 0; i < chunks.size(); ++i)
+    if (chunks[i].key != rhs.chunks[i].key ||
+        !container_equal(chunks[i].c, rhs.chunks[i].c))
+      return false;
+  return true;
+}
+
+// -- maintenance --
+
+void RoaringBitmap::runOptimize() {
+  for (Chunk &chunk : chunks)
+    container_run_optimize(chunk.c);
+}
+
+size_t RoaringBitmap::memoryUsage() const noexcept {
+  size_t bytes = chunks.capacity() * sizeof(Chunk);
+  for (const Chunk &chunk : chunks)
+    bytes += chunk.c.values.capacity() * sizeof(uint16_t) +
+             chunk.c.bits.capacity() * sizeof(word_t) +
+             chunk.c.runs.capacity() * sizeof(Run);
+  return bytes;
+}
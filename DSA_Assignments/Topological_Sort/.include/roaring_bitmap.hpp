@@ -0,0 +1,101 @@
+#pragma once
+
+// Compressed bitmap for very sparse (or very clustered) bit vectors.
+// The index space is cut into chunks of 2^16 bits; only non-empty chunks are
+// stored, each in the cheapest of three containers:
+//   array   sorted 16-bit offsets, up to ARRAY_MAX set bits
+//   bitmap  1024 words, above ARRAY_MAX set bits
+//   run     sorted [start, last] intervals (chosen by runOptimize())
+// &, |, ^ combine chunk by chunk and never expand the whole bitmap.
+// Same surface as BitVector: get/set, weight, set algebra, find_first,
+// for_each_set_bit, and lossless conversion to and from BitVector.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bitvector.hpp"
+
+class RoaringBitmap {
+public:
+  static constexpr size_t CHUNK_BITS = size_t(1) << 16;
+  static constexpr size_t CHUNK_WORDS = CHUNK_BITS / BITS_PER_WORD; // 1024
+  static constexpr uint32_t ARRAY_MAX = 4096; // 8 KiB either way
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  // Constructors (size bits, all zero / copy of a dense vector)
+  RoaringBitmap() = default;
+  explicit RoaringBitmap(size_t size);
+  explicit RoaringBitmap(const BitVector &bv);
+
+  BitVector toBitVector() const;
+
+  // length and value
+  size_t size() const noexcept;
+  bool get(size_t i) const;
+  void set(size_t i, bool value);
+  bool operator[](size_t i) const;
+  size_t weight() const noexcept;
+  size_t find_first() const noexcept;
+
+  // visit(i) for every set bit i, in increasing order
+  template <class F> void for_each_set_bit(F &&visit) const;
+
+  // set algebra (result has the left operand's length)
+  RoaringBitmap operator&(const RoaringBitmap &rhs) const;
+  RoaringBitmap operator|(const RoaringBitmap &rhs) const;
+  RoaringBitmap operator^(const RoaringBitmap &rhs) const;
+  RoaringBitmap &operator&=(const RoaringBitmap &rhs);
+  RoaringBitmap &operator|=(const RoaringBitmap &rhs);
+  RoaringBitmap &operator^=(const RoaringBitmap &rhs);
+
+  bool operator==(const RoaringBitmap &rhs) const;
+
+  // Re-encode every chunk as a run container where that is smaller
+  void runOptimize();
+
+  // Bytes held by the containers (without the object itself)
+  size_t memoryUsage() const noexcept;
+
+private:
+  struct Run {
+    uint16_t start;
+    uint16_t last; // inclusive
+  };
+
+  struct Container {
+    enum class Kind : uint8_t { Array, Bitmap, Run };
+    Kind kind = Kind::Array;
+    uint32_t card = 0;            // set bits in the chunk
+    std::vector<uint16_t> values; // Array
+    std::vector<word_t> bits;     // Bitmap, CHUNK_WORDS words
+    std::vector<Run> runs;        // Run
+  };
+
+  struct Chunk {
+    uint32_t key; // index >> 16
+    Container c;
+  };
+
+  // Container kernels (offsets are the low 16 bits of an index)
+  static bool container_get(const Container &c, uint16_t v);
+  static void container_set(Container &c, uint16_t v, bool value);
+  static std::vector<word_t> container_words(const Container &c);
+  static std::vector<uint16_t> container_values(const Container &c);
+  static Container container_from_words(std::vector<word_t> bits);
+  static Container container_from_values(std::vector<uint16_t> values);
+  static Container container_op(const Container &a, const Container &b,
+                                char op);
+  static void container_truncate(Container &c, uint32_t limit);
+  static void container_run_optimize(Container &c);
+  static bool container_equal(const Container &a, const Container &b);
+
+  void check_index(size_t i) const;
+  RoaringBitmap chunk_wise_op(const RoaringBitmap &rhs, char op) const;
+  void trim(); // drop bits at and past nbits
+
+  std::vector<Chunk> chunks; // sorted by key, no empty containers
+  size_t nbits = 0;
+};
+
+#include "roaring_bitmap.tpp"
@@ -0,0 +1,39 @@
+#ifndef ROARING_BITMAP_TPP
+#define ROARING_BITMAP_TPP
+
+#include "roaring_bitmap.hpp"
+
+#include <bit>
+#include <cstddef>
+
+// -- set-bit iteration --
+
+template <class F> void RoaringBitmap::for_each_set_bit(F &&visit) const {
+  for (const Chunk &chunk : chunks) {
+    size_t base = size_t(chunk.key) << 16;
+    const Container &c = chunk.c;
+    switch (c.kind) {
+    case Container::Kind::Array:
+      for (uint16_t v : c.values)
+        visit(base + v);
+      break;
+    case Container::Kind::Bitmap:
+      for (size_t w = 0; w < c.bits.size(); ++w) {
+        word_t word = c.bits[w];
+        while (word) {
+          visit(base + w * BITS_PER_WORD +
+                static_cast<size_t>(std::countr_zero(word)));
+          word &= word - 1;
+        }
+      }
+      break;
+    case Container::Kind::Run:
+      for (const Run &r : c.runs)
+        for (size_t v = r.start; v <= r.last; ++v)
+          visit(base + v);
+      break;
+    }
+  }
+}
+
+#endif // ROARING_BITMAP_TPP
@@ -0,0 +1,184 @@
+#include "snapshot.hpp"
+
+#include <algorithm> // std::min
+#include <bit>
+#include <cstring> // std::memcpy
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+static constexpr char SNAPSHOT_MAGIC[4] = {'B', 'I', 'T', 'S'};
+static constexpr uint8_t ORDER_LITTLE = 1;
+static constexpr uint8_t ORDER_BIG = 2;
+static constexpr uint8_t HOST_ORDER =
+    std::endian::native == std::endian::big ? ORDER_BIG : ORDER_LITTLE;
+
+// -- little endian header fields --
+
+static void put_le(unsigned char *out, uint64_t v, size_t bytes) {
+  for (size_t i = 0; i < bytes; ++i)
+    out[i] = static_cast<unsigned char>(v >> (8 * i));
+}
+
+static uint64_t get_le(const std::byte *in, size_t bytes) {
+  uint64_t v = 0;
+  for (size_t i = 0; i < bytes; ++i)
+    v |= static_cast<uint64_t>(in[i]) << (8 * i);
+  return v;
+}
+
+// -- SnapshotHeader --
+
+size_t SnapshotHeader::row_words() const noexcept {
+  return static_cast<size_t>(columns / 64 + (columns % 64 != 0));
+}
+
+size_t SnapshotHeader::total_words() const {
+  size_t per_row = row_words();
+  // The payload must be addressable in bytes on this host
+  size_t limit = static_cast<size_t>(-1) / sizeof(uint64_t);
+  if (per_row != 0 && rows > limit / per_row)
+    throw std::runtime_error("Snapshot too large");
+  return static_cast<size_t>(rows) * per_row;
+}
+
+// -- checksum --
+
+static constexpr uint64_t PRIME1 = 0x9e3779b185ebca87u;
+static constexpr uint64_t PRIME2 = 0xc2b2ae3d27d4eb4fu;
+static constexpr uint64_t PRIME3 = 0x165667b19e3779f9u;
+static constexpr uint64_t PRIME4 = 0x85ebca77c2b2ae63u;
+static constexpr uint64_t PRIME5 = 0x27d4eb2f165667c5u;
+
+static uint64_t checksum_round(uint64_t acc, uint64_t w) noexcept {
+  return std::rotl(acc + w * PRIME2, 31) * PRIME1;
+}
+
+void SnapshotChecksum::update(const uint64_t *words, size_t n) noexcept {
+  size_t i = 0;
+  // Word k always goes to lane k % 4, however the sequence is split
+  for (; i < n && count % 4 != 0; ++i, ++count)
+    lanes[count % 4] = checksum_round(lanes[count % 4], words[i]);
+  for (; i + 4 <= n; i += 4, count += 4) {
+    lanes[0] = checksum_round(lanes[0], words[i]);
+    lanes[1] = checksum_round(lanes[1], words[i + 1]);
+    lanes[2] = checksum_round(lanes[2], words[i + 2]);
+    lanes[3] = checksum_round(lanes[3], words[i + 3]);
+  }
+  for (; i < n; ++i, ++count)
+    lanes[count % 4] = checksum_round(lanes[count % 4], words[i]);
+}
+
+uint64_t SnapshotChecksum::value() const noexcept {
+  uint64_t h = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) +
+               std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+  for (uint64_t lane : lanes)
+    h = (h ^ checksum_round(0, lane)) * PRIME1 + PRIME4;
+  h += count * 8 + PRIME5;
+  h ^= h >> 33;
+  h *= PRIME2;
+  h ^= h >> 29;
+  h *= PRIME3;
+  h ^= h >> 32;
+  return h;
+}
+
+uint64_t snapshot_checksum(const uint64_t *words, size_t n) noexcept {
+  SnapshotChecksum sum;
+  sum.update(words, n);
+  return sum.value();
+}
+
+// -- header --
+
+void write_snapshot_header(std::ostream &os, const SnapshotHeader &h) {
+  unsigned char buf[SNAPSHOT_HEADER_BYTES] = {};
+  std::memcpy(buf, SNAPSHOT_MAGIC, sizeof SNAPSHOT_MAGIC);
+  put_le(buf + 4, SNAPSHOT_VERSION, 2);
+  buf[6] = sizeof(uint64_t);
+  buf[7] = HOST_ORDER;
+  put_le(buf + 8, h.rows, 8);
+  put_le(buf + 16, h.columns, 8);
+  put_le(buf + 24, h.checksum, 8);
+  os.write(reinterpret_cast<const char *>(buf), sizeof buf);
+}
+
+SnapshotHeader read_snapshot_header(std::istream &is) {
+  std::byte buf[SNAPSHOT_HEADER_BYTES];
+  if (!is.read(reinterpret_cast<char *>(buf), sizeof buf))
+    throw std::runtime_error("Truncated snapshot header");
+  return parse_snapshot_header(buf);
+}
+
+SnapshotHeader parse_snapshot_header(std::span<const std::byte> bytes) {
+  if (bytes.size() < SNAPSHOT_HEADER_BYTES)
+    throw std::runtime_error("Truncated snapshot header");
+  if (std::memcmp(bytes.data(), SNAPSHOT_MAGIC, sizeof SNAPSHOT_MAGIC) != 0)
+    throw std::runtime_error("Not a bit snapshot");
+  if (get_le(bytes.data() + 4, 2) > SNAPSHOT_VERSION)
+    throw std::runtime_error("Unsupported snapshot version");
+  if (get_le(bytes.data() + 6, 1) != sizeof(uint64_t))
+    throw std::runtime_error("Unsupported snapshot word size");
+  uint64_t order = get_le(bytes.data() + 7, 1);
+  if (order != ORDER_LITTLE && order != ORDER_BIG)
+    throw std::runtime_error("Bad snapshot byte order");
+
+  SnapshotHeader h;
+  h.rows = get_le(bytes.data() + 8, 8);
+  h.columns = get_le(bytes.data() + 16, 8);
+  h.checksum = get_le(bytes.data() + 24, 8);
+  h.foreign_order = order != HOST_ORDER;
+  // Rows without columns carry no words, so nothing would bound their count
+  if (h.columns == 0 && h.rows > 1)
+    throw std::runtime_error("Snapshot rows have no columns");
+  h.total_words(); // reject sizes this host cannot hold
+  return h;
+}
+
+// -- words --
+
+void write_snapshot_words(std::ostream &os, const uint64_t *words, size_t n) {
+  if (n != 0)
+    os.write(reinterpret_cast<const char *>(words),
+             static_cast<std::streamsize>(n * sizeof(uint64_t)));
+}
+
+void read_snapshot_words_chunked(std::istream &is, std::vector<uint64_t> &words,
+                                 size_t n, bool swap) {
+  words.clear();
+  while (words.size() < n) {
+    size_t done = words.size();
+    size_t step = std::min(SNAPSHOT_CHUNK_WORDS, n - done);
+    words.resize(done + step);
+    read_snapshot_words(is, words.data() + done, step, swap);
+  }
+}
+
+bool check_snapshot_length(std::istream &is, size_t n) {
+  std::istream::pos_type here = is.tellg();
+  if (here == std::istream::pos_type(-1))
+    return false;
+  is.seekg(0, std::ios::end);
+  std::istream::pos_type end = is.tellg();
+  is.seekg(here);
+  if (!is || end == std::istream::pos_type(-1)) {
+    is.clear();
+    is.seekg(here);
+    return false;
+  }
+  auto left = static_cast<uint64_t>(std::streamoff(end - here));
+  if (left / sizeof(uint64_t) < n)
+    throw std::runtime_error("Truncated snapshot");
+  return true;
+}
+
+void read_snapshot_words(std::istream &is, uint64_t *words, size_t n,
+                         bool swap) {
+  if (n != 0 &&
+      !is.read(reinterpret_cast<char *>(words),
+               static_cast<std::streamsize>(n * sizeof(uint64_t))))
+    throw std::runtime_error("Truncated snapshot");
+  if (swap)
+    for (size_t i = 0; i < n; ++i)
+      words[i] = std::byteswap(words[i]);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+// Binary snapshots of BitVector and BitMatrix (save / load / view).
+// A snapshot is a 32-byte header followed by the raw words:
+//
+//   offset size
+//        0    4  magic "BITS"
+//        4    2  format version (SNAPSHOT_VERSION)
+//        6    1  bytes per word (8)
+//        7    1  byte order of the words: 1 little, 2 big endian
+//        8    8  rows (1 for a BitVector)
+//       16    8  columns, i.e. bits per row; 0 only with at most one row
+//       24    8  checksum of the words (SnapshotChecksum)
+//       32       rows * ceil(columns / 64) words, row after row; the unused
+//                bits of the last word of each row are zero
+//
+// Header fields are little endian. Words are written in the writer's byte
+// order: load() swaps them when that is not the host's, view() refuses
+// them. The header size keeps the words of a mapped file 8-byte aligned.
+// Malformed or truncated input throws std::runtime_error. Header sizes are
+// not trusted for allocation: a seekable stream is checked against its
+// length first, and from any other stream words are only allocated for as
+// they arrive.
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <span>
+#include <vector>
+
+static constexpr size_t SNAPSHOT_HEADER_BYTES = 32;
+static constexpr uint16_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotHeader {
+  uint64_t rows = 0;
+  uint64_t columns = 0;
+  uint64_t checksum = 0;
+  bool foreign_order = false; // words need a byte swap on this host
+
+  size_t row_words() const noexcept;
+  size_t total_words() const; // throws when the size overflows
+};
+
+// Running checksum of a word sequence: xxHash64 rounds over four lanes,
+// so it keeps up with memory bandwidth. Words are hashed as values, which
+// makes the result independent of the byte order they were stored in.
+class SnapshotChecksum {
+public:
+  void update(const uint64_t *words, size_t n) noexcept;
+  uint64_t value() const noexcept;
+
+private:
+  uint64_t lanes[4] = {0x60ea27eeadc0b5d6u, 0xc2b2ae3d27d4eb4fu, 0,
+                       0x61c8864e7a143579u};
+  uint64_t count = 0; // words so far
+};
+
+uint64_t snapshot_checksum(const uint64_t *words, size_t n) noexcept;
+
+// -- header --
+void write_snapshot_header(std::ostream &os, const SnapshotHeader &h);
+SnapshotHeader read_snapshot_header(std::istream &is);
+// bytes must hold at least SNAPSHOT_HEADER_BYTES
+SnapshotHeader parse_snapshot_header(std::span<const std::byte> bytes);
+
+// Words read per step by read_snapshot_words_chunked (512 KiB)
+static constexpr size_t SNAPSHOT_CHUNK_WORDS = size_t(1) << 16;
+
+// -- words --
+void write_snapshot_words(std::ostream &os, const uint64_t *words, size_t n);
+// Reads n words and converts them to host order
+void read_snapshot_words(std::istream &is, uint64_t *words, size_t n,
+                         bool swap);
+// Same into words (resized to n), grown a chunk at a time so that a
+// truncated stream fails before n words are ever allocated
+void read_snapshot_words_chunked(std::istream &is, std::vector<uint64_t> &words,
+                                 size_t n, bool swap);
+// True when the stream can seek and holds at least n more words; throws
+// "Truncated snapshot" when it can seek and is shorter. False when it
+// cannot seek (a pipe): the size is then unknown until the words arrive.
+bool check_snapshot_length(std::istream &is, size_t n);
@@ -0,0 +1,648 @@
+/*
+Throughput of BitVector and BitMatrix (Google Benchmark).
+Build with -DROCKET_BUILD_BENCHMARKS=ON and run ./bitvector_bench; bulk
+operations report bytes_per_second (bytes read + written), single-bit
+operations items_per_second. The std::bitset, std::vector<bool> and raw
+uint64_t loops are the baselines to compare against.
+Useful flags: --benchmark_filter=And --benchmark_min_time=0.1
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bitmatrix.hpp"
+#include "bitsliced.hpp"
+#include "bloom_filter.hpp"
+#include "rle_bitvector.hpp"
+#include "bitvector.hpp"
+
+// 64 bit .. 1 Gbit, x16 per step
+#define BIT_SIZES RangeMultiplier(16)->Range(64, int64_t(1) << 30)
+// Text is one byte per bit, so parse/format stop at 64 Mbit
+#define TEXT_SIZES RangeMultiplier(16)->Range(64, int64_t(1) << 26)
+
+static constexpr size_t ACCESS_BATCH = 4096; // random accesses per iteration
+
+// -- helpers --
+
+static std::vector<word_t> random_words(size_t nwords, uint64_t seed) {
+  std::vector<word_t> words(nwords);
+  std::mt19937_64 gen(seed);
+  for (word_t &w : words)
+    w = gen();
+  return words;
+}
+
+static BitVector random_vector(size_t nbits, uint64_t seed) {
+  std::vector<word_t> words =
+      random_words(BitVector::words_for_bits(nbits), seed);
+  return BitVector::from_words(words, nbits);
+}
+
+static std::vector<size_t> random_indices(size_t nbits) {
+  std::vector<size_t> idx(ACCESS_BATCH);
+  std::mt19937_64 gen(7);
+  for (size_t &i : idx)
+    i = gen() % nbits;
+  return idx;
+}
+
+static void set_bytes(benchmark::State &state, size_t nbits, size_t streams) {
+  state.SetBytesProcessed(int64_t(state.iterations()) *
+                          int64_t(BitVector::bytes_for_bits(nbits) * streams));
+}
+
+// -- construction --
+
+static void BM_Construct(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  for (auto _ : state) {
+    BitVector v(n, true);
+    benchmark::DoNotOptimize(v.words());
+  }
+  set_bytes(state, n, 1);
+}
+BENCHMARK(BM_Construct)->BIT_SIZES;
+
+static void BM_Copy(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  BitVector a = random_vector(n, 1);
+  for (auto _ : state) {
+    BitVector v(a);
+    benchmark::DoNotOptimize(v.words());
+  }
+  set_bytes(state, n, 2);
+}
+BENCHMARK(BM_Copy)->BIT_SIZES;
+
+// -- single bits --
+
+static void BM_Get(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  const BitVector a = random_vector(n, 1);
+  std::vector<size_t> idx = random_indices(n);
+  for (auto _ : state) {
+    size_t hits = 0;
+    for (size_t i : idx)
+      hits += a[i];
+    benchmark::DoNotOptimize(hits);
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * ACCESS_BATCH));
+}
+BENCHMARK(BM_Get)->BIT_SIZES;
+
+static void BM_Set(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  BitVector a(n);
+  std::vector<size_t> idx = random_indices(n);
+  for (auto _ : state) {
+    for (size_t i : idx)
+      a.set(i, true);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * ACCESS_BATCH));
+}
+BENCHMARK(BM_Set)->BIT_SIZES;
+
+// Same indices in one batch: one range check, prefetched word updates
+static void BM_SetBits(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  BitVector a(n);
+  std::vector<size_t> idx = random_indices(n);
+  for (auto _ : state) {
+    a.set_bits(idx);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * ACCESS_BATCH));
+}
+BENCHMARK(BM_SetBits)->BIT_SIZES;
+
+static void BM_TestBits(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  BitVector a = random_vector(n, 1), out;
+  std::vector<size_t> idx = random_indices(n);
+  for (auto _ : state) {
+    a.test_bits(idx, out);
+    benchmark::DoNotOptimize(out.words());
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * ACCESS_BATCH));
+}
+BENCHMARK(BM_TestBits)->BIT_SIZES;
+
+static void BM_VectorBoolSet(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  std::vector<bool> a(n);
+  std::vector<size_t> idx = random_indices(n);
+  for (auto _ : state) {
+    for (size_t i : idx)
+      a[i] = true;
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * ACCESS_BATCH));
+}
+BENCHMARK(BM_VectorBoolSet)->BIT_SIZES;
+
+// -- bitwise operators --
+
+template <char Op> static void BM_Binary(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  BitVector a = random_vector(n, 1), b = random_vector(n, 2), c(n);
+  for (auto _ : state) {
+    if constexpr (Op == '&')
+      c = a & b;
+    else if constexpr (Op == '|')
+      c = a | b;
+    else
+      c = a ^ b;
+    benchmark::DoNotOptimize(c.words());
+  }
+  set_bytes(state, n, 3);
+}
+BENCHMARK_TEMPLATE(BM_Binary, '&')->BIT_SIZES;
+BENCHMARK_TEMPLATE(BM_Binary, '|')->BIT_SIZES;
+BENCHMARK_TEMPLATE(BM_Binary, '^')->BIT_SIZES;
+
+template <char Op> static void BM_InPlace(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  BitVector a = random_vector(n, 1), b = random_vector(n, 2);
+  for (auto _ : state) {
+    if constexpr (Op == '&')
+      a &= b;
+    else if constexpr (Op == '|')
+      a |= b;
+    else
+      a ^= b;
+    benchmark::DoNotOptimize(a.words());
+  }
+  set_bytes(state, n, 3);
+}
+BENCHMARK_TEMPLATE(BM_InPlace, '&')->BIT_SIZES;
+BENCHMARK_TEMPLATE(BM_InPlace, '|')->BIT_SIZES;
+BENCHMARK_TEMPLATE(BM_InPlace, '^')->BIT_SIZES;
+
+static void BM_Not(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  BitVector a = random_vector(n, 1), c(n);
+  for (auto _ : state) {
+    c = ~a;
+    benchmark::DoNotOptimize(c.words());
+  }
+  set_bytes(state, n, 2);
+}
+BENCHMARK(BM_Not)->BIT_SIZES;
+
+// Complement then count: flipAll() only toggles a flag that weight() folds
+// into the count, so this is one read pass
+static void BM_FlipAllWeight(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  BitVector a = random_vector(n, 1);
+  for (auto _ : state) {
+    a.flipAll();
+    benchmark::DoNotOptimize(a.weight());
+  }
+  set_bytes(state, n, 1);
+}
+BENCHMARK(BM_FlipAllWeight)->BIT_SIZES;
+
+// (a & b) | (c ^ ~d) in one fused pass
+static void BM_FusedExpression(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  BitVector a = random_vector(n, 1), b = random_vector(n, 2);
+  BitVector c = random_vector(n, 3), d = random_vector(n, 4), r(n);
+  for (auto _ : state) {
+    r = (a & b) | (c ^ ~d);
+    benchmark::DoNotOptimize(r.words());
+  }
+  set_bytes(state, n, 5);
+}
+BENCHMARK(BM_FusedExpression)->BIT_SIZES;
+
+// -- shifts --
+
+static void BM_ShiftInPlace(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  BitVector a = random_vector(n, 1);
+  for (auto _ : state) {
+    a <<= 13;
+    a >>= 13;
+    benchmark::DoNotOptimize(a.words());
+  }
+  set_bytes(state, n, 4);
+}
+BENCHMARK(BM_ShiftInPlace)->BIT_SIZES;
+
+static void BM_ShiftCopy(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  BitVector a = random_vector(n, 1);
+  for (auto _ : state) {
+    BitVector c = a << 77;
+    benchmark::DoNotOptimize(c.words());
+  }
+  set_bytes(state, n, 2);
+}
+BENCHMARK(BM_ShiftCopy)->BIT_SIZES;
+
+// -- weight --
+
+static void BM_Weight(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  BitVector a = random_vector(n, 1);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(a.weight());
+  set_bytes(state, n, 1);
+}
+BENCHMARK(BM_Weight)->BIT_SIZES;
+
+// -- text --
+
+static void BM_Parse(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  std::ostringstream os;
+  os << random_vector(n, 1);
+  std::string text = os.str();
+  for (auto _ : state) {
+    BitVector v(text.c_str());
+    benchmark::DoNotOptimize(v.words());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations() * text.size()));
+}
+BENCHMARK(BM_Parse)->TEXT_SIZES;
+
+static void BM_Format(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  BitVector a = random_vector(n, 1);
+  std::ostringstream os;
+  for (auto _ : state) {
+    os.str(std::string());
+    os << a;
+    benchmark::DoNotOptimize(os.tellp());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations() * n));
+}
+BENCHMARK(BM_Format)->TEXT_SIZES;
+
+// -- baselines --
+
+// The loop every word-wise BitVector operation should match
+static void BM_RawAnd(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  size_t nwords = BitVector::words_for_bits(n);
+  std::vector<word_t> a = random_words(nwords, 1), b = random_words(nwords, 2);
+  std::vector<word_t> c(nwords);
+  for (auto _ : state) {
+    for (size_t w = 0; w < nwords; ++w)
+      c[w] = a[w] & b[w];
+    benchmark::DoNotOptimize(c.data());
+  }
+  set_bytes(state, n, 3);
+}
+BENCHMARK(BM_RawAnd)->BIT_SIZES;
+
+static void BM_RawWeight(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  std::vector<word_t> a = random_words(BitVector::words_for_bits(n), 1);
+  for (auto _ : state) {
+    size_t cnt = 0;
+    for (word_t w : a)
+      cnt += size_t(__builtin_popcountll(w));
+    benchmark::DoNotOptimize(cnt);
+  }
+  set_bytes(state, n, 1);
+}
+BENCHMARK(BM_RawWeight)->BIT_SIZES;
+
+static void BM_VectorBoolAnd(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  std::vector<bool> a(n), b(n), c(n);
+  std::mt19937_64 gen(1);
+  for (size_t i = 0; i < n; ++i) {
+    a[i] = gen() & 1;
+    b[i] = gen() & 1;
+  }
+  for (auto _ : state) {
+    std::transform(a.begin(), a.end(), b.begin(), c.begin(),
+                   [](bool x, bool y) { return x && y; });
+    benchmark::ClobberMemory();
+  }
+  set_bytes(state, n, 3);
+}
+// Bit-by-bit, so it stops well short of 1 Gbit
+BENCHMARK(BM_VectorBoolAnd)->RangeMultiplier(16)->Range(64, 1 << 24);
+
+template <size_t N> static void BM_BitsetAnd(benchmark::State &state) {
+  auto a = std::make_unique<std::bitset<N>>();
+  auto b = std::make_unique<std::bitset<N>>();
+  auto c = std::make_unique<std::bitset<N>>();
+  std::mt19937_64 gen(1);
+  for (size_t i = 0; i < N; ++i) {
+    a->set(i, gen() & 1);
+    b->set(i, gen() & 1);
+  }
+  for (auto _ : state) {
+    *c = *a & *b;
+    benchmark::DoNotOptimize(c.get());
+  }
+  set_bytes(state, N, 3);
+}
+BENCHMARK_TEMPLATE(BM_BitsetAnd, 64);
+BENCHMARK_TEMPLATE(BM_BitsetAnd, 1 << 10);
+BENCHMARK_TEMPLATE(BM_BitsetAnd, 1 << 14);
+BENCHMARK_TEMPLATE(BM_BitsetAnd, 1 << 18);
+BENCHMARK_TEMPLATE(BM_BitsetAnd, 1 << 22);
+
+template <size_t N> static void BM_BitsetWeight(benchmark::State &state) {
+  auto a = std::make_unique<std::bitset<N>>();
+  std::mt19937_64 gen(1);
+  for (size_t i = 0; i < N; ++i)
+    a->set(i, gen() & 1);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(a->count());
+  set_bytes(state, N, 1);
+}
+BENCHMARK_TEMPLATE(BM_BitsetWeight, 64);
+BENCHMARK_TEMPLATE(BM_BitsetWeight, 1 << 10);
+BENCHMARK_TEMPLATE(BM_BitsetWeight, 1 << 14);
+BENCHMARK_TEMPLATE(BM_BitsetWeight, 1 << 18);
+BENCHMARK_TEMPLATE(BM_BitsetWeight, 1 << 22);
+
+// -- BitMatrix --
+// rows x 4096 columns, 4 Kbit .. 1 Gbit in total
+
+static constexpr size_t MATRIX_COLUMNS = 4096;
+#define MATRIX_ROWS RangeMultiplier(16)->Range(1, 1 << 18)
+
+static BitMatrix random_matrix(size_t rows, uint64_t seed) {
+  BitMatrix m(rows, MATRIX_COLUMNS);
+  for (size_t i = 0; i < rows; ++i)
+    m[i] = random_vector(MATRIX_COLUMNS, seed + i);
+  return m;
+}
+
+static void BM_MatrixAnd(benchmark::State &state) {
+  size_t rows = size_t(state.range(0));
+  BitMatrix a = random_matrix(rows, 1), b = random_matrix(rows, 1 << 20);
+  for (auto _ : state) {
+    BitMatrix c = a & b;
+    benchmark::DoNotOptimize(c[0].words());
+  }
+  set_bytes(state, rows * MATRIX_COLUMNS, 3);
+}
+BENCHMARK(BM_MatrixAnd)->MATRIX_ROWS;
+
+static void BM_MatrixXorInPlace(benchmark::State &state) {
+  size_t rows = size_t(state.range(0));
+  BitMatrix a = random_matrix(rows, 1), b = random_matrix(rows, 1 << 20);
+  for (auto _ : state) {
+    a ^= b;
+    benchmark::DoNotOptimize(a[0].words());
+  }
+  set_bytes(state, rows * MATRIX_COLUMNS, 3);
+}
+BENCHMARK(BM_MatrixXorInPlace)->MATRIX_ROWS;
+
+static void BM_MatrixNot(benchmark::State &state) {
+  size_t rows = size_t(state.range(0));
+  BitMatrix a = random_matrix(rows, 1);
+  for (auto _ : state) {
+    BitMatrix c = ~a;
+    benchmark::DoNotOptimize(c[0].words());
+  }
+  set_bytes(state, rows * MATRIX_COLUMNS, 2);
+}
+BENCHMARK(BM_MatrixNot)->MATRIX_ROWS;
+
+// Snapshot of a matrix with one row changed afterwards; Arg 1 makes the
+// rows shareable first, so the copy only duplicates the changed row
+static void BM_MatrixSnapshotCopy(benchmark::State &state) {
+  size_t rows = size_t(state.range(0));
+  BitMatrix a = random_matrix(rows, 1);
+  if (state.range(1))
+    a.make_shareable();
+  for (auto _ : state) {
+    BitMatrix snapshot = a;
+    snapshot.set(0, 0, true);
+    benchmark::DoNotOptimize(snapshot[0].words());
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * rows));
+}
+BENCHMARK(BM_MatrixSnapshotCopy)
+    ->ArgsProduct({benchmark::CreateRange(1, 1 << 16, 16), {0, 1}});
+
+static void BM_MatrixWeight(benchmark::State &state) {
+  size_t rows = size_t(state.range(0));
+  BitMatrix a = random_matrix(rows, 1);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(a.weight());
+  set_bytes(state, rows * MATRIX_COLUMNS, 1);
+}
+BENCHMARK(BM_MatrixWeight)->MATRIX_ROWS;
+
+static void BM_MatrixDisjunctionRows(benchmark::State &state) {
+  size_t rows = size_t(state.range(0));
+  BitMatrix a = random_matrix(rows, 1);
+  for (auto _ : state) {
+    BitVector v = a.disjunction_rows();
+    benchmark::DoNotOptimize(v.words());
+  }
+  set_bytes(state, rows * MATRIX_COLUMNS, 1);
+}
+BENCHMARK(BM_MatrixDisjunctionRows)->MATRIX_ROWS;
+
+static void BM_MatrixConjunctionRows(benchmark::State &state) {
+  size_t rows = size_t(state.range(0));
+  BitMatrix a = random_matrix(rows, 1);
+  for (auto _ : state) {
+    BitVector v = a.conjunction_rows();
+    benchmark::DoNotOptimize(v.words());
+  }
+  set_bytes(state, rows * MATRIX_COLUMNS, 1);
+}
+BENCHMARK(BM_MatrixConjunctionRows)->MATRIX_ROWS;
+
+// Middle half of every row, as the flip/set range row operations see it
+static void BM_MatrixSetRange(benchmark::State &state) {
+  size_t rows = size_t(state.range(0));
+  BitMatrix a(rows, MATRIX_COLUMNS);
+  bool value = true;
+  for (auto _ : state) {
+    for (size_t j = 0; j < rows; ++j)
+      a.set_range(j, MATRIX_COLUMNS / 4 + 3, MATRIX_COLUMNS / 2, value);
+    value = !value;
+    benchmark::DoNotOptimize(a[0].words());
+  }
+  set_bytes(state, rows * MATRIX_COLUMNS / 2, 1);
+}
+BENCHMARK(BM_MatrixSetRange)->MATRIX_ROWS;
+
+// Integer column -> one row per value (index 0 = MSB)
+static void BM_MatrixFromIntegers(benchmark::State &state) {
+  std::vector<unsigned int> values(size_t(state.range(0)));
+  std::mt19937 gen(1);
+  for (unsigned int &v : values)
+    v = gen();
+  for (auto _ : state) {
+    BitMatrix m(values);
+    benchmark::DoNotOptimize(m[0].words());
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * values.size()));
+}
+BENCHMARK(BM_MatrixFromIntegers)->RangeMultiplier(16)->Range(16, 1 << 20);
+
+// Adjacency matrix of Arg nodes from 2^20 random edges, like to_matrix in
+// main.cpp; Arg 1 of the pair selects set_cells over one set() per edge
+static void BM_MatrixFromEdges(benchmark::State &state) {
+  size_t nodes = size_t(state.range(0));
+  std::vector<pair> edges(size_t(1) << 20);
+  std::mt19937_64 gen(1);
+  for (pair &e : edges)
+    e = {gen() % nodes, gen() % nodes};
+  BitMatrix m(nodes, nodes);
+  for (auto _ : state) {
+    if (state.range(1))
+      m.set_cells(edges);
+    else
+      for (const pair &e : edges)
+        m.set(e.first, e.second, true);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * edges.size()));
+}
+BENCHMARK(BM_MatrixFromEdges)
+    ->ArgsProduct({{1 << 10, 1 << 13, 1 << 15}, {0, 1}});
+
+// -- BitSlicedColumn --
+
+static std::vector<uint64_t> random_column(size_t n) {
+  std::vector<uint64_t> values(n);
+  std::mt19937_64 gen(2);
+  for (uint64_t &v : values)
+    v = gen() & 0xffffffffu; // 32 slices
+  return values;
+}
+
+// lo <= x < hi over every value, then the sum of the matches
+static void BM_SlicedBetweenSum(benchmark::State &state) {
+  BitSlicedColumn column(random_column(size_t(state.range(0))));
+  for (auto _ : state) {
+    BitVector mask = column.between(1u << 30, 3u << 30);
+    benchmark::DoNotOptimize(column.sum(mask));
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * column.size()));
+}
+BENCHMARK(BM_SlicedBetweenSum)->RangeMultiplier(16)->Range(64, 1 << 24);
+
+// Same query, one value at a time
+static void BM_ScalarBetweenSum(benchmark::State &state) {
+  std::vector<uint64_t> values = random_column(size_t(state.range(0)));
+  for (auto _ : state) {
+    uint64_t sum = 0;
+    for (uint64_t v : values)
+      if (v >= (1u << 30) && v < (3u << 30))
+        sum += v;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * values.size()));
+}
+BENCHMARK(BM_ScalarBetweenSum)->RangeMultiplier(16)->Range(64, 1 << 24);
+
+// -- BloomFilter --
+
+// Filter sized for range(0) keys at 1%, probed with as many absent keys
+static std::vector<uint64_t> random_keys(size_t n, uint64_t seed) {
+  std::vector<uint64_t> keys(n);
+  std::mt19937_64 gen(seed);
+  for (uint64_t &k : keys)
+    k = gen();
+  return keys;
+}
+
+static void BM_BloomInsertBatch(benchmark::State &state) {
+  std::vector<uint64_t> keys = random_keys(size_t(state.range(0)), 3);
+  BloomFilter filter = BloomFilter::for_capacity(keys.size(), 0.01);
+  for (auto _ : state) {
+    filter.insert(keys);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * keys.size()));
+}
+BENCHMARK(BM_BloomInsertBatch)->RangeMultiplier(64)->Range(1 << 12, 1 << 24);
+
+static void BM_BloomProbe(benchmark::State &state) {
+  std::vector<uint64_t> keys = random_keys(size_t(state.range(0)), 3);
+  std::vector<uint64_t> probes = random_keys(keys.size(), 4);
+  BloomFilter filter = BloomFilter::for_capacity(keys.size(), 0.01);
+  filter.insert(keys);
+  for (auto _ : state) {
+    size_t hits = 0;
+    for (uint64_t k : probes)
+      hits += filter.may_contain(k);
+    benchmark::DoNotOptimize(hits);
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * probes.size()));
+}
+BENCHMARK(BM_BloomProbe)->RangeMultiplier(64)->Range(1 << 12, 1 << 24);
+
+static void BM_BloomProbeBatch(benchmark::State &state) {
+  std::vector<uint64_t> keys = random_keys(size_t(state.range(0)), 3);
+  std::vector<uint64_t> probes = random_keys(keys.size(), 4);
+  BloomFilter filter = BloomFilter::for_capacity(keys.size(), 0.01);
+  filter.insert(keys);
+  for (auto _ : state) {
+    BitVector hits = filter.may_contain(probes);
+    benchmark::DoNotOptimize(hits.words());
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * probes.size()));
+}
+BENCHMARK(BM_BloomProbeBatch)->RangeMultiplier(64)->Range(1 << 12, 1 << 24);
+
+// -- RleBitVector --
+
+// Alternating runs of about range(1) bits over range(0) bits
+static BitVector run_vector(size_t n, size_t run, uint64_t seed) {
+  BitVector v(n);
+  std::mt19937_64 gen(seed);
+  bool value = false;
+  for (size_t i = 0; i < n;) {
+    size_t len = std::min(n - i, 1 + gen() % (2 * run));
+    if (value)
+      v.setRange(i, len, true);
+    i += len;
+    value = !value;
+  }
+  return v;
+}
+
+#define RLE_SIZES                                                              \
+  ArgsProduct({{int64_t(1) << 20, int64_t(1) << 26}, {64, 1 << 16}})
+
+static void BM_RleAnd(benchmark::State &state) {
+  size_t n = size_t(state.range(0)), run = size_t(state.range(1));
+  RleBitVector a(run_vector(n, run, 5)), b(run_vector(n, run, 6));
+  for (auto _ : state) {
+    RleBitVector c = a & b;
+    benchmark::DoNotOptimize(c.run_count());
+  }
+  state.counters["runs"] = double(a.run_count());
+  state.SetItemsProcessed(int64_t(state.iterations() * n));
+}
+BENCHMARK(BM_RleAnd)->RLE_SIZES;
+
+// Same inputs as dense vectors
+static void BM_RleDenseAnd(benchmark::State &state) {
+  size_t n = size_t(state.range(0)), run = size_t(state.range(1));
+  BitVector a = run_vector(n, run, 5), b = run_vector(n, run, 6);
+  for (auto _ : state) {
+    BitVector c = a & b;
+    benchmark::DoNotOptimize(c.words());
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * n));
+}
+BENCHMARK(BM_RleDenseAnd)->RLE_SIZES;
@@ -0,0 +1,1538 @@
+/*
+Behaviour tests for the bit containers in .include (BitVector and its
+storage modes, BitMatrix, RoaringBitmap, RleBitVector, BloomFilter,
+AtomicBitVector, BitSlicedColumn) and the thread pool behind them.
+Every check compares against a naive reference: a std::vector<bool> or a
+plain loop. Built as the bitvector_test target and run by ctest.
+*/
+
+#undef NDEBUG // the checks are asserts, keep them in release builds
+
+#include <algorithm>
+#include <cassert>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "atomic_bitvector.hpp"
+#include "bitmatrix.hpp"
+#include "bitsliced.hpp"
+#include "bloom_filter.hpp"
+#include "bittext.hpp"
+#include "bitvector.hpp"
+#include "parallel.hpp"
+#include "rle_bitvector.hpp"
+#include "roaring_bitmap.hpp"
+#include "snapshot.hpp"
+
+using Bits = std::vector<bool>;
+
+static std::mt19937_64 rng(2024);
+
+// -- helpers --
+
+static Bits random_bits(size_t n) {
+  Bits b(n);
+  for (size_t i = 0; i < n; ++i)
+    b[i] = rng() & 1;
+  return b;
+}
+
+// Bits set with probability ones / 1000, in runs of about run_length
+static Bits sparse_bits(size_t n, unsigned ones, size_t run_length = 1) {
+  Bits b(n);
+  for (size_t i = 0; i < n; i += run_length) {
+    bool value = rng() % 1000 < ones;
+    for (size_t k = i; k < std::min(n, i + run_length); ++k)
+      b[k] = value;
+  }
+  return b;
+}
+
+static Bits complement(Bits b) {
+  b.flip();
+  return b;
+}
+
+static BitVector from_bits(const Bits &b) {
+  BitVector v(b.size());
+  for (size_t i = 0; i < b.size(); ++i)
+    v.set(i, b[i]);
+  return v;
+}
+
+// Size, every bit and the weight agree with the reference
+static bool matches(const BitVector &v, const Bits &b) {
+  if (v.size() != b.size())
+    return false;
+  size_t ones = 0;
+  for (size_t i = 0; i < b.size(); ++i) {
+    if (v.get(i) != b[i])
+      return false;
+    ones += b[i];
+  }
+  return v.weight() == ones;
+}
+
+// Bit i of a raw word array
+static bool word_bit(const word_t *words, size_t i) {
+  return (words[i / BITS_PER_WORD] >> (i % BITS_PER_WORD)) & 1u;
+}
+
+static std::string temp_path(const std::string &name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// Input stream over a string that cannot seek, like a pipe
+class PipeBuf : public std::streambuf {
+public:
+  explicit PipeBuf(std::string bytes) : text(std::move(bytes)) {
+    setg(text.data(), text.data(), text.data() + text.size());
+  }
+
+private:
+  std::string text;
+};
+
+// Snapshot bytes with the 8-byte header field at offset replaced
+static std::string patch_field(std::string bytes, size_t offset,
+                               uint64_t value) {
+  for (size_t i = 0; i < 8; ++i)
+    bytes[offset + i] = static_cast<char>(value >> (8 * i));
+  return bytes;
+}
+
+template <class Error, class Body> static bool throws(Body body) {
+  try {
+    body();
+  } catch (const Error &) {
+    return true;
+  }
+  return false;
+}
+
+// -- shifts and rotations --
+// << moves bit i + off down to i, >> moves bit i up to i + off, and the
+// rotations wrap the bits that either shift drops
+
+static Bits shifted_down(const Bits &b, size_t off) {
+  Bits out(b.size());
+  for (size_t i = 0; off < b.size() && i < b.size() - off; ++i)
+    out[i] = b[i + off];
+  return out;
+}
+
+static Bits shifted_up(const Bits &b, size_t off) {
+  Bits out(b.size());
+  for (size_t i = off; i < b.size(); ++i)
+    out[i] = b[i - off];
+  return out;
+}
+
+static Bits rotated_down(const Bits &b, size_t k) {
+  Bits out(b.size());
+  for (size_t i = 0; i < b.size(); ++i)
+    out[i] = b[(i + k) % b.size()];
+  return out;
+}
+
+void testShifts() {
+  for (size_t n : {0, 1, 63, 64, 65, 130, 1000}) {
+    Bits ref = random_bits(n);
+    for (size_t off : {size_t(0), size_t(1), size_t(63), size_t(64),
+                       size_t(65), size_t(128), size_t(192), n / 2, n - 1, n,
+                       n + 1, n + 64, size_t(-1)}) {
+      BitVector v = from_bits(ref);
+      assert(matches(v << off, shifted_down(ref, off)));
+      assert(matches(v >> off, shifted_up(ref, off)));
+      BitVector in_place = v;
+      in_place <<= off;
+      assert(matches(in_place, shifted_down(ref, off)));
+      in_place = v;
+      in_place >>= off;
+      assert(matches(in_place, shifted_up(ref, off)));
+
+      // a pending complement and shared words shift like plain ones
+      BitVector flipped = v;
+      flipped.make_shareable();
+      BitVector keep = flipped;
+      flipped.flipAll();
+      flipped >>= off;
+      assert(matches(flipped, shifted_up(complement(ref), off)));
+      assert(matches(keep, ref));
+    }
+  }
+  std::cout << "All shift tests passed!" << std::endl;
+}
+
+void testRotations() {
+  for (size_t n : {0, 1, 63, 64, 65, 130, 1000}) {
+    Bits ref = random_bits(n);
+    for (size_t k : {size_t(0), size_t(1), size_t(63), size_t(64),
+                     size_t(65), size_t(128), n / 2, n / 2 + 1, n, n + 1,
+                     3 * n + 64}) {
+      if (n == 0)
+        break;
+      BitVector left = from_bits(ref), right = from_bits(ref);
+      left.rotateLeft(k);
+      right.rotateRight(k);
+      assert(matches(left, rotated_down(ref, k % n)));
+      assert(matches(right, rotated_down(ref, n - k % n)));
+      left.rotateRight(k); // and back
+      assert(matches(left, ref));
+    }
+  }
+  BitVector empty;
+  empty.rotateLeft(3);
+  empty.rotateRight(3);
+  assert(empty.size() == 0);
+  std::cout << "All rotation tests passed!" << std::endl;
+}
+
+// -- expressions --
+// Reference semantics of every operator, one step at a time: the result
+// has the left operand's length and a shorter right operand reads as zeros
+
+static bool bit_or_zero(const Bits &b, size_t i) {
+  return i < b.size() && b[i];
+}
+
+template <class Op> static Bits apply(const Bits &l, const Bits &r, Op op) {
+  Bits out(l.size());
+  for (size_t i = 0; i < l.size(); ++i)
+    out[i] = op(l[i], bit_or_zero(r, i));
+  return out;
+}
+
+static Bits ref_and(const Bits &l, const Bits &r) {
+  return apply(l, r, [](bool x, bool y) { return x && y; });
+}
+static Bits ref_or(const Bits &l, const Bits &r) {
+  return apply(l, r, [](bool x, bool y) { return x || y; });
+}
+static Bits ref_xor(const Bits &l, const Bits &r) {
+  return apply(l, r, [](bool x, bool y) { return x != y; });
+}
+
+void testExpressions() {
+  for (int round = 0; round < 200; ++round) {
+    // lengths often equal, often off by a word or a few bits
+    size_t base = rng() % 300;
+    auto length = [&] {
+      size_t pick = rng() % 4;
+      return pick == 0 ? base : pick == 1 ? base + rng() % 70 : rng() % 300;
+    };
+    Bits a = random_bits(length()), b = random_bits(length()),
+         c = random_bits(length()), d = random_bits(length());
+    BitVector va = from_bits(a), vb = from_bits(b), vc = from_bits(c),
+              vd = from_bits(d);
+    if (round % 3 == 0) { // a pending complement is read in the same pass
+      vd.flipAll();
+      d = complement(d);
+    }
+
+    assert(matches(BitVector((va & vb) | (vc ^ ~vd)),
+                   ref_or(ref_and(a, b), ref_xor(c, complement(d)))));
+    assert(matches(BitVector(vc | (va ^ vb)), ref_or(c, ref_xor(a, b))));
+    assert(matches(BitVector(~(va | vb) & vc),
+                   ref_and(complement(ref_or(a, b)), c)));
+    assert(matches(BitVector(va ^ ~(vb & ~vc)),
+                   ref_xor(a, complement(ref_and(b, complement(c))))));
+    // the fused result equals the one built from explicit temporaries
+    BitVector inner(vb & ~vc);
+    assert(BitVector(va ^ ~(vb & ~vc)) == BitVector(va ^ ~inner));
+
+    // an operand that is also the target, at equal and different lengths
+    BitVector r = va;
+    r = r & vb;
+    assert(matches(r, ref_and(a, b)));
+    r = vb | (r ^ vc);
+    Bits expected = ref_or(b, ref_xor(ref_and(a, b), c));
+    assert(matches(r, expected));
+    r &= vc ^ r;
+    expected = ref_and(expected, ref_xor(c, expected));
+    assert(matches(r, expected));
+    r |= ~r & va;
+    expected = ref_or(expected, ref_and(complement(expected), a));
+    assert(matches(r, expected));
+    r ^= r;
+    assert(matches(r, Bits(expected.size())));
+
+    // in-place operators against shorter and longer operands
+    BitVector s = va;
+    s &= vb;
+    s |= vc;
+    s ^= vd;
+    assert(matches(s, ref_xor(ref_or(ref_and(a, b), c), d)));
+  }
+  std::cout << "All expression tests passed!" << std::endl;
+}
+
+// -- text kernels --
+// Every parse/format kernel this CPU runs is forced in turn and checked on
+// odd lengths, where the vector loops hand over to their tails
+
+static std::string bit_text(const Bits &b) {
+  std::string s;
+  for (bool bit : b)
+    s += bit ? '1' : '0';
+  return s;
+}
+
+static void check_text_kernel() {
+  for (size_t n = 0; n < 300; n += 1 + n / 16) {
+    for (size_t extra : {size_t(0), size_t(1000)}) {
+      Bits ref = random_bits(n + extra);
+      std::string text = bit_text(ref);
+      std::vector<uint64_t> words(BitVector::words_for_bits(ref.size()) + 1,
+                                  ~uint64_t(0));
+      assert(parse_bits(text.data(), text.size(), words.data()));
+      for (size_t i = 0; i < ref.size(); ++i)
+        assert(((words[i / 64] >> (i % 64)) & 1u) == ref[i]);
+      if (ref.size() % 64)
+        assert(words[ref.size() / 64] >> (ref.size() % 64) == 0);
+      assert(words.back() == ~uint64_t(0)); // nothing past the last word
+
+      std::string out(text.size() + 1, '#');
+      format_bits(words.data(), text.size(), out.data());
+      assert(out == text + '#');
+      assert(matches(BitVector(text.c_str()), ref));
+
+      // one bad character anywhere, in either vector half or the tail
+      for (size_t at : {size_t(0), size_t(31), size_t(32), size_t(63),
+                        size_t(64), text.size() / 2, text.size() - 1}) {
+        if (at >= text.size())
+          continue;
+        for (char bad : {'2', '/', 'a', ' ', '\xb1'}) {
+          std::string broken = text;
+          broken[at] = bad;
+          assert(!parse_bits(broken.data(), broken.size(), words.data()));
+        }
+      }
+    }
+  }
+}
+
+void testTextKernels() {
+  std::string original = bittext_kernel();
+  std::string tested;
+  for (const char *name : {"avx512", "avx2", "generic"}) {
+    if (!bittext_use_kernel(name))
+      continue;
+    assert(bittext_kernel() == std::string(name));
+    check_text_kernel();
+    tested += std::string(" ") + name;
+  }
+  assert(!bittext_use_kernel("sse9") && tested.ends_with("generic"));
+  bittext_use_kernel(original.c_str());
+  std::cout << "All text kernel tests passed (" << tested.substr(1) << ")!"
+            << std::endl;
+}
+
+// -- comparisons and hashing --
+// <=> orders like std::vector<bool> (bit 0 first, a prefix before any
+// longer vector), and equal vectors hash alike however they were built
+
+static std::strong_ordering ref_order(const Bits &a, const Bits &b) {
+  return std::lexicographical_compare_three_way(a.begin(), a.end(), b.begin(),
+                                                b.end());
+}
+
+// b with one bit flipped, or cut / extended at `at`: close to b, so the
+// comparison has to look past a long common prefix
+static Bits near_copy(const Bits &b, size_t at, int how) {
+  Bits out = b;
+  if (how == 0 && at < out.size())
+    out[at] = !out[at];
+  else if (how == 1)
+    out.resize(std::min(at, out.size()));
+  else
+    out.resize(out.size() + 1 + at % 70, at % 2);
+  return out;
+}
+
+static void check_order(const Bits &a, const Bits &b) {
+  BitVector x = from_bits(a), y = from_bits(b);
+  assert((x <=> y) == ref_order(a, b));
+  assert((y <=> x) == ref_order(b, a));
+  assert((x == y) == (a == b));
+  if (a == b)
+    assert(x.hash() == y.hash());
+}
+
+void testComparisons() {
+  for (size_t n : {size_t(0), size_t(1), size_t(63), size_t(64), size_t(65),
+                   size_t(200), size_t(1000)}) {
+    for (int round = 0; round < 20; ++round) {
+      Bits a = random_bits(n);
+      size_t at = n ? rng() % (n + 1) : 0;
+      check_order(a, random_bits(n));
+      check_order(a, random_bits(rng() % 300));
+      for (int how = 0; how < 3; ++how)
+        check_order(a, near_copy(a, at, how));
+      check_order(a, a);
+    }
+  }
+
+  // the lazy complement, shared words and a cached hash give the same
+  // answers as a plain vector with the same bits
+  for (size_t n : {size_t(1), size_t(64), size_t(65), size_t(1000)}) {
+    Bits a = random_bits(n);
+    BitVector plain = from_bits(complement(a));
+    BitVector flipped = from_bits(a);
+    flipped.flipAll();
+    assert(flipped == plain && plain == flipped);
+    assert((flipped <=> plain) == std::strong_ordering::equal);
+    assert(flipped.hash() == plain.hash());
+    assert(std::hash<BitVector>{}(flipped) == plain.hash());
+
+    BitVector shared = flipped;
+    shared.cache_hash();
+    assert(shared.hash() == plain.hash());
+    shared.flip(n / 2);
+    plain.flip(n / 2);
+    assert(shared == plain && shared.hash() == plain.hash());
+    assert((shared <=> flipped) ==
+           ref_order(near_copy(complement(a), n / 2, 0), complement(a)));
+
+    flipped.cache_hash();
+    flipped.flipAll();
+    assert(flipped == from_bits(a) && flipped.hash() == from_bits(a).hash());
+  }
+  std::cout << "All comparison tests passed!" << std::endl;
+}
+
+// -- word conversion --
+// Fields are checked at every offset against the bits, so the ones that
+// straddle two words are covered; complemented and shared vectors too
+
+static uint64_t ref_field(const Bits &b, size_t pos, size_t width) {
+  uint64_t v = 0;
+  for (size_t k = 0; k < width; ++k)
+    v |= uint64_t(b[pos + k]) << k;
+  return v;
+}
+
+void testFields() {
+  for (size_t n : {size_t(0), size_t(1), size_t(63), size_t(64), size_t(65),
+                   size_t(127), size_t(130), size_t(200)}) {
+    Bits a = random_bits(n);
+    BitVector plain = from_bits(a);
+    BitVector flipped = from_bits(complement(a));
+    flipped.flipAll();
+    for (size_t width : {0, 1, 7, 31, 63, 64}) {
+      for (size_t pos = 0; pos <= n + 1; ++pos) {
+        if (pos + width > n) {
+          assert(throws<std::out_of_range>([&] { plain.extract(pos, width); }));
+          assert(throws<std::out_of_range>(
+              [&] { plain.deposit(pos, width, 0); }));
+          continue;
+        }
+        assert(plain.extract(pos, width) == ref_field(a, pos, width));
+        assert(flipped.extract(pos, width) == ref_field(a, pos, width));
+
+        uint64_t value = rng();
+        Bits expect = a;
+        for (size_t k = 0; k < width; ++k)
+          expect[pos + k] = (value >> k) & 1u;
+        BitVector written = plain, written_flipped = flipped;
+        written.deposit(pos, width, value);
+        written_flipped.deposit(pos, width, value);
+        assert(matches(written, expect) && matches(written_flipped, expect));
+        assert(matches(plain, a) && matches(flipped, a)); // copies untouched
+      }
+    }
+    assert(throws<std::invalid_argument>([&] { plain.extract(0, 65); }));
+    assert(throws<std::invalid_argument>([&] { plain.deposit(0, 65, 0); }));
+  }
+  std::cout << "All field tests passed!" << std::endl;
+}
+
+void testWordConversion() {
+  for (size_t n : {size_t(0), size_t(1), size_t(63), size_t(64), size_t(65),
+                   size_t(130), size_t(1000)}) {
+    size_t nwords = BitVector::words_for_bits(n);
+    std::vector<word_t> words(nwords + 1);
+    for (word_t &w : words)
+      w = rng(); // garbage past n, and one word too many
+    Bits a(n);
+    for (size_t i = 0; i < n; ++i)
+      a[i] = (words[i / 64] >> (i % 64)) & 1u;
+
+    BitVector v = BitVector::from_words(words, n);
+    assert(matches(v, a) && v.weight() == from_bits(a).weight());
+    std::vector<word_t> back = v.to_words();
+    assert(back == from_bits(a).to_words() && back.size() == nwords);
+    if (n % 64)
+      assert(back.back() >> (n % 64) == 0);
+    BitVector flipped = from_bits(complement(a));
+    flipped.flipAll();
+    assert(flipped.to_words() == back);
+    if (nwords)
+      assert(throws<std::invalid_argument>([&] {
+        BitVector::from_words(std::span(words).first(nwords - 1), n);
+      }));
+
+    if (n <= 64) {
+      assert(v.to_uint64() == (n ? back[0] : 0));
+      assert(flipped.to_uint64() == v.to_uint64());
+    } else {
+      BitVector low = v;
+      low.setRange(64, n - 64, false);
+      assert(low.to_uint64() == back[0]);
+      low.set(n - 1, true);
+      assert(throws<std::overflow_error>([&] { low.to_uint64(); }));
+      BitVector high = BitVector(n, true);
+      assert(throws<std::overflow_error>([&] { high.to_uint64(); }));
+    }
+  }
+  std::cout << "All word conversion tests passed!" << std::endl;
+}
+
+// -- thread pool --
+// Sizes past PARALLEL_MIN_WORDS take the pooled paths; ctest runs these
+// with BITVECTOR_THREADS=1 and 4, and both must match the plain loops.
+
+void testParallelVectors() {
+  size_t n = PARALLEL_MIN_WORDS * BITS_PER_WORD + 77;
+  Bits a = random_bits(n), b = random_bits(n), c = sparse_bits(n, 100);
+  BitVector va = from_bits(a), vb = from_bits(b), vc = from_bits(c);
+  size_t ones = 0;
+  for (bool bit : a)
+    ones += bit;
+  assert(va.weight() == ones);
+
+  // one fused expression, then one evaluated into its own operand
+  Bits expected(n);
+  for (size_t i = 0; i < n; ++i)
+    expected[i] = (a[i] && b[i]) || !c[i];
+  assert(matches(BitVector((va & vb) | ~vc), expected));
+  va = va ^ vb;
+  for (size_t i = 0; i < n; ++i)
+    a[i] = a[i] != b[i];
+  assert(matches(va, a) && va == from_bits(a));
+
+  // a shorter operand is zero-extended
+  Bits half = random_bits(n / 2);
+  for (size_t i = 0; i < n; ++i)
+    expected[i] = b[i] || (i < half.size() && half[i]);
+  assert(matches(BitVector(vb | from_bits(half)), expected));
+
+  // compound operators and a shared complement
+  vc &= vb;
+  vc |= va;
+  vc ^= vb;
+  for (size_t i = 0; i < n; ++i)
+    c[i] = ((c[i] && b[i]) || a[i]) != b[i];
+  assert(matches(vc, c));
+  vc.make_shareable();
+  BitVector flipped = vc;
+  flipped.flipAll();
+  assert(matches(flipped, complement(c)) && matches(vc, c));
+  flipped.flip(n - 1);
+  assert(flipped != BitVector(~vc));
+}
+
+void testParallelMatrix() {
+  // 63 words a row, so the blocks split rows unevenly
+  size_t rows = 2100, cols = 4000;
+  BitMatrix dense(rows, cols), sparse(rows, cols);
+  Bits all_set(cols, true), any_set(cols, false);
+  size_t ones = 0;
+  for (size_t i = 0; i < rows; ++i) {
+    Bits d = complement(sparse_bits(cols, 2));
+    Bits s = sparse_bits(cols, 1);
+    dense[i] = from_bits(d);
+    sparse[i] = from_bits(s);
+    for (size_t j = 0; j < cols; ++j) {
+      all_set[j] = all_set[j] && d[j];
+      any_set[j] = any_set[j] || s[j];
+      ones += d[j];
+    }
+  }
+  assert(rows * BitVector::words_for_bits(cols) >= PARALLEL_MIN_WORDS);
+  assert(dense.weight() == ones);
+  assert(matches(dense.conjunction_rows(), all_set));
+  assert(matches(sparse.disjunction_rows(), any_set));
+  std::cout << "All parallel tests passed on " << parallel_threads()
+            << " thread(s)!" << std::endl;
+}
+
+// -- bit-sliced column --
+
+// Bits where pred(value) holds, by a plain loop
+template <class Pred>
+static Bits where(const std::vector<uint64_t> &values, Pred pred) {
+  Bits out(values.size());
+  for (size_t i = 0; i < values.size(); ++i)
+    out[i] = pred(values[i]);
+  return out;
+}
+
+static void check_column(const BitSlicedColumn &col,
+                         const std::vector<uint64_t> &values,
+                         const std::vector<uint64_t> &constants) {
+  assert(col.size() == values.size() && col.values() == values);
+  for (uint64_t c : constants) {
+    assert(matches(col.equal(c), where(values, [&](uint64_t x) {
+                     return x == c;
+                   })));
+    assert(matches(col.not_equal(c), where(values, [&](uint64_t x) {
+                     return x != c;
+                   })));
+    assert(matches(col.less(c), where(values, [&](uint64_t x) {
+                     return x < c;
+                   })));
+    assert(matches(col.less_equal(c), where(values, [&](uint64_t x) {
+                     return x <= c;
+                   })));
+    assert(matches(col.greater(c), where(values, [&](uint64_t x) {
+                     return x > c;
+                   })));
+    assert(matches(col.greater_equal(c), where(values, [&](uint64_t x) {
+                     return x >= c;
+                   })));
+  }
+  // every ordered and reversed pair, including empty ranges
+  for (uint64_t lo : constants)
+    for (uint64_t hi : {constants.front(), constants.back(), lo, lo + 1}) {
+      Bits ref = where(values, [&](uint64_t x) { return lo <= x && x < hi; });
+      assert(matches(col.between(lo, hi), ref));
+    }
+
+  BitVector mask = from_bits(sparse_bits(values.size(), 500));
+  uint64_t masked = 0, total = 0; // both wrap modulo 2^64
+  for (size_t i = 0; i < values.size(); ++i) {
+    total += values[i];
+    if (mask.get(i))
+      masked += values[i];
+  }
+  assert(col.sum() == total && col.sum(mask) == masked);
+  assert(col.count(mask) == mask.weight());
+}
+
+// Constants around every value kind: present, absent, above 2^width
+static std::vector<uint64_t> column_constants(
+    const std::vector<uint64_t> &values, size_t width) {
+  std::vector<uint64_t> c = {0, 1, UINT64_MAX, UINT64_MAX - 1, rng()};
+  if (width < 64) {
+    uint64_t limit = uint64_t(1) << width;
+    c.insert(c.end(), {limit - 1, limit, limit + 5, limit << 1});
+  }
+  for (size_t k = 0; k < 4 && !values.empty(); ++k)
+    c.push_back(values[rng() % values.size()]);
+  return c;
+}
+
+void testBitSlicedColumn() {
+  for (size_t width : {0, 1, 5, 31, 63, 64}) {
+    for (size_t n : {0, 1, 63, 64, 65, 1000}) {
+      std::vector<uint64_t> values(n);
+      for (uint64_t &v : values)
+        v = width == 64 ? rng() : rng() & ((uint64_t(1) << width) - 1);
+      BitSlicedColumn col(values, width);
+      assert(col.width() == width);
+      check_column(col, values, column_constants(values, width));
+    }
+  }
+  // an explicit width wider than the values
+  std::vector<uint64_t> small = {3, 0, 7, 1};
+  BitSlicedColumn wide(small, 64);
+  assert(wide.width() == 64 && BitSlicedColumn(small).width() == 3);
+  check_column(wide, small, column_constants(small, 3));
+  assert(throws<std::invalid_argument>([&] { BitSlicedColumn(small, 2); }));
+  assert(throws<std::invalid_argument>([&] { wide.sum(BitVector(3)); }));
+}
+
+// Above PARALLEL_MIN_WORDS, so predicates and sums run on the pool; the
+// large 64-bit values make the masked sum wrap
+void testBitSlicedColumnParallel() {
+  size_t n = PARALLEL_MIN_WORDS * BITS_PER_WORD + 4097;
+  std::vector<uint64_t> values(n);
+  for (uint64_t &v : values)
+    v = rng() | (uint64_t(1) << 63);
+  BitSlicedColumn col(values);
+  assert(col.width() == 64);
+  uint64_t mid = values[n / 2];
+  assert(matches(col.less(mid), where(values, [&](uint64_t x) {
+                   return x < mid;
+                 })));
+  assert(matches(col.equal(mid), where(values, [&](uint64_t x) {
+                   return x == mid;
+                 })));
+  assert(matches(col.between(values[7], mid), where(values, [&](uint64_t x) {
+                   return values[7] <= x && x < mid;
+                 })));
+  BitVector mask = col.greater_equal(mid);
+  uint64_t masked = 0, total = 0;
+  for (uint64_t v : values) {
+    total += v;
+    if (v >= mid)
+      masked += v;
+  }
+  assert(col.sum() == total && col.sum(mask) == masked);
+  std::cout << "All bit-sliced column tests passed!" << std::endl;
+}
+
+// -- atomic bit vector --
+
+void testAtomicRaces() {
+  constexpr size_t THREADS = 8;
+  size_t n = 10007;
+  AtomicBitVector shared(n);
+  std::vector<std::vector<size_t>> won(THREADS);
+  std::vector<std::thread> pool;
+  for (size_t t = 0; t < THREADS; ++t)
+    pool.emplace_back([&, t] {
+      // every thread claims every bit, each in its own order
+      for (size_t k = 0; k < n; ++k) {
+        size_t i = (k * (2 * t + 1) + t * 997) % n;
+        if (!shared.test_and_set(i, std::memory_order_relaxed))
+          won[t].push_back(i);
+      }
+    });
+  for (std::thread &th : pool)
+    th.join();
+  Bits winner(n);
+  for (const std::vector<size_t> &bits : won)
+    for (size_t i : bits) {
+      assert(!winner[i]); // exactly one winner per bit
+      winner[i] = true;
+    }
+  assert(shared.weight() == n && matches(shared.snapshot(), Bits(n, true)));
+
+  // concurrent merges of private vectors give their union
+  AtomicBitVector merged(n);
+  std::vector<Bits> parts(THREADS);
+  Bits all(n);
+  for (Bits &part : parts) {
+    part = sparse_bits(n, 50);
+    for (size_t i = 0; i < n; ++i)
+      all[i] = all[i] || part[i];
+  }
+  pool.clear();
+  for (size_t t = 0; t < THREADS; ++t)
+    pool.emplace_back([&, t] { merged.merge(from_bits(parts[t])); });
+  for (std::thread &th : pool)
+    th.join();
+  assert(matches(merged.snapshot(), all));
+}
+
+void testAtomicBasics() {
+  Bits ref = random_bits(130);
+  BitVector dense = from_bits(ref);
+  dense.flipAll();
+  AtomicBitVector v(dense);
+  assert(matches(v.snapshot(), complement(ref)));
+  assert(v.test_and_reset(0) == !ref[0] && !v.test(0));
+  assert(throws<std::out_of_range>([&] { v.test(130); }));
+
+  for (std::memory_order order :
+       {std::memory_order_relaxed, std::memory_order_consume,
+        std::memory_order_acquire, std::memory_order_release,
+        std::memory_order_acq_rel, std::memory_order_seq_cst}) {
+    v.setAll(true, order);
+    assert(matches(v.snapshot(order), Bits(130, true)));
+    v.setAll(false, order);
+    assert(v.weight(order) == 0);
+  }
+
+  // a moved-from vector is empty, not a dangling size
+  AtomicBitVector moved(std::move(v));
+  assert(moved.size() == 130 && v.size() == 0);
+  assert(throws<std::out_of_range>([&] { v.test(5); }));
+  v = std::move(moved);
+  assert(v.size() == 130 && moved.size() == 0 && moved.weight() == 0);
+  assert(moved.snapshot().size() == 0);
+  std::cout << "All atomic bit vector tests passed!" << std::endl;
+}
+
+// -- copy-on-write --
+
+void testCopyOnWrite() {
+  Bits ref = random_bits(1000);
+  // every kind of write takes a private copy and leaves the others alone
+  for (int write = 0; write < 5; ++write) {
+    BitVector original = from_bits(ref);
+    original.make_shareable();
+    BitVector first = original, second = original;
+    assert(original.shares_words() && first.shares_words());
+    assert(first.words() == original.words());
+
+    Bits expected = ref;
+    switch (write) {
+    case 0:
+      first.set(5, !ref[5]);
+      expected[5] = !ref[5];
+      break;
+    case 1:
+      first.flip(999);
+      expected[999] = !ref[999];
+      break;
+    case 2:
+      first &= BitVector(1000);
+      expected.assign(1000, false);
+      break;
+    case 3:
+      first.set_bits(std::vector<size_t>{0, 64, 500}, true);
+      expected[0] = expected[64] = expected[500] = true;
+      break;
+    case 4:
+      first.setRange(100, 300, true);
+      std::fill(expected.begin() + 100, expected.begin() + 400, true);
+      break;
+    }
+    assert(matches(first, expected) && !first.shares_words());
+    assert(matches(original, ref) && matches(second, ref));
+    assert(original.shares_words() && second.shares_words());
+
+    // the private copy is shareable too
+    BitVector third = first;
+    assert(first.shares_words() && third.words() == first.words());
+    third.set(1, !expected[1]);
+    assert(matches(first, expected));
+  }
+
+  // the source writing first leaves the copy with the old words
+  BitVector source = from_bits(ref);
+  source.make_shareable();
+  BitVector copy = source;
+  source.flip(7);
+  assert(matches(copy, ref) && source.get(7) != ref[7]);
+  assert(!source.shares_words() && !copy.shares_words());
+
+  // borrowed words are not moved; copies of them are owned
+  std::vector<word_t> buf = from_bits(ref).to_words();
+  BitVector view = BitVector::borrow(buf, ref.size());
+  view.make_shareable();
+  BitVector owned = view;
+  owned.set(3, !ref[3]);
+  assert(view.words() == buf.data() && matches(view, ref));
+
+  // matrix copies duplicate only the rows written afterwards
+  BitMatrix m(20, 100);
+  for (size_t i = 0; i < 20; ++i)
+    m[i] = from_bits(random_bits(100));
+  m.make_shareable();
+  BitMatrix snapshot = m;
+  BitMatrix before = m;
+  m.set(4, 10, !m[4].get(10));
+  m.set(9, 99, !m[9].get(99));
+  assert(snapshot == before && snapshot != m);
+  for (size_t i = 0; i < 20; ++i)
+    assert(m[i].shares_words() == (i != 4 && i != 9));
+  std::cout << "All copy-on-write tests passed!" << std::endl;
+}
+
+// An out-of-range write throws before touching anything: shared words,
+// a pending complement and the caches all stay as they were
+void testRejectedWrites() {
+  Bits ref = random_bits(200);
+  BitVector original = from_bits(ref);
+  original.make_shareable();
+  original.build_rank_select();
+  BitVector copy = original;
+  copy.flipAll();
+  size_t hash = copy.hash();
+  copy.cache_hash();
+  const size_t far = static_cast<size_t>(-1);
+  for (BitVector *v : {&original, &copy}) {
+    assert(throws<std::out_of_range>([&] { v->set(200, true); }));
+    assert(throws<std::out_of_range>([&] { v->flip(far); }));
+    assert(throws<std::out_of_range>([&] { v->setRange(199, 2, true); }));
+    assert(throws<std::out_of_range>([&] { v->setRange(far, 2, false); }));
+    assert(throws<std::out_of_range>([&] { v->flipRange(201, 1); }));
+    assert(throws<std::out_of_range>([&] { v->flipRange(2, far); }));
+    assert(throws<std::out_of_range>([&] { (*v)[200] = true; }));
+    v->setRange(far, 0, true); // empty ranges are never out of bounds
+    v->flipRange(200, 0);
+  }
+  assert(original.shares_words() && copy.shares_words());
+  assert(original.has_rank_select() && matches(original, ref));
+  assert(copy.complement_pending() && matches(copy, complement(ref)));
+  assert(copy.hash() == hash);
+  std::cout << "All rejected write tests passed!" << std::endl;
+}
+
+// Borrowed and mapped words stay in use when a vector of the same word
+// count is assigned, shared or not, and opening a mapping never writes
+void testForeignStorage() {
+  Bits ref = random_bits(150);
+  BitVector source = from_bits(ref);
+  source.make_shareable();
+  BitVector holder = source; // source's words are now shared
+
+  std::vector<word_t> buf(3, 0);
+  BitVector view = BitVector::borrow(buf, 150);
+  view = source;
+  assert(view.words() == buf.data() && !view.shares_words());
+  assert(BitVector::borrow(buf, 150) == source);
+  source.flip(0);
+  assert(matches(view, ref));
+  view = BitVector(500);
+  assert(view.words() != buf.data() && BitVector::borrow(buf, 150) == holder);
+
+  std::string path = temp_path("bitvector_test_foreign.bits");
+  std::filesystem::remove(path);
+  {
+    BitVector m =
+        BitVector::map_file(path, 150, BitVector::MapMode::ReadWrite);
+    m = holder;
+    assert(!m.shares_words());
+    m.sync();
+  }
+  assert(matches(BitVector::map_file(path, 150), ref));
+
+  // a file with bits past 150 set is refused for writing, left unchanged,
+  // and read as if they were clear
+  std::vector<word_t> dirty(3, ~word_t(0));
+  std::filesystem::remove(path);
+  std::ofstream(path, std::ios::binary)
+      .write(reinterpret_cast<const char *>(dirty.data()), 3 * sizeof(word_t));
+  assert(throws<std::runtime_error>([&] {
+    BitVector::map_file(path, 150, BitVector::MapMode::ReadWrite);
+  }));
+  assert(BitVector::map_file(path, 150).weight() == 150);
+  assert(BitVector::map_file(path, 192, BitVector::MapMode::ReadWrite)
+             .weight() == 192);
+  std::vector<word_t> after(3);
+  std::ifstream(path, std::ios::binary)
+      .read(reinterpret_cast<char *>(after.data()), 3 * sizeof(word_t));
+  assert(after == dirty);
+  std::filesystem::remove(path);
+  std::cout << "All foreign storage tests passed!" << std::endl;
+}
+
+// -- lazy complement --
+
+void testComplementOwned() {
+  for (size_t n : {0, 1, 63, 64, 65, 200, 1000}) {
+    Bits ref = random_bits(n);
+    BitVector v = from_bits(ref);
+    v.flipAll();
+    ref = complement(ref);
+    assert(v.complement_pending());
+    assert(matches(v, ref));
+
+    // search and conversion read the complemented bits
+    size_t first = BitVector::npos;
+    for (size_t i = 0; i < n && first == BitVector::npos; ++i)
+      if (ref[i])
+        first = i;
+    assert(v.find_first() == first);
+    std::vector<word_t> words = v.to_words();
+    for (size_t i = 0; i < n; ++i)
+      assert(word_bit(words.data(), i) == ref[i]);
+    if (n % BITS_PER_WORD != 0)
+      assert((words.back() >> (n % BITS_PER_WORD)) == 0);
+
+    BitVector plain = from_bits(ref);
+    assert(v == plain);
+    assert(v.hash() == plain.hash());
+    assert(v.complement_pending()); // nothing above wrote the words
+
+    // an expression reads the flag; a mutation applies it
+    BitVector both = v & plain;
+    assert(both == plain && !both.complement_pending());
+    if (n > 0) {
+      v.flip(0);
+      ref[0] = !ref[0];
+      assert(!v.complement_pending());
+      assert(matches(v, ref));
+    }
+  }
+}
+
+void testComplementShared() {
+  Bits ref = random_bits(300);
+  BitVector original = from_bits(ref);
+  original.make_shareable();
+  BitVector copy = original;
+  copy.flipAll();
+  assert(copy.shares_words()); // the flag alone changed
+  assert(matches(copy, complement(ref)));
+  assert(matches(original, ref));
+
+  copy.words(); // applies the complement in a private buffer
+  assert(!copy.shares_words() && !original.shares_words());
+  assert(matches(copy, complement(ref)));
+  assert(matches(original, ref));
+}
+
+void testComplementBorrowed() {
+  // flipAll writes through at once
+  std::vector<word_t> buf(2, 0);
+  BitVector v = BitVector::borrow(buf, 100);
+  v.flipAll();
+  assert(!v.complement_pending());
+  assert(buf[0] == ~word_t(0) && buf[1] == (word_t(1) << 36) - 1);
+
+  // assigning a complemented vector stores the bits as read
+  BitVector s(100);
+  s.set(3, true);
+  s.flipAll();
+  v = s;
+  assert(!v.get(3) && v.get(4));
+  assert(!word_bit(buf.data(), 3) && word_bit(buf.data(), 4));
+  assert(buf[1] >> 36 == 0);
+  BitVector again = BitVector::borrow(buf, 100);
+  assert(again == s);
+}
+
+void testComplementMapped() {
+  std::string path = temp_path("bitvector_test_complement.bits");
+  std::filesystem::remove(path);
+  Bits ref = random_bits(150);
+  {
+    BitVector m =
+        BitVector::map_file(path, 150, BitVector::MapMode::ReadWrite);
+    BitVector s = from_bits(complement(ref));
+    s.flipAll(); // reads as ref
+    m = s;
+    m.sync();
+  }
+  assert(matches(BitVector::map_file(path, 150), ref));
+  {
+    BitVector m =
+        BitVector::map_file(path, 150, BitVector::MapMode::ReadWrite);
+    m.flipAll();
+    m.sync();
+  }
+  assert(matches(BitVector::map_file(path, 150), complement(ref)));
+  std::filesystem::remove(path);
+}
+
+void testComplementView() {
+  BitMatrix source(4, 70);
+  std::ostringstream os;
+  source.save(os);
+  std::string bytes = os.str();
+  // word-aligned copy of the snapshot
+  std::vector<word_t> buf((bytes.size() + sizeof(word_t) - 1) /
+                          sizeof(word_t));
+  std::memcpy(buf.data(), bytes.data(), bytes.size());
+  std::span<std::byte> snapshot(reinterpret_cast<std::byte *>(buf.data()),
+                                bytes.size());
+
+  Bits ref = random_bits(70);
+  {
+    BitMatrix view = BitMatrix::view(snapshot, false);
+    BitVector row = from_bits(complement(ref));
+    row.flipAll();
+    view[2] = row;
+  }
+  BitMatrix reread = BitMatrix::view(snapshot, false);
+  assert(matches(reread[2], ref));
+  assert(reread[1].weight() == 0);
+}
+
+void testComplementMatrix() {
+  BitMatrix m(9, 130);
+  for (size_t j = 0; j < 9; ++j)
+    m[j] = from_bits(random_bits(130));
+  BitMatrix inverted = ~m;
+  for (size_t j = 0; j < 9; ++j)
+    for (size_t i = 0; i < 130; ++i)
+      assert(inverted[j][i] != m[j][i]);
+  assert(~inverted == m);
+  std::cout << "All complement tests passed!" << std::endl;
+}
+
+// Const readers of a complemented, shared vector never write it, so
+// several threads may export it at once (run under TSan)
+void testComplementConstReads() {
+  Bits ref = random_bits(5000);
+  BitVector owner = from_bits(complement(ref));
+  owner.make_shareable();
+  BitVector source = owner;
+  source.flipAll();
+  const BitVector &v = source;
+  BitMatrix rows(3, ref.size());
+  for (size_t j = 0; j < 3; ++j)
+    rows[j] = v;
+  std::vector<uint64_t> ones(ref.size(), 1);
+  BitSlicedColumn column(ones);
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t)
+    readers.emplace_back([&] {
+      assert(AtomicBitVector(v).snapshot() == v);
+      AtomicBitVector merged(v.size());
+      merged.merge(v);
+      assert(merged.snapshot() == v);
+      std::ostringstream text, snap, matrix;
+      text << v;
+      v.save(snap);
+      rows.save(matrix);
+      assert(text.str() == bit_text(ref));
+      std::istringstream in(snap.str());
+      assert(BitVector::load(in) == v);
+      assert(RleBitVector(v).toBitVector() == v);
+      assert(RoaringBitmap(v).toBitVector() == v);
+      assert(column.sum(v) == v.weight());
+      assert(v.to_words() == from_bits(ref).to_words());
+    });
+  for (std::thread &t : readers)
+    t.join();
+  assert(v.complement_pending() && v.shares_words() && matches(v, ref));
+  std::cout << "All const complement read tests passed!" << std::endl;
+}
+
+// -- RoaringBitmap --
+
+// Chunks of every container kind: sparse (array), dense (bitmap), runs
+static Bits roaring_sample(size_t n) {
+  Bits b = sparse_bits(n, 20);
+  Bits dense = random_bits(n);
+  Bits runs = sparse_bits(n, 500, 3000);
+  size_t chunk = RoaringBitmap::CHUNK_BITS;
+  for (size_t i = 0; i < n; ++i) {
+    if (i / chunk % 3 == 1)
+      b[i] = dense[i];
+    else if (i / chunk % 3 == 2)
+      b[i] = runs[i];
+  }
+  return b;
+}
+
+void testRoaringRoundTrip() {
+  for (size_t n : {0, 100, 65536, 65537, 300000}) {
+    Bits ref = roaring_sample(n);
+    RoaringBitmap r{from_bits(ref)};
+    assert(r.size() == n);
+    assert(matches(r.toBitVector(), ref));
+    size_t ones = 0, first = RoaringBitmap::npos;
+    for (size_t i = 0; i < n; ++i) {
+      assert(r.get(i) == ref[i]);
+      if (ref[i] && first == RoaringBitmap::npos)
+        first = i;
+      ones += ref[i];
+    }
+    assert(r.weight() == ones && r.find_first() == first);
+    std::vector<size_t> visited;
+    r.for_each_set_bit([&](size_t i) { visited.push_back(i); });
+    assert(visited.size() == ones);
+    assert(std::is_sorted(visited.begin(), visited.end()));
+
+    RoaringBitmap optimized = r;
+    optimized.runOptimize();
+    assert(optimized == r && matches(optimized.toBitVector(), ref));
+  }
+}
+
+void testRoaringSetAndAlgebra() {
+  size_t n = 200000;
+  Bits a = roaring_sample(n), b = roaring_sample(n);
+  RoaringBitmap ra{from_bits(a)}, rb{from_bits(b)};
+  // grow a sparse chunk into a bitmap and back by single writes
+  for (size_t i = 0; i < 6000; ++i) {
+    size_t k = rng() % 70000;
+    bool value = i < 5000;
+    ra.set(k, value);
+    a[k] = value;
+  }
+  assert(matches(ra.toBitVector(), a));
+
+  BitVector da = from_bits(a), db = from_bits(b);
+  assert((ra & rb).toBitVector() == BitVector(da & db));
+  assert((ra | rb).toBitVector() == BitVector(da | db));
+  assert((ra ^ rb).toBitVector() == BitVector(da ^ db));
+  RoaringBitmap c = ra;
+  c ^= rb;
+  c |= rb;
+  assert(c.toBitVector() == BitVector((da ^ db) | db));
+
+  // a shorter right operand is zero-extended, like BitVector
+  Bits shortb = roaring_sample(70000);
+  RoaringBitmap rs{from_bits(shortb)};
+  assert((ra | rs).toBitVector() == BitVector(da | from_bits(shortb)));
+  std::cout << "All RoaringBitmap tests passed!" << std::endl;
+}
+
+// -- rank/select --
+
+// rank1 and select1 against a running count, with the current index state
+static void check_rank_select(const BitVector &v, const Bits &ref) {
+  size_t ones = 0;
+  for (size_t i = 0; i < ref.size(); ++i) {
+    assert(v.rank1(i) == ones);
+    if (ref[i]) {
+      assert(v.select1(ones) == i);
+      ++ones;
+    }
+  }
+  assert(v.rank1(ref.size()) == ones);
+  assert(v.select1(ones) == BitVector::npos);
+  assert(v.select1(BitVector::npos) == BitVector::npos);
+}
+
+void testRankSelect() {
+  for (size_t n : {0, 1, 63, 64, 65, 511, 512, 513, 4097, 70000}) {
+    for (unsigned ones : {0, 3, 500, 1000}) {
+      Bits ref = sparse_bits(n, ones);
+      BitVector v = from_bits(ref);
+      check_rank_select(v, ref);
+      v.build_rank_select();
+      assert(v.has_rank_select());
+      check_rank_select(v, ref);
+      assert(throws<std::out_of_range>([&] { v.rank1(n + 1); }));
+    }
+  }
+
+  // mutation drops the index, copies do not carry it
+  Bits ref = random_bits(10000);
+  BitVector v = from_bits(ref);
+  v.build_rank_select();
+  BitVector copy = v;
+  assert(!copy.has_rank_select());
+  v.flip(1234);
+  ref[1234] = !ref[1234];
+  assert(!v.has_rank_select());
+  check_rank_select(v, ref);
+  v.build_rank_select();
+  v.flipAll();
+  assert(!v.has_rank_select());
+  check_rank_select(v, complement(ref));
+  std::cout << "All rank/select tests passed!" << std::endl;
+}
+
+// -- run-length encoding --
+
+// Content matches ref and the run list is sorted, disjoint, never adjacent
+static bool rle_matches(const RleBitVector &v, const Bits &ref) {
+  const std::vector<RleBitVector::Run> &runs = v.runs();
+  for (size_t k = 0; k < runs.size(); ++k) {
+    if (runs[k].start >= runs[k].end || runs[k].end > v.size())
+      return false;
+    if (k && runs[k - 1].end >= runs[k].start)
+      return false;
+  }
+  return v.run_count() == runs.size() && matches(v.toBitVector(), ref);
+}
+
+void testRleRoundTrip() {
+  for (size_t n : {0, 1, 64, 65, 1000, 100000}) {
+    for (size_t run_length : {1, 7, 300}) {
+      Bits ref = sparse_bits(n, 500, run_length);
+      RleBitVector r{from_bits(ref)};
+      assert(r.size() == n && rle_matches(r, ref));
+      size_t first = RleBitVector::npos;
+      for (size_t i = 0; i < n && first == RleBitVector::npos; ++i)
+        if (ref[i])
+          first = i;
+      assert(r.find_first() == first);
+      for (size_t i = 0; i < n; i += 1 + n / 500)
+        assert(r.get(i) == ref[i] && r[i] == ref[i]);
+    }
+  }
+  assert(rle_matches(RleBitVector(130, true), Bits(130, true)));
+  assert(RleBitVector(130, true).run_count() == 1);
+  assert(throws<std::out_of_range>([] { RleBitVector(10).get(10); }));
+}
+
+void testRleSetAndAlgebra() {
+  size_t n = 5000;
+  Bits a = sparse_bits(n, 400, 50), b = sparse_bits(n, 600, 13);
+  RleBitVector ra{from_bits(a)}, rb{from_bits(b)};
+  for (int step = 0; step < 300; ++step) {
+    size_t i = rng() % n, k = rng() % 200;
+    bool value = rng() & 1;
+    if (step % 2) {
+      ra.set(i, value);
+      a[i] = value;
+    } else {
+      k = std::min(k, n - i);
+      ra.setRange(i, k, value);
+      std::fill(a.begin() + i, a.begin() + i + k, value);
+    }
+    assert(rle_matches(ra, a));
+  }
+
+  BitVector da = from_bits(a), db = from_bits(b);
+  assert((ra & rb).toBitVector() == BitVector(da & db));
+  assert((ra | rb).toBitVector() == BitVector(da | db));
+  assert((ra ^ rb).toBitVector() == BitVector(da ^ db));
+  assert(rle_matches(~ra, complement(a)) && ~~ra == ra);
+  RleBitVector c = ra;
+  c &= rb;
+  c ^= ra;
+  c |= rb;
+  Bits expected(n);
+  for (size_t i = 0; i < n; ++i)
+    expected[i] = (a[i] && !b[i]) || b[i];
+  assert(rle_matches(c, expected));
+
+  // a shorter right operand is zero-extended, like BitVector
+  Bits shortb = sparse_bits(1000, 500, 20);
+  RleBitVector rs{from_bits(shortb)};
+  assert((ra | rs).toBitVector() == BitVector(da | from_bits(shortb)));
+  assert((ra & rs).size() == n);
+  std::cout << "All RLE tests passed!" << std::endl;
+}
+
+// -- Bloom filter --
+
+void testBloomFilter() {
+  assert(BloomFilter(1).size() == BloomFilter::BLOCK_BITS);
+  assert(BloomFilter(BloomFilter::BLOCK_BITS + 1).block_count() == 2);
+
+  size_t keys = 10000;
+  std::vector<uint64_t> inserted(keys), absent(100000);
+  for (size_t i = 0; i < keys; ++i)
+    inserted[i] = i;
+  for (size_t i = 0; i < absent.size(); ++i)
+    absent[i] = keys + i;
+
+  BloomFilter single = BloomFilter::for_capacity(keys, 0.01, 42);
+  BloomFilter batch = BloomFilter::for_capacity(keys, 0.01, 42);
+  for (uint64_t key : inserted)
+    single.insert(key);
+  batch.insert(inserted);
+  assert(single.bits() == batch.bits());
+
+  // no false negatives, and batched answers match single ones
+  BitVector hits = batch.may_contain(inserted);
+  assert(hits.size() == keys && hits.weight() == keys);
+  BitVector probes = batch.may_contain(absent);
+  size_t false_positives = 0;
+  for (size_t i = 0; i < absent.size(); ++i) {
+    assert(probes.get(i) == batch.may_contain(absent[i]));
+    false_positives += probes.get(i);
+  }
+  assert(false_positives < absent.size() * 3 / 100);
+
+  // union holds both key sets
+  BloomFilter other(batch.size(), 42);
+  other.insert(absent);
+  BloomFilter both = batch | other;
+  assert(both.may_contain(inserted).weight() == keys);
+  assert(both.may_contain(absent).weight() == absent.size());
+  assert(both.bits() == BitVector(batch.bits() | other.bits()));
+
+  batch.clear();
+  assert(batch.fill_ratio() == 0 && !batch.may_contain(inserted[0]));
+
+  assert(throws<std::invalid_argument>(
+      [] { BloomFilter::for_capacity(10, 0.0); }));
+  assert(throws<std::invalid_argument>(
+      [] { BloomFilter::for_capacity(10, 1.0); }));
+  assert(throws<std::invalid_argument>(
+      [&] { single | BloomFilter(single.size(), 7); }));
+  assert(throws<std::invalid_argument>(
+      [&] { single |= BloomFilter(single.size() * 2, 42); }));
+  std::cout << "All Bloom filter tests passed!" << std::endl;
+}
+
+// -- snapshots --
+
+void testSnapshotRoundTrip() {
+  for (size_t n : {0, 1, 64, 65, 1000}) {
+    Bits ref = random_bits(n);
+    BitVector v = from_bits(ref);
+    std::stringstream ss;
+    v.save(ss);
+    assert(matches(BitVector::load(ss), ref));
+    // a stream that cannot seek takes the chunked path
+    PipeBuf pipe(ss.str());
+    std::istream in(&pipe);
+    assert(matches(BitVector::load(in), ref));
+  }
+
+  BitMatrix m(5, 70);
+  for (size_t j = 0; j < 5; ++j)
+    m[j] = from_bits(random_bits(70));
+  std::string path = temp_path("bitvector_test_matrix.snap");
+  m.save(path);
+  assert(BitMatrix::load(path) == m);
+  std::stringstream ss;
+  m.save(ss);
+  PipeBuf pipe(ss.str());
+  std::istream in(&pipe);
+  assert(BitMatrix::load(in) == m);
+  std::filesystem::remove(path);
+
+  // view() reads the saved words in place
+  std::string bytes = ss.str();
+  std::vector<word_t> buf((bytes.size() + sizeof(word_t) - 1) /
+                          sizeof(word_t));
+  std::memcpy(buf.data(), bytes.data(), bytes.size());
+  std::span<std::byte> snapshot(reinterpret_cast<std::byte *>(buf.data()),
+                                bytes.size());
+  assert(BitMatrix::view(snapshot) == m);
+}
+
+void testSnapshotCorrupt() {
+  std::stringstream ss;
+  from_bits(random_bits(200)).save(ss);
+  std::string good = ss.str();
+
+  // a huge size in the header is a truncated snapshot, not an allocation
+  std::string wide = patch_field(good, 16, uint64_t(1) << 40);
+  assert(throws<std::runtime_error>([&] {
+    std::istringstream in(wide);
+    BitVector::load(in);
+  }));
+  assert(throws<std::runtime_error>([&] {
+    PipeBuf pipe(wide);
+    std::istream in(&pipe);
+    BitVector::load(in);
+  }));
+  assert(throws<std::runtime_error>([&] {
+    std::istringstream in(good.substr(0, good.size() - 8));
+    BitVector::load(in);
+  }));
+
+  std::stringstream ms;
+  BitMatrix(3, 100).save(ms);
+  std::string tall = patch_field(ms.str(), 8, uint64_t(1) << 40);
+  assert(throws<std::runtime_error>([&] {
+    std::istringstream in(tall);
+    BitMatrix::load(in);
+  }));
+  assert(throws<std::runtime_error>([&] {
+    PipeBuf pipe(tall);
+    std::istream in(&pipe);
+    BitMatrix::load(in);
+  }));
+
+  // rows without columns hold no words to bound their count
+  std::stringstream es;
+  BitMatrix().save(es);
+  for (uint64_t rows : {uint64_t(1) << 26, uint64_t(1) << 40}) {
+    std::string empty_rows = patch_field(es.str(), 8, rows);
+    assert(throws<std::runtime_error>([&] {
+      std::istringstream in(empty_rows);
+      BitMatrix::load(in);
+    }));
+    std::vector<word_t> mapped(SNAPSHOT_HEADER_BYTES / sizeof(word_t));
+    std::memcpy(mapped.data(), empty_rows.data(), SNAPSHOT_HEADER_BYTES);
+    assert(throws<std::runtime_error>(
+        [&] { BitMatrix::view(std::as_writable_bytes(std::span(mapped))); }));
+  }
+  assert(throws<std::invalid_argument>([] {
+    std::stringstream out;
+    BitMatrix(5, 0).save(out);
+  }));
+  std::stringstream one;
+  BitMatrix(1, 0).save(one);
+  assert(BitMatrix::load(one).rows() == 1);
+  std::cout << "All snapshot tests passed!" << std::endl;
+}
+
+// -- index batches --
+
+void testBatchBits() {
+  Bits ref = random_bits(500);
+  BitVector v = from_bits(ref);
+  std::vector<size_t> idx(300);
+  for (size_t &i : idx)
+    i = rng() % 500;
+  v.set_bits(idx, true);
+  for (size_t i : idx)
+    ref[i] = true;
+  assert(matches(v, ref));
+
+  BitVector found;
+  v.test_bits(idx, found);
+  assert(found.size() == idx.size() && found.weight() == idx.size());
+  std::vector<size_t> mixed = {0, 1, 2, 499, 250};
+  v.flipAll();
+  v.test_bits(mixed, found);
+  for (size_t k = 0; k < mixed.size(); ++k)
+    assert(found.get(k) == !ref[mixed[k]]);
+
+  // one bad index rejects the whole batch before any write
+  BitVector before = v;
+  mixed.push_back(500);
+  bool threw = false;
+  try {
+    v.set_bits(mixed, false);
+  } catch (const std::out_of_range &) {
+    threw = true;
+  }
+  assert(threw && v == before);
+}
+
+void testBatchCells() {
+  std::vector<std::pair<int, int>> edges;
+  for (int k = 0; k < 400; ++k)
+    edges.push_back({int(rng() % 20), int(rng() % 90)});
+  BitMatrix m(20, 90), ref(20, 90);
+  m.set_cells(edges);
+  for (const auto &e : edges)
+    ref.set(size_t(e.first), size_t(e.second), true);
+  assert(m == ref);
+
+  std::vector<pair> cells = {{3, 4}, {19, 89}};
+  m.set_cells(cells, false);
+  ref.set(3, 4, false);
+  ref.set(19, 89, false);
+  assert(m == ref);
+
+  // negative and too large indices are rejected, nothing written
+  for (std::pair<int, int> bad : {std::pair{-1, 0}, std::pair{0, -5},
+                                  std::pair{20, 0}, std::pair{0, 90}}) {
+    std::vector<std::pair<int, int>> batch = {{1, 1}, bad};
+    bool threw = false;
+    try {
+      m.set_cells(batch);
+    } catch (const std::out_of_range &) {
+      threw = true;
+    }
+    assert(threw && m == ref);
+  }
+  std::cout << "All batch tests passed!" << std::endl;
+}
+
+int main() {
+  testRoaringRoundTrip();
+  testRoaringSetAndAlgebra();
+  testRankSelect();
+  testRleRoundTrip();
+  testRleSetAndAlgebra();
+  testBloomFilter();
+  testShifts();
+  testRotations();
+  testExpressions();
+  testTextKernels();
+  testComparisons();
+  testFields();
+  testWordConversion();
+  testParallelVectors();
+  testParallelMatrix();
+  testBitSlicedColumn();
+  testBitSlicedColumnParallel();
+  testAtomicRaces();
+  testAtomicBasics();
+  testCopyOnWrite();
+  testForeignStorage();
+  testRejectedWrites();
+  testComplementOwned();
+  testComplementShared();
+  testComplementBorrowed();
+  testComplementMapped();
+  testComplementView();
+  testComplementMatrix();
+  testComplementConstReads();
+  testSnapshotRoundTrip();
+  testSnapshotCorrupt();
+  testBatchBits();
+  testBatchCells();
+
+  std::cout << "All tests passed successfully!" << std::endl;
+  return 0;
+}
@@ -22,9 +22,7 @@ using std::vector;
 // Convert edge list to adjacency matrix
 BitMatrix to_matrix(std::vector<std::pair<int, int>> &_graph, int nodes) {
   BitMatrix out(nodes, nodes, false);
-  for (auto pair : _graph) {
-    out.set(pair.first, pair.second, true);
-  }
+  out.set_cells(_graph);
   return out;
 }
 
@@ -90,41 +88,20 @@ void topSortMatrix(BitMatrix &matrix, vector<int> &sorted) {
 
   int n = matrix.rows();
 
-  DynamicArray<int> inA;
-  for (int i = 0; i < n; i++) {
-    inA.push_back(i);
-  }
-
-  // std::cout << inA << '\n';
-
-  while (!inA.empty()) {
+  // Vertices not yet placed in the order
+  BitVector inA(static_cast<size_t>(n), true);
 
-    for (auto column : inA) {
-      bool noTrue{true};
+  while (inA.weight() != 0) {
+    // A column with a set bit in any row still has an incoming edge; the first
+    // remaining vertex without one is found word-wise instead of bit by bit.
+    BitVector ready = inA & ~matrix.disjunction_rows();
+    size_t column = ready.find_first();
+    if (column == BitVector::npos)
+      break; // only vertices on a cycle remain
 
-      for (int i = 0; i < n; i++) {
-        if (matrix[i].get(column) == true) {
-          noTrue = false;
-          break;
-        };
-      }
-
-      if (noTrue) {
-        sorted.push_back(column);
-        matrix[column].setAll(false);
-        inA.pop_first(column);
-        break;
-
-        // // Debug
-        // std::cout << "--- inA --- \n" << inA << '\n';
-        // std::cout << "--- Sorted --- \n";
-        // for (auto i : sorted) {
-        //   std::cout << " " << i;
-        // }
-        // std::cout << '\n';
-        // std::cout << "--- Matrix --- \n" << matrix << '\n';
-      }
-    }
+    sorted.push_back(static_cast<int>(column));
+    matrix[column].setAll(false);
+    inA.set(column, false);
   }
 
   // Check if topological sort is possible (no cycles)
@@ -0,0 +1,11 @@
+#pragma once
+
+// 64-bit hash of a word array for BitVector::hash() and std::hash.
+// wyhash-style: each pair of words is folded into the state with one
+// 64x64->128 multiply, so hashing runs at several GB/s. Not for adversarial
+// input.
+
+#include <cstddef>
+#include <cstdint>
+
+uint64_t hash_words(const uint64_t *words, size_t n, uint64_t seed);
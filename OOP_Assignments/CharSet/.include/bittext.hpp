@@ -0,0 +1,25 @@
+#pragma once
+
+// Conversion between '0'/'1' text and BitVector words, used by the bit
+// string constructor and the stream operators.
+// Character i maps to bit i % 64 of word i / 64. The kernel (scalar,
+// AVX2 or AVX-512BW, 32 or 64 characters per compare) is picked once at
+// runtime from the CPU features.
+
+#include <cstddef>
+#include <cstdint>
+
+// Pack text[0 .. n) into (n + 63) / 64 words; the unused bits of the last
+// word are zero. Returns false if a character is neither '0' nor '1'.
+bool parse_bits(const char *text, size_t n, uint64_t *words);
+
+// Expand the first n bits of words into out[0 .. n) as '0'/'1'
+void format_bits(const uint64_t *words, size_t n, char *out);
+
+// Name of the selected kernel: "generic", "avx2" or "avx512"
+const char *bittext_kernel();
+
+// Switches to the named kernel (tests, benchmarks). Returns false, keeping
+// the current one, when this CPU cannot run it. Not safe while another
+// thread parses or formats.
+bool bittext_use_kernel(const char *name);
@@ -1,20 +1,80 @@
 #include "bitvector.hpp"
+#include "bithash.hpp"
+#include "bittext.hpp"
+#include "popcount.hpp"
 
-#include <algorithm> // std::max, std::fill_n
+#include <algorithm> // std::min, std::fill_n
 #include <bit>
 #include <bitset>
 #include <climits>
 #include <cstddef>
 #include <cstring> // std::memcpy, std::strlen
 #include <iostream>
+#include <new> // std::align_val_t
 #include <stdexcept>
 #include <string>
 
-// -- static helper --
+// -- static helpers --
 size_t BitVector::bytes_for_bits(size_t bits) {
   return (bits + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
 }
 
+size_t BitVector::words_for_bits(size_t bits) {
+  return (bits + BITS_PER_WORD - 1) / BITS_PER_WORD;
+}
+
+// -- word storage --
+BitVector::WordStorage::WordStorage(size_t nwords) {
+  if (nwords == 0)
+    return;
+  if (nwords <= INLINE_WORDS) {
+    ptr = local;
+    return;
+  }
+  void *raw = ::operator new[](nwords * sizeof(word_t),
+                               std::align_val_t{WORD_ALIGNMENT});
+  ptr = static_cast<word_t *>(raw);
+}
+
+BitVector::WordStorage::WordStorage(WordStorage &&other) noexcept {
+  steal(other);
+}
+
+BitVector::WordStorage &
+BitVector::WordStorage::operator=(WordStorage &&other) noexcept {
+  if (this != &other) {
+    reset();
+    steal(other);
+  }
+  return *this;
+}
+
+BitVector::WordStorage::~WordStorage() { reset(); }
+
+// Inline words are copied (a few words, no allocation); heap buffers change
+// owner. Leaves other empty.
+void BitVector::WordStorage::steal(WordStorage &other) noexcept {
+  if (other.is_inline()) {
+    std::memcpy(local, other.local, sizeof(local));
+    ptr = local;
+  } else {
+    ptr = other.ptr;
+  }
+  other.ptr = nullptr;
+}
+
+void BitVector::WordStorage::swap(WordStorage &other) noexcept {
+  WordStorage tmp(std::move(other));
+  other = std::move(*this);
+  *this = std::move(tmp);
+}
+
+void BitVector::WordStorage::reset() noexcept {
+  if (ptr && !is_inline())
+    ::operator delete[](ptr, std::align_val_t{WORD_ALIGNMENT});
+  ptr = nullptr;
+}
+
 // -- last_byte_mask --
 byte_t BitVector::last_byte_mask() const {
   size_t rem = nbits % BITS_PER_BYTE;
@@ -23,28 +83,38 @@ byte_t BitVector::last_byte_mask() const {
   return static_cast<byte_t>((1u << rem) - 1u);
 }
 
-// -- check_index --
-void BitVector::check_index(size_t i) const {
-  if (i >= nbits)
-    throw std::out_of_range("Index");
+// -- last_word_mask --
+word_t BitVector::last_word_mask() const {
+  size_t rem = nbits % BITS_PER_WORD;
+  if (rem == 0)
+    return ~word_t(0);
+  return (word_t(1) << rem) - 1;
+}
+
+void BitVector::clear_tail() noexcept {
+  if (nbits % BITS_PER_WORD != 0)
+    data[words_for_bits(nbits) - 1] &= last_word_mask();
 }
 
+// -- check_index --
+void BitVector::throw_index_error() { throw std::out_of_range("Index"); }
+
 // -- coord --
 pair BitVector::coord(size_t i) const {
-  size_t b = i / BITS_PER_BYTE;
-  size_t off = i % BITS_PER_BYTE;
-  return {b, off};
+  size_t w = i / BITS_PER_WORD;
+  size_t off = i % BITS_PER_WORD;
+  return {w, off};
 }
 
 // -- constructors / assignment --
 
 BitVector::BitVector(size_t size, bool value) : nbits(size) {
-  size_t nbytes = bytes_for_bits(size);
-  if (nbytes) {
-    data = std::make_unique<byte_t[]>(nbytes);
-    std::fill_n(data.get(), nbytes, value ? byte_t(0xFF) : byte_t(0x00));
-    if (value && (nbits % BITS_PER_BYTE != 0))
-      data[nbytes - 1] &= last_byte_mask();
+  size_t nwords = words_for_bits(size);
+  if (nwords) {
+    data = WordStorage(nwords);
+    std::fill_n(data.get(), nwords, value ? ~word_t(0) : word_t(0));
+    if (value)
+      clear_tail();
   }
 }
 
@@ -52,37 +122,33 @@ BitVector::BitVector(const char *bitstr) {
   if (!bitstr)
     throw std::invalid_argument("Null string");
   nbits = std::strlen(bitstr);
-  size_t nbytes = bytes_for_bits(nbits);
-  if (nbytes) {
-    data = std::make_unique<byte_t[]>(nbytes);
-    std::fill_n(data.get(), nbytes, byte_t(0x00));
-    for (size_t i = 0; i < nbits; ++i) {
-      char c = bitstr[i];
-      if (c != '0' && c != '1')
-        throw std::invalid_argument("Bit string must be '0' or '1'");
-      if (c == '1')
-        data[i / BITS_PER_BYTE] |=
-            static_cast<byte_t>(1u << (i % BITS_PER_BYTE));
-    }
+  size_t nwords = words_for_bits(nbits);
+  if (nwords) {
+    data = WordStorage(nwords);
+    if (!parse_bits(bitstr, nbits, data.get()))
+      throw std::invalid_argument("Bit string must be '0' or '1'");
   }
 }
 
 BitVector::BitVector(const BitVector &other) : nbits(other.nbits) {
-  size_t nbytes = bytes_for_bits(nbits);
-  if (nbytes) {
-    data = std::make_unique<byte_t[]>(nbytes);
-    std::memcpy(data.get(), other.data.get(), nbytes);
+  size_t nwords = words_for_bits(nbits);
+  if (nwords) {
+    data = WordStorage(nwords);
+    std::memcpy(data.get(), other.data.get(), nwords * sizeof(word_t));
   }
 }
 
 BitVector &BitVector::operator=(const BitVector &other) {
   if (this == &other)
     return *this;
-  size_t nbytes = bytes_for_bits(other.nbits);
-  if (nbytes) {
-    auto tmp = std::unique_ptr<byte_t[]>(new byte_t[nbytes]);
-    std::memcpy(tmp.get(), other.data.get(), nbytes);
-    data.swap(tmp);
+  size_t nwords = words_for_bits(other.nbits);
+  if (nwords) {
+    // Reuse the buffer when the word count already matches
+    if (nwords != words_for_bits(nbits) || !data) {
+      WordStorage tmp(nwords);
+      data.swap(tmp);
+    }
+    std::memcpy(data.get(), other.data.get(), nwords * sizeof(word_t));
   } else {
     data.reset();
   }
@@ -97,9 +163,6 @@ void BitVector::swap(BitVector &other) noexcept {
 }
 void swap(BitVector &a, BitVector &b) noexcept { a.swap(b); }
 
-// -- size --
-size_t BitVector::size() const noexcept { return nbits; }
-
 // -- BoolRef definitions --
 BitVector::BoolRef::BoolRef(BitVector &parent, size_t i) : bv(parent), idx(i) {}
 
@@ -129,212 +192,389 @@ int BitVector::value() const {
   return val;
 }
 
-// -- get / set / flip --
-bool BitVector::get(size_t i) const {
-  check_index(i);
-  pair position = coord(i);
-  return (data[position.first] >> position.second) & 1u;
+// -- flipAll --
+void BitVector::flipAll() {
+  size_t nwords = words_for_bits(nbits);
+  for (size_t i = 0; i < nwords; ++i)
+    data[i] = ~data[i];
+  if (nwords)
+    clear_tail();
 }
 
-void BitVector::set(size_t i, bool value) {
-  check_index(i);
-  pair b = coord(i);
-  byte_t mask = static_cast<byte_t>(1u << b.second);
-  if (value)
-    data[b.first] |= mask;
-  else
-    data[b.first] &= static_cast<byte_t>(~mask);
-}
+// -- ranges and setAll --
+// Only the partial head and tail words are masked; the words in between are
+// written whole.
 
-void BitVector::flip(size_t i) {
-  check_index(i);
-  pair b = coord(i);
-  data[b.first] ^= static_cast<byte_t>(1u << b.second);
+// Mask of the bits of word w that fall inside [from, to), with from < to
+static word_t range_word_mask(size_t w, size_t from, size_t to) {
+  word_t mask = ~word_t(0);
+  if (w == from / BITS_PER_WORD)
+    mask &= ~word_t(0) << (from % BITS_PER_WORD);
+  if (w == (to - 1) / BITS_PER_WORD)
+    mask &= ~word_t(0) >> (BITS_PER_WORD - 1 - (to - 1) % BITS_PER_WORD);
+  return mask;
 }
 
-void BitVector::flipAll() {
-  size_t nbytes = bytes_for_bits(nbits);
-  for (size_t i = 0; i < nbytes; ++i)
-    data[i] = static_cast<byte_t>(~data[i]);
-  if (nbytes && (nbits % BITS_PER_BYTE != 0))
-    data[nbytes - 1] &= last_byte_mask();
+void BitVector::setRange(size_t i, size_t k, bool value) {
+  if (k == 0)
+    return;
+  if (i + k > nbits)
+    throw std::out_of_range("Range out of bounds");
+  size_t first = i / BITS_PER_WORD;
+  size_t last = (i + k - 1) / BITS_PER_WORD;
+  word_t head = range_word_mask(first, i, i + k);
+  word_t tail = range_word_mask(last, i, i + k);
+  data[first] = value ? data[first] | head : data[first] & ~head;
+  if (first == last)
+    return;
+  std::fill_n(data.get() + first + 1, last - first - 1,
+              value ? ~word_t(0) : word_t(0));
+  data[last] = value ? data[last] | tail : data[last] & ~tail;
 }
 
-// -- ranges and setAll --
-void BitVector::setRange(size_t i, size_t k, bool value) {
+void BitVector::flipRange(size_t i, size_t k) {
   if (k == 0)
     return;
   if (i + k > nbits)
     throw std::out_of_range("Range out of bounds");
-  for (size_t pos = i; pos < i + k; ++pos)
-    set(pos, value);
+  size_t first = i / BITS_PER_WORD;
+  size_t last = (i + k - 1) / BITS_PER_WORD;
+  data[first] ^= range_word_mask(first, i, i + k);
+  if (first == last)
+    return;
+  for (size_t w = first + 1; w < last; ++w)
+    data[w] = ~data[w];
+  data[last] ^= range_word_mask(last, i, i + k);
 }
 
 void BitVector::setAll(bool value) {
-  size_t nbytes = bytes_for_bits(nbits);
-  if (nbytes == 0)
+  size_t nwords = words_for_bits(nbits);
+  if (nwords == 0)
     return;
-  for (size_t pos = 0; pos < nbits; ++pos)
-    set(pos, value);
-  if (value && (nbits % BITS_PER_BYTE != 0))
-    data[nbytes - 1] &= last_byte_mask();
+  std::fill_n(data.get(), nwords, value ? ~word_t(0) : word_t(0));
+  if (value)
+    clear_tail();
 }
 
 // -- weight --
 size_t BitVector::weight() const {
-  size_t cnt = 0;
-  for (size_t i = 0; i < nbits; ++i) {
-    if (get(i))
-      ++cnt;
-  }
+  return popcount_words(data.get(), words_for_bits(nbits));
+}
+
+size_t BitVector::weight(size_t from, size_t to) const {
+  if (from > to || to > nbits)
+    throw std::out_of_range("Range out of bounds");
+  if (from == to)
+    return 0;
+  size_t first = from / BITS_PER_WORD;
+  size_t last = (to - 1) / BITS_PER_WORD;
+  word_t head = ~word_t(0) << (from % BITS_PER_WORD);
+  word_t tail = ~word_t(0) >> (BITS_PER_WORD - 1 - (to - 1) % BITS_PER_WORD);
+  if (first == last)
+    return static_cast<size_t>(std::popcount(data[first] & head & tail));
+  size_t cnt = static_cast<size_t>(std::popcount(data[first] & head));
+  cnt += popcount_words(data.get() + first + 1, last - first - 1);
+  cnt += static_cast<size_t>(std::popcount(data[last] & tail));
   return cnt;
 }
 
+// -- set-bit search --
+// Skip whole zero words, then count trailing/leading zeros inside the word.
+
+size_t BitVector::find_first() const noexcept {
+  size_t nwords = words_for_bits(nbits);
+  for (size_t w = 0; w < nwords; ++w)
+    if (data[w])
+      return w * BITS_PER_WORD + static_cast<size_t>(std::countr_zero(data[w]));
+  return npos;
+}
+
+size_t BitVector::find_next(size_t i) const noexcept {
+  if (i == npos || i + 1 >= nbits)
+    return npos;
+  size_t j = i + 1;
+  size_t nwords = words_for_bits(nbits);
+  size_t w = j / BITS_PER_WORD;
+  word_t word = data[w] & (~word_t(0) << (j % BITS_PER_WORD));
+  while (true) {
+    if (word)
+      return w * BITS_PER_WORD + static_cast<size_t>(std::countr_zero(word));
+    if (++w >= nwords)
+      return npos;
+    word = data[w];
+  }
+}
+
+size_t BitVector::find_last() const noexcept { return find_prev(nbits); }
+
+size_t BitVector::find_prev(size_t i) const noexcept {
+  if (i == 0 || nbits == 0)
+    return npos;
+  size_t j = std::min(i, nbits) - 1;
+  size_t w = j / BITS_PER_WORD;
+  word_t word =
+      data[w] & (~word_t(0) >> (BITS_PER_WORD - 1 - j % BITS_PER_WORD));
+  while (true) {
+    if (word)
+      return w * BITS_PER_WORD + BITS_PER_WORD - 1 -
+             static_cast<size_t>(std::countl_zero(word));
+    if (w == 0)
+      return npos;
+    word = data[--w];
+  }
+}
+
 // -- operator[] --
 BitVector::BoolRef BitVector::operator[](size_t i) {
   check_index(i);
   return BoolRef(*this, i);
 }
 
-bool BitVector::operator[](size_t i) const { return get(i); }
-
 // -- comparison --
-bool BitVector::operator==(BitVector &rhs) const {
-  if (nbits != rhs.nbits) {
-    return false;
-  }
-  for (size_t i = 0; i < nbits; i++) {
-    if (get(i) != rhs.get(i))
-      return false;
-  }
-  return true;
-}
-
-// -- bitwise ops --
-BitVector BitVector::operator&(const BitVector &rhs) const {
-  BitVector out(*this);
-  size_t nbytes = bytes_for_bits(std::max(nbits, rhs.nbits));
-  for (size_t i = 0; i < nbytes; ++i)
-    out.data[i] &= rhs.data[i];
-  if (nbytes && (std::max(nbits, rhs.nbits) % BITS_PER_BYTE != 0))
-    out.data[nbytes - 1] &= out.last_byte_mask();
-  return out;
-}
+bool BitVector::operator==(const BitVector &rhs) const {
+  return nbits == rhs.nbits &&
+         std::equal(data.get(), data.get() + words_for_bits(nbits),
+                    rhs.data.get());
+}
+
+std::strong_ordering BitVector::operator<=>(const BitVector &rhs) const {
+  size_t common = std::min(nbits, rhs.nbits);
+  size_t full = common / BITS_PER_WORD;
+  const word_t *a = data.get();
+  const word_t *b = rhs.data.get();
+  size_t w = static_cast<size_t>(std::mismatch(a, a + full, b).first - a);
+  word_t diff = 0;
+  if (w < full)
+    diff = a[w] ^ b[w];
+  else if (common % BITS_PER_WORD != 0)
+    diff = (a[w] ^ b[w]) & ((word_t(1) << (common % BITS_PER_WORD)) - 1);
+  if (diff != 0) // the lowest differing bit decides
+    return (a[w] >> std::countr_zero(diff)) & 1u ? std::strong_ordering::greater
+                                                  : std::strong_ordering::less;
+  return nbits <=> rhs.nbits;
+}
+
+// -- hashing --
+size_t BitVector::hash() const noexcept {
+  return static_cast<size_t>(
+      hash_words(data.get(), words_for_bits(nbits), nbits));
+}
+
+// -- word view --
+const word_t *BitVector::words() const noexcept { return data.get(); }
+
+size_t BitVector::word_count() const noexcept { return words_for_bits(nbits); }
+
+// -- bitwise ops (in place) --
+// The result keeps this vector's length; missing rhs words read as zero.
 BitVector &BitVector::operator&=(const BitVector &rhs) {
-  *this = *this & rhs;
+  size_t nwords = words_for_bits(nbits);
+  size_t common = std::min(nwords, words_for_bits(rhs.nbits));
+  for (size_t i = 0; i < common; ++i)
+    data[i] &= rhs.data[i];
+  for (size_t i = common; i < nwords; ++i)
+    data[i] = 0;
+  if (nwords)
+    clear_tail();
   return *this;
 }
 
-BitVector BitVector::operator|(const BitVector &rhs) const {
-  BitVector out(*this);
-  size_t nbytes = bytes_for_bits(std::max(nbits, rhs.nbits));
-  for (size_t i = 0; i < nbytes; ++i)
-    out.data[i] |= rhs.data[i];
-  if (nbytes && (std::max(nbits, rhs.nbits) % BITS_PER_BYTE != 0))
-    out.data[nbytes - 1] &= out.last_byte_mask();
-  return out;
-}
 BitVector &BitVector::operator|=(const BitVector &rhs) {
-  *this = *this | rhs;
+  size_t nwords = words_for_bits(nbits);
+  size_t common = std::min(nwords, words_for_bits(rhs.nbits));
+  for (size_t i = 0; i < common; ++i)
+    data[i] |= rhs.data[i];
+  if (nwords)
+    clear_tail();
   return *this;
 }
 
-BitVector BitVector::operator^(const BitVector &rhs) const {
-  BitVector out(*this);
-  size_t nbytes = bytes_for_bits(std::max(nbits, rhs.nbits));
-  for (size_t i = 0; i < nbytes; ++i)
-    out.data[i] ^= rhs.data[i];
-  if (nbytes && (std::max(nbits, rhs.nbits) % BITS_PER_BYTE != 0))
-    out.data[nbytes - 1] &= out.last_byte_mask();
-  return out;
-}
 BitVector &BitVector::operator^=(const BitVector &rhs) {
-  *this = *this ^ rhs;
+  size_t nwords = words_for_bits(nbits);
+  size_t common = std::min(nwords, words_for_bits(rhs.nbits));
+  for (size_t i = 0; i < common; ++i)
+    data[i] ^= rhs.data[i];
+  if (nwords)
+    clear_tail();
   return *this;
 }
 
-// bitwise NOT
-BitVector BitVector::operator~() const {
-  BitVector out(*this);
-  size_t nbytes = bytes_for_bits(nbits);
-  for (size_t i = 0; i < nbytes; ++i)
-    out.data[i] = static_cast<byte_t>(~out.data[i]);
-  if (nbytes && (nbits % BITS_PER_BYTE != 0))
-    out.data[nbytes - 1] &= out.last_byte_mask();
-  return out;
+// -- word shift kernels --
+// Both move whole words and funnel-shift the remainder in from the
+// neighbouring word: out = (w[k] >> r) | (w[k + 1] << (64 - r)).
+
+// Bit i of dst becomes bit i + off of src (towards index 0)
+void BitVector::shift_words_down(word_t *dst, const word_t *src, size_t nwords,
+                                 size_t off) {
+  size_t q = off / BITS_PER_WORD;
+  size_t r = off % BITS_PER_WORD;
+  size_t w = 0;
+  if (q < nwords) {
+    size_t last = nwords - q - 1; // last dst word that still has a source
+    if (r == 0) {
+      std::memmove(dst, src + q, (last + 1) * sizeof(word_t));
+      w = last + 1;
+    } else {
+      for (; w < last; ++w)
+        dst[w] = (src[w + q] >> r) | (src[w + q + 1] << (BITS_PER_WORD - r));
+      dst[w] = src[w + q] >> r;
+      ++w;
+    }
+  }
+  for (; w < nwords; ++w)
+    dst[w] = 0;
+}
+
+// Bit i + off of dst becomes bit i of src (towards the end).
+// Walks from the top so an in-place shift never reads a word it already wrote.
+void BitVector::shift_words_up(word_t *dst, const word_t *src, size_t nwords,
+                               size_t off) {
+  size_t q = off / BITS_PER_WORD;
+  size_t r = off % BITS_PER_WORD;
+  size_t w = nwords;
+  if (r == 0) {
+    if (q < nwords)
+      std::memmove(dst + q, src, (nwords - q) * sizeof(word_t));
+    w = std::min(q, nwords);
+  } else {
+    for (; w > q + 1; --w)
+      dst[w - 1] =
+          (src[w - 1 - q] << r) | (src[w - 2 - q] >> (BITS_PER_WORD - r));
+    if (w > q) {
+      dst[q] = src[0] << r;
+      w = q;
+    }
+  }
+  for (; w > 0; --w)
+    dst[w - 1] = 0;
+}
+
+void BitVector::copy_words_from(word_t *dst, size_t count, size_t pos) const {
+  size_t nwords = words_for_bits(nbits);
+  size_t q = pos / BITS_PER_WORD;
+  size_t r = pos % BITS_PER_WORD;
+  for (size_t w = 0; w < count; ++w) {
+    size_t s = q + w;
+    word_t lo = s < nwords ? data[s] : 0;
+    if (r == 0) {
+      dst[w] = lo;
+    } else {
+      word_t hi = s + 1 < nwords ? data[s + 1] : 0;
+      dst[w] = (lo >> r) | (hi << (BITS_PER_WORD - r));
+    }
+  }
+}
+
+void BitVector::or_words_at(const word_t *src, size_t count, size_t pos) {
+  size_t nwords = words_for_bits(nbits);
+  size_t q = pos / BITS_PER_WORD;
+  size_t r = pos % BITS_PER_WORD;
+  for (size_t j = 0; j < count && q + j < nwords; ++j) {
+    data[q + j] |= src[j] << r;
+    if (r != 0 && q + j + 1 < nwords)
+      data[q + j + 1] |= src[j] >> (BITS_PER_WORD - r);
+  }
+  if (nwords)
+    clear_tail();
 }
 
 // shifts
 BitVector BitVector::operator<<(const size_t off) const {
-  if (off >= nbits)
-    return BitVector(nbits, false);
-
   BitVector out(nbits, false);
-  for (size_t i = 0; i < nbits - off; ++i) {
-    if (get(i + off)) {
-      out.set(i, true);
-    }
-  }
+  if (off < nbits)
+    shift_words_down(out.data.get(), data.get(), words_for_bits(nbits), off);
   return out;
 }
 BitVector &BitVector::operator<<=(const size_t off) {
-  *this = *this << off;
+  if (off >= nbits)
+    setAll(false);
+  else if (off != 0)
+    shift_words_down(data.get(), data.get(), words_for_bits(nbits), off);
   return *this;
 }
 
 BitVector BitVector::operator>>(const size_t off) const {
-  if (off >= nbits)
-    return BitVector(nbits, false);
-
   BitVector out(nbits, false);
-  for (size_t i = 0; i < nbits - off; ++i) {
-    if (get(i)) {
-      out.set(i + off, true);
-    }
+  if (off < nbits) {
+    shift_words_up(out.data.get(), data.get(), words_for_bits(nbits), off);
+    out.clear_tail();
   }
   return out;
 }
 
 BitVector &BitVector::operator>>=(const size_t off) {
-  *this = *this >> off;
+  if (off >= nbits) {
+    setAll(false);
+  } else if (off != 0) {
+    shift_words_up(data.get(), data.get(), words_for_bits(nbits), off);
+    clear_tail();
+  }
   return *this;
 }
 
-// Virtual print method for polymorphic output
-void BitVector::print2() const {
-  std::cout << "[";
-  for (size_t i = 0; i < size(); ++i)
-    std::cout << (get(i) ? '1' : '0');
-  std::cout << "]";
+// -- rotations --
+// Only the k <= n/2 bits that wrap around are saved aside; the rest moves in
+// place with the word shifts above.
+void BitVector::rotateLeft(size_t k) {
+  if (nbits == 0)
+    return;
+  k %= nbits;
+  if (k == 0)
+    return;
+  if (k > nbits / 2) {
+    rotateRight(nbits - k);
+    return;
+  }
+  size_t count = words_for_bits(k);
+  WordStorage wrapped(count);
+  copy_words_from(wrapped.get(), count, 0);
+  if (k % BITS_PER_WORD != 0)
+    wrapped[count - 1] &= (word_t(1) << (k % BITS_PER_WORD)) - 1;
+  *this <<= k;
+  or_words_at(wrapped.get(), count, nbits - k);
+}
+
+void BitVector::rotateRight(size_t k) {
+  if (nbits == 0)
+    return;
+  k %= nbits;
+  if (k == 0)
+    return;
+  if (k > nbits / 2) {
+    rotateLeft(nbits - k);
+    return;
+  }
+  size_t count = words_for_bits(k);
+  WordStorage wrapped(count);
+  copy_words_from(wrapped.get(), count, nbits - k); // tail bits are zero
+  *this >>= k;
+  or_words_at(wrapped.get(), count, 0);
 }
 
+// Virtual print method for polymorphic output
+void BitVector::print2() const { std::cout << '[' << *this << ']'; }
+
 void BitVector::scan() {
   std::string s;
   std::cin >> s;
 
-  // Validate input: only '0' and '1'
-  for (char c : s) {
-    if (c != '0' && c != '1') {
-      throw std::invalid_argument(
-          "Input must be a bitstring containing only '0' or '1'.");
-    }
-  }
-
-  // If the input length differs, re-size the vector
-  if (s.size() != nbits) {
-    *this = BitVector(s.size());
-  }
-
-  // Set bits accordingly
-  for (size_t i = 0; i < s.size(); ++i) {
-    set(i, s[i] == '1');
-  }
+  BitVector parsed(s.size());
+  if (parsed.nbits != 0 && !parse_bits(s.data(), s.size(), parsed.data.get()))
+    throw std::invalid_argument(
+        "Input must be a bitstring containing only '0' or '1'.");
+  *this = std::move(parsed);
 }
 
 // -- stream operators --
+// Text is expanded a block at a time and written with one write() per block
 std::ostream &operator<<(std::ostream &os, const BitVector &bv) {
-  for (size_t i = 0; i < bv.size(); ++i)
-    os << (bv[i] ? '1' : '0');
+  constexpr size_t BLOCK = size_t(1) << 16; // characters, a multiple of 64
+  std::string buf(std::min(bv.size(), BLOCK), '\0');
+  for (size_t pos = 0; pos < bv.size(); pos += BLOCK) {
+    size_t count = std::min(BLOCK, bv.size() - pos);
+    format_bits(bv.words() + pos / BITS_PER_WORD, count, buf.data());
+    os.write(buf.data(), static_cast<std::streamsize>(count));
+  }
   return os;
 }
 
@@ -343,16 +583,11 @@ std::istream &operator>>(std::istream &is, BitVector &bv) {
   if (!(is >> s))
     return is;
 
-  for (char c : s)
-    if (c != '0' && c != '1') {
-      is.setstate(std::ios::failbit);
-      return is;
-    }
-
-  bv = BitVector(s.size());
-  for (size_t i = 0; i < s.size(); ++i)
-    if (s[i] == '1')
-      bv.set(i, true);
-
+  BitVector parsed(s.size());
+  if (parsed.nbits != 0 && !parse_bits(s.data(), s.size(), parsed.data.get())) {
+    is.setstate(std::ios::failbit);
+    return is;
+  }
+  bv = std::move(parsed);
   return is;
 }
@@ -1,22 +1,47 @@
 #pragma once
 
-// Modified for polymorphism
+// Modified for polymorphism: print2()/scan() and the destructor are virtual,
+// everything else is a plain member so the bit loops inline
 
+#include <climits>
+#include <compare>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <iosfwd>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>
 
 using byte_t = uint8_t;
+using word_t = uint64_t;
 using pair = std::pair<size_t, size_t>;
 static constexpr size_t BITS_PER_BYTE = CHAR_BIT; // usually 8
+static constexpr size_t BITS_PER_WORD = sizeof(word_t) * BITS_PER_BYTE; // 64
+static constexpr size_t WORD_ALIGNMENT = 64; // one cache line
+
+// Vectors up to this many bits are stored inside the object (no heap).
+// Override with -DBITVECTOR_INLINE_BITS=<multiple of 64, at least 256>.
+#ifndef BITVECTOR_INLINE_BITS
+#define BITVECTOR_INLINE_BITS 256
+#endif
+static_assert(BITVECTOR_INLINE_BITS >= 256 &&
+                  BITVECTOR_INLINE_BITS % (sizeof(uint64_t) * CHAR_BIT) == 0,
+              "BITVECTOR_INLINE_BITS must be a multiple of 64, at least 256");
+
+// Lazy bitwise expressions, see bitvector.tpp. Only expression nodes
+// specialise this trait; a BitVector itself is a leaf operand.
+template <class T> struct is_bit_expr : std::false_type {};
+template <class T>
+concept BitExpr = is_bit_expr<std::remove_cvref_t<T>>::value;
 
 class BitVector {
 public:
   // Byte to Bit converter
   static size_t bytes_for_bits(size_t bits);
+  // Word to Bit converter
+  static size_t words_for_bits(size_t bits);
 
   // Constructors / destructor / assignment
   BitVector() = default;
@@ -28,21 +53,25 @@ class BitVector {
   BitVector &operator=(BitVector &&) noexcept = default;
   virtual ~BitVector() = default; // Virtual destructor for polymorphism
 
-  // position: byte and offset:
+  // position: word and offset:
   pair coord(size_t i) const;
 
   // Clean garbage bits and preserve valid bits (valid bit filter)
   byte_t last_byte_mask() const;
+  word_t last_word_mask() const;
 
   // Range Checker
-  void check_index(size_t i) const;
+  void check_index(size_t i) const {
+    if (i >= nbits)
+      throw_index_error();
+  }
 
   // swap
   void swap(BitVector &other) noexcept;
   friend void swap(BitVector &a, BitVector &b) noexcept;
 
   // length
-  virtual size_t size() const noexcept; // Virtual for potential override
+  size_t size() const noexcept { return nbits; }
 
   // value
   int value() const;
@@ -60,33 +89,70 @@ class BitVector {
     BoolRef &flip();
   };
 
-  // accessors & mutators - made virtual for polymorphism
-  virtual bool get(size_t i) const;
-  virtual void set(size_t i, bool value);
-  virtual void flip(size_t i);
-  virtual void flipAll();
-  virtual void setRange(size_t i, size_t k, bool value);
-  virtual void setAll(bool value);
-  virtual size_t weight() const;
+  // accessors & mutators (not virtual: defined here so callers inline the
+  // single-bit ones)
+  bool get(size_t i) const {
+    check_index(i);
+    return (data[i / BITS_PER_WORD] >> (i % BITS_PER_WORD)) & 1u;
+  }
+  void set(size_t i, bool value) {
+    check_index(i);
+    word_t mask = word_t(1) << (i % BITS_PER_WORD);
+    if (value)
+      data[i / BITS_PER_WORD] |= mask;
+    else
+      data[i / BITS_PER_WORD] &= ~mask;
+  }
+  void flip(size_t i) {
+    check_index(i);
+    data[i / BITS_PER_WORD] ^= word_t(1) << (i % BITS_PER_WORD);
+  }
+  void flipAll();
+  void setRange(size_t i, size_t k, bool value);
+  void flipRange(size_t i, size_t k);
+  void setAll(bool value);
+  size_t weight() const;
+  size_t weight(size_t from, size_t to) const; // set bits in [from, to)
+
+  // set-bit search, npos when there is none
+  static constexpr size_t npos = static_cast<size_t>(-1);
+  size_t find_first() const noexcept;
+  size_t find_next(size_t i) const noexcept; // first set bit after i
+  size_t find_last() const noexcept;
+  size_t find_prev(size_t i) const noexcept; // last set bit before i
+
+  // visit(i) for every set bit i, in increasing order
+  template <class F> void for_each_set_bit(F &&visit) const;
 
   // operator[]
   BoolRef operator[](size_t i);
-  bool operator[](size_t i) const;
+  bool operator[](size_t i) const { return get(i); }
 
-  // comparisons
-  bool operator==(BitVector &rhs) const;
+  // comparisons: == compares whole words; <=> is lexicographic over the
+  // bits in index order (the order of the text form), a prefix first
+  bool operator==(const BitVector &rhs) const;
+  std::strong_ordering operator<=>(const BitVector &rhs) const;
 
-  // bitwise operators
-  BitVector operator&(const BitVector &rhs) const;
-  BitVector &operator&=(const BitVector &rhs);
+  // 64-bit hash of the size and the words (bithash.hpp), also behind
+  // std::hash<BitVector> and std::hash<CharacterSet>
+  size_t hash() const noexcept;
 
-  BitVector operator|(const BitVector &rhs) const;
+  // bitwise operators (in place; &, |, ^ and ~ build lazy expressions)
+  BitVector &operator&=(const BitVector &rhs);
   BitVector &operator|=(const BitVector &rhs);
-
-  BitVector operator^(const BitVector &rhs) const;
   BitVector &operator^=(const BitVector &rhs);
 
-  BitVector operator~() const;
+  // Fused evaluation of expressions such as (a & b) | (c ^ ~d): a single
+  // pass over the words, no temporaries
+  template <BitExpr E> BitVector(const E &expr);
+  template <BitExpr E> BitVector &operator=(const E &expr);
+  template <BitExpr E> BitVector &operator&=(const E &expr);
+  template <BitExpr E> BitVector &operator|=(const E &expr);
+  template <BitExpr E> BitVector &operator^=(const E &expr);
+
+  // raw word view (bits past size() in the last word are always zero)
+  const word_t *words() const noexcept;
+  size_t word_count() const noexcept;
 
   // shifts
   BitVector operator<<(const size_t off) const;
@@ -95,15 +161,77 @@ class BitVector {
   BitVector operator>>(const size_t off) const;
   BitVector &operator>>=(const size_t off);
 
+  // rotations (bits pushed out of one end re-enter at the other)
+  void rotateLeft(size_t k);  // same direction as <<
+  void rotateRight(size_t k); // same direction as >>
+
   virtual void print2() const;
   virtual void scan();
 
 protected:
+  // Word storage with a small buffer: up to INLINE_WORDS words live inside
+  // the object, so a CharacterSet never touches the heap and moving one is a
+  // plain copy. Longer vectors get a cache-line aligned heap buffer.
+  // get() is null while nothing is stored.
+  static constexpr size_t INLINE_WORDS = BITVECTOR_INLINE_BITS / BITS_PER_WORD;
+
+  class WordStorage {
+  public:
+    WordStorage() noexcept = default;
+    explicit WordStorage(size_t nwords);
+    WordStorage(WordStorage &&other) noexcept;
+    WordStorage &operator=(WordStorage &&other) noexcept;
+    ~WordStorage();
+
+    word_t *get() noexcept { return ptr; }
+    const word_t *get() const noexcept { return ptr; }
+    word_t &operator[](size_t i) noexcept { return ptr[i]; }
+    const word_t &operator[](size_t i) const noexcept { return ptr[i]; }
+    explicit operator bool() const noexcept { return ptr != nullptr; }
+    bool is_inline() const noexcept { return ptr == local; }
+
+    void swap(WordStorage &other) noexcept;
+    void reset() noexcept;
+
+  private:
+    void steal(WordStorage &other) noexcept;
+
+    word_t *ptr = nullptr;
+    word_t local[INLINE_WORDS];
+  };
+
+  [[noreturn]] static void throw_index_error();
+
+  // Zero the unused bits of the last word
+  void clear_tail() noexcept;
+
+  // Word shift kernels, dst may alias src (used for in-place shifts)
+  static void shift_words_down(word_t *dst, const word_t *src, size_t nwords,
+                               size_t off);
+  static void shift_words_up(word_t *dst, const word_t *src, size_t nwords,
+                             size_t off);
+
+  // Copy bits [pos, pos + 64 * count) into dst / OR src in starting at pos
+  void copy_words_from(word_t *dst, size_t count, size_t pos) const;
+  void or_words_at(const word_t *src, size_t count, size_t pos);
+
+  // Evaluate an expression into this vector (bitvector.tpp)
+  template <class E> void assign_expr(const E &expr);
+
+  // Parses straight into the words (bittext.hpp)
+  friend std::istream &operator>>(std::istream &is, BitVector &bv);
+
   // Changed from private to protected for inheritance
-  std::unique_ptr<byte_t[]> data;
+  WordStorage data;
   size_t nbits = 0;
 };
 
 // stream operators (non-member)
 std::ostream &operator<<(std::ostream &os, const BitVector &bv);
-std::istream &operator>>(std::istream &is, BitVector &bv);
\ No newline at end of file
+std::istream &operator>>(std::istream &is, BitVector &bv);
+
+template <> struct std::hash<BitVector> {
+  size_t operator()(const BitVector &bv) const noexcept { return bv.hash(); }
+};
+
+#include "bitvector.tpp"
\ No newline at end of file
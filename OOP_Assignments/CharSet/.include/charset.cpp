@@ -1,4 +1,5 @@
 #include "charset.hpp"
+#include <algorithm> // std::equal
 #include <cstring>
 #include <limits>
 #include <stdexcept>
@@ -22,6 +23,12 @@ CharacterSet::CharacterSet(const char *str) : BitVector(256, false) {
 // Copy constructor
 CharacterSet::CharacterSet(const CharacterSet &other) : BitVector(other) {}
 
+// From a compile-time bit set: both hold the same four words
+CharacterSet::CharacterSet(const StaticBitVector<256> &bits)
+    : BitVector(256, false) {
+  std::memcpy(data.get(), bits.words(), bits.word_count() * sizeof(word_t));
+}
+
 // Get cardinality (number of elements in set)
 uint32_t CharacterSet::getCardinality() const {
   return static_cast<uint32_t>(weight());
@@ -35,30 +42,20 @@ bool CharacterSet::contains(char element) const {
 
 // Find maximum element in set
 char CharacterSet::getMax() const {
-  if (getCardinality() == 0) {
+  size_t index = find_last();
+  if (index == npos) {
     throw std::logic_error("Set is empty");
   }
-
-  for (int i = 255; i >= 0; --i) {
-    if (get(static_cast<uint8_t>(i))) {
-      return static_cast<char>(i);
-    }
-  }
-  throw std::logic_error("Set is empty");
+  return static_cast<char>(index);
 }
 
 // Find minimum element in set
 char CharacterSet::getMin() const {
-  if (getCardinality() == 0) {
+  size_t index = find_first();
+  if (index == npos) {
     throw std::logic_error("Set is empty");
   }
-
-  for (uint8_t i = 0; i < 256; ++i) {
-    if (get(i)) {
-      return static_cast<char>(i);
-    }
-  }
-  throw std::logic_error("Set is empty");
+  return static_cast<char>(index);
 }
 
 // Operator[] - non-const version
@@ -79,14 +76,9 @@ CharacterSet &CharacterSet::operator=(const CharacterSet &other) {
   return *this;
 }
 
-// Equality comparison
+// Equality comparison: both sets are 256 bits, compare the words
 bool CharacterSet::operator==(const CharacterSet &rhs) const {
-  for (size_t i = 0; i < 256; ++i) {
-    if (get(i) != rhs.get(i)) {
-      return false;
-    }
-  }
-  return true;
+  return std::equal(words(), words() + word_count(), rhs.words());
 }
 
 // Inequality comparison
@@ -96,69 +88,39 @@ bool CharacterSet::operator!=(const CharacterSet &rhs) const {
 
 // Set union
 CharacterSet CharacterSet::operator|(const CharacterSet &rhs) const {
-  CharacterSet result;
-  for (size_t i = 0; i < 256; ++i) {
-    result.set(i, get(i) || rhs.get(i));
-  }
-  return result;
+  return CharacterSet(base() | rhs.base());
 }
 
 // Set union assignment
 CharacterSet &CharacterSet::operator|=(const CharacterSet &rhs) {
-  for (size_t i = 0; i < 256; ++i) {
-    if (rhs.get(i)) {
-      set(i, true);
-    }
-  }
+  BitVector::operator|=(rhs);
   return *this;
 }
 
 // Set intersection
 CharacterSet CharacterSet::operator&(const CharacterSet &rhs) const {
-  CharacterSet result;
-  for (size_t i = 0; i < 256; ++i) {
-    result.set(i, get(i) && rhs.get(i));
-  }
-  return result;
+  return CharacterSet(base() & rhs.base());
 }
 
 // Set intersection assignment
 CharacterSet &CharacterSet::operator&=(const CharacterSet &rhs) {
-  for (size_t i = 0; i < 256; ++i) {
-    if (!rhs.get(i)) {
-      set(i, false);
-    }
-  }
+  BitVector::operator&=(rhs);
   return *this;
 }
 
-// Set difference (elements in this but not in rhs)
+// Set difference (elements in this but not in rhs): one and-not pass
 CharacterSet CharacterSet::operator/(const CharacterSet &rhs) const {
-  CharacterSet result;
-  for (size_t i = 0; i < 256; ++i) {
-    result.set(i, get(i) && !rhs.get(i));
-  }
-  return result;
+  return CharacterSet(base() & ~rhs.base());
 }
 
 // Set difference assignment
 CharacterSet &CharacterSet::operator/=(const CharacterSet &rhs) {
-  for (size_t i = 0; i < 256; ++i) {
-    if (rhs.get(i)) {
-      set(i, false);
-    }
-  }
+  BitVector::operator&=(~rhs.base());
   return *this;
 }
 
 // Complement (all elements not in set)
-CharacterSet CharacterSet::operator~() const {
-  CharacterSet result;
-  for (size_t i = 0; i < 256; ++i) {
-    result.set(i, !get(i));
-  }
-  return result;
-}
+CharacterSet CharacterSet::operator~() const { return CharacterSet(~base()); }
 
 // Add element to set
 CharacterSet CharacterSet::operator+(char element) const {
@@ -194,47 +156,25 @@ CharacterSet &CharacterSet::operator-=(char element) {
 void CharacterSet::print(std::ostream &os) const {
   os << "{";
   bool first = true;
-  for (uint32_t i = 0; i < 256; ++i) {
-    if (get(i)) {
-      if (!first) {
-        os << ", ";
-      }
-
-      char ch = static_cast<char>(i);
-      // Print printable characters as-is, others as numeric codes
-      if (ch >= 32 && ch <= 126) {
-        os << "'" << ch << "'";
-      } else {
-        os << static_cast<int>(i);
-      }
-      first = false;
+  for_each_set_bit([&](size_t i) {
+    if (!first) {
+      os << ", ";
     }
-  }
+
+    char ch = static_cast<char>(i);
+    // Print printable characters as-is, others as numeric codes
+    if (ch >= 32 && ch <= 126) {
+      os << "'" << ch << "'";
+    } else {
+      os << static_cast<int>(i);
+    }
+    first = false;
+  });
   os << "}";
 }
 
 // Polymorphic print
-void CharacterSet::print2() const {
-  std::cout << "{";
-  bool first = true;
-  for (uint32_t i = 0; i < 256; ++i) {
-    if (get(i)) {
-      if (!first) {
-        std::cout << ", ";
-      }
-
-      char ch = static_cast<char>(i);
-      // Print printable characters as-is, others as numeric codes
-      if (ch >= 32 && ch <= 126) {
-        std::cout << "'" << ch << "'";
-      } else {
-        std::cout << static_cast<int>(i);
-      }
-      first = false;
-    }
-  }
-  std::cout << "}";
-}
+void CharacterSet::print2() const { print(std::cout); }
 
 void CharacterSet::scan() {
   CharacterSet out;
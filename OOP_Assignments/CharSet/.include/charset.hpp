@@ -1,15 +1,21 @@
 #pragma once
 
 #include "bitvector.hpp"
+#include "static_bitvector.hpp"
 #include <cstdint>
 #include <iostream>
 
-class CharacterSet : public BitVector {
+// final: calls through a CharacterSet (print2/scan included) need no vtable
+class CharacterSet final : public BitVector {
 public:
   // Constructors
   CharacterSet();
   CharacterSet(const char *str);
   CharacterSet(const CharacterSet &other);
+  // From a compile-time bit set, e.g. one of the character classes below
+  CharacterSet(const StaticBitVector<256> &bits);
+  // Built from a fused BitVector expression over 256 bit operands
+  template <BitExpr E> explicit CharacterSet(const E &expr) : BitVector(expr) {}
 
   // Destructor
   ~CharacterSet() override = default;
@@ -63,6 +69,47 @@ class CharacterSet : public BitVector {
 
   virtual void print2() const override;
   virtual void scan() override;
+
+private:
+  // The set viewed as a plain BitVector, so the word-level operators are used
+  // instead of the CharacterSet overloads
+  const BitVector &base() const { return *this; }
+};
+
+// Character classes built at compile time (no startup cost). They convert
+// to CharacterSet, so `cs | DIGIT_CHARS` or `CharacterSet(ALPHA_CHARS)` work.
+using CharBits = StaticBitVector<256>;
+
+// Characters first..last inclusive
+constexpr CharBits charRange(char first, char last) {
+  CharBits bits;
+  uint8_t lo = static_cast<uint8_t>(first);
+  uint8_t hi = static_cast<uint8_t>(last);
+  if (lo <= hi)
+    bits.setRange(lo, hi - lo + 1u, true);
+  return bits;
+}
+
+// Every character of a C-string
+constexpr CharBits charList(const char *chars) {
+  CharBits bits;
+  for (; *chars; ++chars)
+    bits.set(static_cast<uint8_t>(*chars), true);
+  return bits;
+}
+
+inline constexpr CharBits DIGIT_CHARS = charRange('0', '9');
+inline constexpr CharBits LOWER_CHARS = charRange('a', 'z');
+inline constexpr CharBits UPPER_CHARS = charRange('A', 'Z');
+inline constexpr CharBits ALPHA_CHARS = LOWER_CHARS | UPPER_CHARS;
+inline constexpr CharBits ALNUM_CHARS = ALPHA_CHARS | DIGIT_CHARS;
+inline constexpr CharBits SPACE_CHARS = charList(" \t\n\v\f\r");
+
+// Same value as std::hash<BitVector> of the underlying bits
+template <> struct std::hash<CharacterSet> {
+  size_t operator()(const CharacterSet &cs) const noexcept {
+    return cs.hash();
+  }
 };
 
 // Stream operators (non-member)
@@ -0,0 +1,181 @@
+#include "popcount.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if (defined(__GNUC__) || defined(__clang__)) &&                              \
+    (defined(__x86_64__) || defined(__i386__))
+#define POPCOUNT_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using kernel_fn = size_t (*)(const uint64_t *, size_t);
+
+// -- portable fallback --
+size_t popcount_generic(const uint64_t *words, size_t n) {
+  size_t cnt = 0;
+  for (size_t i = 0; i < n; ++i)
+    cnt += static_cast<size_t>(std::popcount(words[i]));
+  return cnt;
+}
+
+#ifdef POPCOUNT_X86
+
+// -- scalar popcnt --
+__attribute__((target("popcnt"))) size_t
+popcount_scalar(const uint64_t *words, size_t n) {
+  // Four independent accumulators hide the popcnt latency
+  uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    c0 += static_cast<uint64_t>(__builtin_popcountll(words[i]));
+    c1 += static_cast<uint64_t>(__builtin_popcountll(words[i + 1]));
+    c2 += static_cast<uint64_t>(__builtin_popcountll(words[i + 2]));
+    c3 += static_cast<uint64_t>(__builtin_popcountll(words[i + 3]));
+  }
+  for (; i < n; ++i)
+    c0 += static_cast<uint64_t>(__builtin_popcountll(words[i]));
+  return static_cast<size_t>(c0 + c1 + c2 + c3);
+}
+
+// -- AVX2 Harley-Seal --
+// Carry-save adders fold 16 vectors into one "sixteens" vector, so only one
+// nibble-lookup popcount is needed per 512 bytes of input.
+
+__attribute__((target("avx2"))) inline __m256i popcount256(__m256i v) {
+  const __m256i lookup =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1,
+                       2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  __m256i lo = _mm256_and_si256(v, low_mask);
+  __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+  __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                _mm256_shuffle_epi8(lookup, hi));
+  return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2"))) inline void
+csa(__m256i &high, __m256i &low, __m256i a, __m256i b, __m256i c) {
+  __m256i u = _mm256_xor_si256(a, b);
+  high = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+  low = _mm256_xor_si256(u, c);
+}
+
+__attribute__((target("avx2"))) size_t
+popcount_avx2(const uint64_t *words, size_t n) {
+  const __m256i *d = reinterpret_cast<const __m256i *>(words);
+  const size_t nvec = n / 4;
+
+  __m256i total = _mm256_setzero_si256();
+  __m256i ones = _mm256_setzero_si256();
+  __m256i twos = _mm256_setzero_si256();
+  __m256i fours = _mm256_setzero_si256();
+  __m256i eights = _mm256_setzero_si256();
+  __m256i sixteens, twosA, twosB, foursA, foursB, eightsA, eightsB;
+
+  size_t i = 0;
+  for (; i + 16 <= nvec; i += 16) {
+    csa(twosA, ones, ones, _mm256_loadu_si256(d + i + 0),
+        _mm256_loadu_si256(d + i + 1));
+    csa(twosB, ones, ones, _mm256_loadu_si256(d + i + 2),
+        _mm256_loadu_si256(d + i + 3));
+    csa(foursA, twos, twos, twosA, twosB);
+    csa(twosA, ones, ones, _mm256_loadu_si256(d + i + 4),
+        _mm256_loadu_si256(d + i + 5));
+    csa(twosB, ones, ones, _mm256_loadu_si256(d + i + 6),
+        _mm256_loadu_si256(d + i + 7));
+    csa(foursB, twos, twos, twosA, twosB);
+    csa(eightsA, fours, fours, foursA, foursB);
+    csa(twosA, ones, ones, _mm256_loadu_si256(d + i + 8),
+        _mm256_loadu_si256(d + i + 9));
+    csa(twosB, ones, ones, _mm256_loadu_si256(d + i + 10),
+        _mm256_loadu_si256(d + i + 11));
+    csa(foursA, twos, twos, twosA, twosB);
+    csa(twosA, ones, ones, _mm256_loadu_si256(d + i + 12),
+        _mm256_loadu_si256(d + i + 13));
+    csa(twosB, ones, ones, _mm256_loadu_si256(d + i + 14),
+        _mm256_loadu_si256(d + i + 15));
+    csa(foursB, twos, twos, twosA, twosB);
+    csa(eightsB, fours, fours, foursA, foursB);
+    csa(sixteens, eights, eights, eightsA, eightsB);
+    total = _mm256_add_epi64(total, popcount256(sixteens));
+  }
+
+  total = _mm256_slli_epi64(total, 4);
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(eights), 3));
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(fours), 2));
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(twos), 1));
+  total = _mm256_add_epi64(total, popcount256(ones));
+
+  for (; i < nvec; ++i)
+    total = _mm256_add_epi64(total, popcount256(_mm256_loadu_si256(d + i)));
+
+  uint64_t lanes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), total);
+  size_t cnt = static_cast<size_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+
+  for (size_t w = nvec * 4; w < n; ++w)
+    cnt += static_cast<size_t>(__builtin_popcountll(words[w]));
+  return cnt;
+}
+
+// -- AVX-512 VPOPCNTQ --
+__attribute__((target("avx512f,avx512vpopcntdq"))) size_t
+popcount_avx512(const uint64_t *words, size_t n) {
+  __m512i acc = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    acc = _mm512_add_epi64(
+        acc, _mm512_popcnt_epi64(_mm512_loadu_si512(words + i)));
+  if (i < n) {
+    // Masked load of the last (n - i) < 8 words
+    __mmask8 tail = static_cast<__mmask8>((1u << (n - i)) - 1u);
+    acc = _mm512_add_epi64(
+        acc, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(tail, words + i)));
+  }
+  uint64_t lanes[8];
+  _mm512_storeu_si512(lanes, acc);
+  uint64_t cnt = 0;
+  for (uint64_t lane : lanes)
+    cnt += lane;
+  return static_cast<size_t>(cnt);
+}
+
+#endif // POPCOUNT_X86
+
+struct Kernel {
+  kernel_fn fn;
+  const char *name;
+};
+
+Kernel select_kernel() {
+#ifdef POPCOUNT_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512vpopcntdq"))
+    return {popcount_avx512, "avx512"};
+  if (__builtin_cpu_supports("avx2"))
+    return {popcount_avx2, "avx2"};
+  if (__builtin_cpu_supports("popcnt"))
+    return {popcount_scalar, "popcnt"};
+#endif
+  return {popcount_generic, "generic"};
+}
+
+const Kernel &kernel() {
+  static const Kernel k = select_kernel(); // thread-safe one-time dispatch
+  return k;
+}
+
+} // namespace
+
+size_t popcount_words(const uint64_t *words, size_t n) {
+  // Short vectors (e.g. a 4 word CharacterSet) skip the dispatch
+  if (n <= 8)
+    return popcount_generic(words, n);
+  return kernel().fn(words, n);
+}
+
+const char *popcount_kernel() { return kernel().name; }
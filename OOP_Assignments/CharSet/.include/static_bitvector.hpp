@@ -0,0 +1,77 @@
+#ifndef STATIC_BITVECTOR_HPP
+#define STATIC_BITVECTOR_HPP
+
+// Fixed-width bit vector with the length known at compile time.
+// Same interface as BitVector (get/set/flip, ranges, weight, find_*, set
+// algebra), but the words live in a plain array and every operation is
+// constexpr, so constants such as character classes are built by the
+// compiler. Implementations are pulled in at the end.
+
+#include "bitvector.hpp" // word_t, BITS_PER_WORD
+
+#include <cstddef>
+
+template <size_t N> class StaticBitVector {
+  // The word count and the tail mask assume at least one bit
+  static_assert(N > 0, "StaticBitVector needs at least one bit");
+
+public:
+  static constexpr size_t WORDS = (N + BITS_PER_WORD - 1) / BITS_PER_WORD;
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  // Constructors
+  constexpr StaticBitVector() noexcept = default;
+  constexpr explicit StaticBitVector(bool value) noexcept;
+  constexpr explicit StaticBitVector(const char *bitstr);
+
+  // length
+  static constexpr size_t size() noexcept { return N; }
+
+  // accessors & mutators
+  constexpr bool get(size_t i) const;
+  constexpr void set(size_t i, bool value);
+  constexpr void flip(size_t i);
+  constexpr void flipAll() noexcept;
+  constexpr void setRange(size_t i, size_t k, bool value);
+  constexpr void flipRange(size_t i, size_t k);
+  constexpr void setAll(bool value) noexcept;
+  constexpr size_t weight() const noexcept;
+
+  // set-bit search, npos when there is none
+  constexpr size_t find_first() const noexcept;
+  constexpr size_t find_next(size_t i) const noexcept; // first set bit after i
+  constexpr size_t find_last() const noexcept;
+
+  constexpr bool operator[](size_t i) const { return get(i); }
+
+  // set algebra
+  constexpr StaticBitVector &operator&=(const StaticBitVector &rhs) noexcept;
+  constexpr StaticBitVector &operator|=(const StaticBitVector &rhs) noexcept;
+  constexpr StaticBitVector &operator^=(const StaticBitVector &rhs) noexcept;
+  constexpr StaticBitVector
+  operator&(const StaticBitVector &rhs) const noexcept;
+  constexpr StaticBitVector
+  operator|(const StaticBitVector &rhs) const noexcept;
+  constexpr StaticBitVector
+  operator^(const StaticBitVector &rhs) const noexcept;
+  constexpr StaticBitVector operator~() const noexcept;
+
+  constexpr bool operator==(const StaticBitVector &rhs) const noexcept;
+
+  // raw word view (bits past N in the last word are always zero)
+  constexpr const word_t *words() const noexcept { return m_words; }
+  static constexpr size_t word_count() noexcept { return WORDS; }
+
+private:
+  static constexpr void check_index(size_t i);
+  // Mask of the bits of word w inside [from, to), with from < to
+  static constexpr word_t range_mask(size_t w, size_t from,
+                                     size_t to) noexcept;
+  constexpr void clear_tail() noexcept;
+
+  word_t m_words[WORDS] = {};
+};
+
+#include "static_bitvector.tpp"
+
+#endif // STATIC_BITVECTOR_HPP
@@ -0,0 +1,226 @@
+#ifndef STATIC_BITVECTOR_TPP
+#define STATIC_BITVECTOR_TPP
+
+#ifndef STATIC_BITVECTOR_HPP
+#include "static_bitvector.hpp"
+#endif
+
+#include <bit>
+#include <cstddef>
+#include <stdexcept>
+
+// -- helpers --
+
+template <size_t N>
+constexpr void StaticBitVector<N>::check_index(size_t i) {
+  if (i >= N)
+    throw std::out_of_range("Index");
+}
+
+template <size_t N>
+constexpr word_t StaticBitVector<N>::range_mask(size_t w, size_t from,
+                                                size_t to) noexcept {
+  word_t mask = ~word_t(0);
+  if (w == from / BITS_PER_WORD)
+    mask &= ~word_t(0) << (from % BITS_PER_WORD);
+  if (w == (to - 1) / BITS_PER_WORD)
+    mask &= ~word_t(0) >> (BITS_PER_WORD - 1 - (to - 1) % BITS_PER_WORD);
+  return mask;
+}
+
+template <size_t N> constexpr void StaticBitVector<N>::clear_tail() noexcept {
+  if constexpr (N % BITS_PER_WORD != 0)
+    m_words[WORDS - 1] &= (word_t(1) << (N % BITS_PER_WORD)) - 1;
+}
+
+// -- constructors --
+
+template <size_t N>
+constexpr StaticBitVector<N>::StaticBitVector(bool value) noexcept {
+  setAll(value);
+}
+
+template <size_t N>
+constexpr StaticBitVector<N>::StaticBitVector(const char *bitstr) {
+  if (!bitstr)
+    throw std::invalid_argument("Null string");
+  size_t i = 0;
+  for (; bitstr[i] != '\0'; ++i) {
+    if (i >= N)
+      throw std::invalid_argument("Bit string longer than the vector");
+    if (bitstr[i] != '0' && bitstr[i] != '1')
+      throw std::invalid_argument("Bit string must be '0' or '1'");
+    if (bitstr[i] == '1')
+      m_words[i / BITS_PER_WORD] |= word_t(1) << (i % BITS_PER_WORD);
+  }
+  if (i != N)
+    throw std::invalid_argument("Bit string shorter than the vector");
+}
+
+// -- accessors & mutators --
+
+template <size_t N> constexpr bool StaticBitVector<N>::get(size_t i) const {
+  check_index(i);
+  return (m_words[i / BITS_PER_WORD] >> (i % BITS_PER_WORD)) & 1u;
+}
+
+template <size_t N>
+constexpr void StaticBitVector<N>::set(size_t i, bool value) {
+  check_index(i);
+  word_t mask = word_t(1) << (i % BITS_PER_WORD);
+  if (value)
+    m_words[i / BITS_PER_WORD] |= mask;
+  else
+    m_words[i / BITS_PER_WORD] &= ~mask;
+}
+
+template <size_t N> constexpr void StaticBitVector<N>::flip(size_t i) {
+  check_index(i);
+  m_words[i / BITS_PER_WORD] ^= word_t(1) << (i % BITS_PER_WORD);
+}
+
+template <size_t N> constexpr void StaticBitVector<N>::flipAll() noexcept {
+  for (size_t w = 0; w < WORDS; ++w)
+    m_words[w] = ~m_words[w];
+  clear_tail();
+}
+
+template <size_t N>
+constexpr void StaticBitVector<N>::setRange(size_t i, size_t k, bool value) {
+  if (k == 0)
+    return;
+  if (i + k > N)
+    throw std::out_of_range("Range out of bounds");
+  // Whole words in one step; only the first and last are partial
+  for (size_t w = i / BITS_PER_WORD; w <= (i + k - 1) / BITS_PER_WORD; ++w) {
+    word_t mask = range_mask(w, i, i + k);
+    m_words[w] = value ? m_words[w] | mask : m_words[w] & ~mask;
+  }
+}
+
+template <size_t N>
+constexpr void StaticBitVector<N>::flipRange(size_t i, size_t k) {
+  if (k == 0)
+    return;
+  if (i + k > N)
+    throw std::out_of_range("Range out of bounds");
+  for (size_t w = i / BITS_PER_WORD; w <= (i + k - 1) / BITS_PER_WORD; ++w)
+    m_words[w] ^= range_mask(w, i, i + k);
+}
+
+template <size_t N>
+constexpr void StaticBitVector<N>::setAll(bool value) noexcept {
+  for (size_t w = 0; w < WORDS; ++w)
+    m_words[w] = value ? ~word_t(0) : word_t(0);
+  if (value)
+    clear_tail();
+}
+
+template <size_t N>
+constexpr size_t StaticBitVector<N>::weight() const noexcept {
+  size_t cnt = 0;
+  for (size_t w = 0; w < WORDS; ++w)
+    cnt += static_cast<size_t>(std::popcount(m_words[w]));
+  return cnt;
+}
+
+// -- set-bit search --
+
+template <size_t N>
+constexpr size_t StaticBitVector<N>::find_first() const noexcept {
+  for (size_t w = 0; w < WORDS; ++w)
+    if (m_words[w])
+      return w * BITS_PER_WORD +
+             static_cast<size_t>(std::countr_zero(m_words[w]));
+  return npos;
+}
+
+template <size_t N>
+constexpr size_t StaticBitVector<N>::find_next(size_t i) const noexcept {
+  if (i == npos || i + 1 >= N)
+    return npos;
+  size_t j = i + 1;
+  size_t w = j / BITS_PER_WORD;
+  word_t word = m_words[w] & (~word_t(0) << (j % BITS_PER_WORD));
+  while (true) {
+    if (word)
+      return w * BITS_PER_WORD + static_cast<size_t>(std::countr_zero(word));
+    if (++w >= WORDS)
+      return npos;
+    word = m_words[w];
+  }
+}
+
+template <size_t N>
+constexpr size_t StaticBitVector<N>::find_last() const noexcept {
+  for (size_t w = WORDS; w-- > 0;)
+    if (m_words[w])
+      return w * BITS_PER_WORD + BITS_PER_WORD - 1 -
+             static_cast<size_t>(std::countl_zero(m_words[w]));
+  return npos;
+}
+
+// -- set algebra --
+
+template <size_t N>
+constexpr StaticBitVector<N> &
+StaticBitVector<N>::operator&=(const StaticBitVector &rhs) noexcept {
+  for (size_t w = 0; w < WORDS; ++w)
+    m_words[w] &= rhs.m_words[w];
+  return *this;
+}
+
+template <size_t N>
+constexpr StaticBitVector<N> &
+StaticBitVector<N>::operator|=(const StaticBitVector &rhs) noexcept {
+  for (size_t w = 0; w < WORDS; ++w)
+    m_words[w] |= rhs.m_words[w];
+  return *this;
+}
+
+template <size_t N>
+constexpr StaticBitVector<N> &
+StaticBitVector<N>::operator^=(const StaticBitVector &rhs) noexcept {
+  for (size_t w = 0; w < WORDS; ++w)
+    m_words[w] ^= rhs.m_words[w];
+  return *this;
+}
+
+template <size_t N>
+constexpr StaticBitVector<N>
+StaticBitVector<N>::operator&(const StaticBitVector &rhs) const noexcept {
+  StaticBitVector out = *this;
+  return out &= rhs;
+}
+
+template <size_t N>
+constexpr StaticBitVector<N>
+StaticBitVector<N>::operator|(const StaticBitVector &rhs) const noexcept {
+  StaticBitVector out = *this;
+  return out |= rhs;
+}
+
+template <size_t N>
+constexpr StaticBitVector<N>
+StaticBitVector<N>::operator^(const StaticBitVector &rhs) const noexcept {
+  StaticBitVector out = *this;
+  return out ^= rhs;
+}
+
+template <size_t N>
+constexpr StaticBitVector<N> StaticBitVector<N>::operator~() const noexcept {
+  StaticBitVector out = *this;
+  out.flipAll();
+  return out;
+}
+
+template <size_t N>
+constexpr bool
+StaticBitVector<N>::operator==(const StaticBitVector &rhs) const noexcept {
+  for (size_t w = 0; w < WORDS; ++w)
+    if (m_words[w] != rhs.m_words[w])
+      return false;
+  return true;
+}
+
+#endif // STATIC_BITVECTOR_TPP
@@ -0,0 +1,163 @@
+/*
+Throughput of CharacterSet and its 256-bit BitVector (Google Benchmark).
+Build with -DROCKET_BUILD_BENCHMARKS=ON and run ./charset_bench. Set
+operations report items_per_second; std::bitset<256> is the baseline.
+Large-vector and BitMatrix numbers are in the Topological_Sort suite.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <bitset>
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "charset.hpp"
+
+static constexpr size_t TEXT_LENGTH = 4096; // characters per iteration
+
+static std::string random_text(size_t n, uint64_t seed) {
+  std::string s(n, ' ');
+  std::mt19937_64 gen(seed);
+  for (char &c : s)
+    c = static_cast<char>(' ' + gen() % 95); // printable ASCII
+  return s;
+}
+
+// -- construction --
+
+static void BM_FromString(benchmark::State &state) {
+  std::string text = random_text(size_t(state.range(0)), 1);
+  for (auto _ : state) {
+    CharacterSet cs(text.c_str());
+    benchmark::DoNotOptimize(cs.words());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations() * text.size()));
+}
+BENCHMARK(BM_FromString)->RangeMultiplier(16)->Range(16, 1 << 16);
+
+static void BM_FromCharClass(benchmark::State &state) {
+  for (auto _ : state) {
+    CharacterSet cs(ALNUM_CHARS);
+    benchmark::DoNotOptimize(cs.words());
+  }
+}
+BENCHMARK(BM_FromCharClass);
+
+// -- membership --
+
+static void BM_Contains(benchmark::State &state) {
+  CharacterSet cs(ALPHA_CHARS);
+  std::string text = random_text(TEXT_LENGTH, 2);
+  for (auto _ : state) {
+    size_t hits = 0;
+    for (char c : text)
+      hits += cs.contains(c);
+    benchmark::DoNotOptimize(hits);
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * TEXT_LENGTH));
+}
+BENCHMARK(BM_Contains);
+
+static void BM_BitsetTest(benchmark::State &state) {
+  std::bitset<256> bs;
+  for (char c = 'A'; c <= 'Z'; ++c)
+    bs.set(static_cast<uint8_t>(c));
+  for (char c = 'a'; c <= 'z'; ++c)
+    bs.set(static_cast<uint8_t>(c));
+  std::string text = random_text(TEXT_LENGTH, 2);
+  for (auto _ : state) {
+    size_t hits = 0;
+    for (char c : text)
+      hits += bs.test(static_cast<uint8_t>(c));
+    benchmark::DoNotOptimize(hits);
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * TEXT_LENGTH));
+}
+BENCHMARK(BM_BitsetTest);
+
+static void BM_AddRemove(benchmark::State &state) {
+  CharacterSet cs;
+  std::string text = random_text(TEXT_LENGTH, 3);
+  for (auto _ : state) {
+    for (char c : text)
+      cs += c;
+    for (char c : text)
+      cs -= c;
+    benchmark::DoNotOptimize(cs.words());
+  }
+  state.SetItemsProcessed(int64_t(state.iterations() * 2 * TEXT_LENGTH));
+}
+BENCHMARK(BM_AddRemove);
+
+// -- set algebra --
+
+template <char Op> static void BM_SetOp(benchmark::State &state) {
+  CharacterSet a(random_text(64, 4).c_str());
+  CharacterSet b(random_text(64, 5).c_str());
+  for (auto _ : state) {
+    CharacterSet c;
+    if constexpr (Op == '|')
+      c = a | b;
+    else if constexpr (Op == '&')
+      c = a & b;
+    else if constexpr (Op == '/')
+      c = a / b;
+    else
+      c = ~a;
+    benchmark::DoNotOptimize(c.words());
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()));
+}
+BENCHMARK_TEMPLATE(BM_SetOp, '|');
+BENCHMARK_TEMPLATE(BM_SetOp, '&');
+BENCHMARK_TEMPLATE(BM_SetOp, '/');
+BENCHMARK_TEMPLATE(BM_SetOp, '~');
+
+static void BM_BitsetOr(benchmark::State &state) {
+  std::bitset<256> a, b;
+  for (char c : random_text(64, 4))
+    a.set(static_cast<uint8_t>(c));
+  for (char c : random_text(64, 5))
+    b.set(static_cast<uint8_t>(c));
+  for (auto _ : state) {
+    std::bitset<256> c = a | b;
+    benchmark::DoNotOptimize(c);
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()));
+}
+BENCHMARK(BM_BitsetOr);
+
+// -- queries --
+
+static void BM_Cardinality(benchmark::State &state) {
+  CharacterSet cs(random_text(64, 6).c_str());
+  for (auto _ : state)
+    benchmark::DoNotOptimize(cs.getCardinality());
+  state.SetItemsProcessed(int64_t(state.iterations()));
+}
+BENCHMARK(BM_Cardinality);
+
+static void BM_MinMax(benchmark::State &state) {
+  CharacterSet cs("mnopq");
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cs.getMin());
+    benchmark::DoNotOptimize(cs.getMax());
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()));
+}
+BENCHMARK(BM_MinMax);
+
+static void BM_Print(benchmark::State &state) {
+  CharacterSet cs(random_text(64, 7).c_str());
+  std::ostringstream os;
+  for (auto _ : state) {
+    os.str(std::string());
+    cs.print(os);
+    benchmark::DoNotOptimize(os.tellp());
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()));
+}
+BENCHMARK(BM_Print);
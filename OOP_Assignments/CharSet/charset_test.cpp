@@ -0,0 +1,448 @@
+/*
+Behaviour tests for the BitVector copy in .include (inline and heap
+storage) and for CharacterSet. Every check compares against a naive
+reference: a std::vector<bool> or a plain loop. Built as the charset_test
+target and run by ctest.
+*/
+
+#undef NDEBUG // the checks are asserts, keep them in release builds
+
+#include <algorithm>
+#include <cassert>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bittext.hpp"
+#include "bitvector.hpp"
+#include "charset.hpp"
+#include "static_bitvector.hpp"
+
+using Bits = std::vector<bool>;
+
+static std::mt19937_64 rng(2024);
+
+// -- helpers --
+
+static Bits random_bits(size_t n) {
+  Bits b(n);
+  for (size_t i = 0; i < n; ++i)
+    b[i] = rng() & 1;
+  return b;
+}
+
+static Bits complement(Bits b) {
+  b.flip();
+  return b;
+}
+
+static BitVector from_bits(const Bits &b) {
+  BitVector v(b.size());
+  for (size_t i = 0; i < b.size(); ++i)
+    v.set(i, b[i]);
+  return v;
+}
+
+// Size, every bit and the weight agree with the reference
+static bool matches(const BitVector &v, const Bits &b) {
+  if (v.size() != b.size())
+    return false;
+  size_t ones = 0;
+  for (size_t i = 0; i < b.size(); ++i) {
+    if (v.get(i) != b[i])
+      return false;
+    ones += b[i];
+  }
+  return v.weight() == ones;
+}
+
+// Vector sizes on both sides of the inline storage limit
+static const size_t SIZES[] = {0,   1,   63,  64,  65,
+                               200, 256, 257, 1000};
+
+// -- shifts and rotations --
+// << moves bit i + off down to i, >> moves bit i up to i + off, and the
+// rotations wrap the bits that either shift drops
+
+static Bits shifted_down(const Bits &b, size_t off) {
+  Bits out(b.size());
+  for (size_t i = 0; off < b.size() && i < b.size() - off; ++i)
+    out[i] = b[i + off];
+  return out;
+}
+
+static Bits shifted_up(const Bits &b, size_t off) {
+  Bits out(b.size());
+  for (size_t i = off; i < b.size(); ++i)
+    out[i] = b[i - off];
+  return out;
+}
+
+static Bits rotated_down(const Bits &b, size_t k) {
+  Bits out(b.size());
+  for (size_t i = 0; i < b.size(); ++i)
+    out[i] = b[(i + k) % b.size()];
+  return out;
+}
+
+void testShifts() {
+  for (size_t n : SIZES) {
+    Bits ref = random_bits(n);
+    for (size_t off : {size_t(0), size_t(1), size_t(63), size_t(64),
+                       size_t(65), size_t(128), size_t(192), n / 2, n - 1, n,
+                       n + 1, n + 64, size_t(-1)}) {
+      BitVector v = from_bits(ref);
+      assert(matches(v << off, shifted_down(ref, off)));
+      assert(matches(v >> off, shifted_up(ref, off)));
+      BitVector in_place = v;
+      in_place <<= off;
+      assert(matches(in_place, shifted_down(ref, off)));
+      in_place = v;
+      in_place >>= off;
+      assert(matches(in_place, shifted_up(ref, off)));
+    }
+  }
+  std::cout << "All shift tests passed!" << std::endl;
+}
+
+void testRotations() {
+  for (size_t n : SIZES) {
+    if (n == 0)
+      continue;
+    Bits ref = random_bits(n);
+    for (size_t k : {size_t(0), size_t(1), size_t(63), size_t(64),
+                     size_t(65), size_t(128), n / 2, n / 2 + 1, n, n + 1,
+                     3 * n + 64}) {
+      BitVector left = from_bits(ref), right = from_bits(ref);
+      left.rotateLeft(k);
+      right.rotateRight(k);
+      assert(matches(left, rotated_down(ref, k % n)));
+      assert(matches(right, rotated_down(ref, n - k % n)));
+      left.rotateRight(k); // and back
+      assert(matches(left, ref));
+    }
+  }
+  std::cout << "All rotation tests passed!" << std::endl;
+}
+
+// -- expressions --
+// Reference semantics of every operator, one step at a time: the result
+// has the left operand's length and a shorter right operand reads as zeros
+
+static bool bit_or_zero(const Bits &b, size_t i) {
+  return i < b.size() && b[i];
+}
+
+template <class Op> static Bits apply(const Bits &l, const Bits &r, Op op) {
+  Bits out(l.size());
+  for (size_t i = 0; i < l.size(); ++i)
+    out[i] = op(l[i], bit_or_zero(r, i));
+  return out;
+}
+
+static Bits ref_and(const Bits &l, const Bits &r) {
+  return apply(l, r, [](bool x, bool y) { return x && y; });
+}
+static Bits ref_or(const Bits &l, const Bits &r) {
+  return apply(l, r, [](bool x, bool y) { return x || y; });
+}
+static Bits ref_xor(const Bits &l, const Bits &r) {
+  return apply(l, r, [](bool x, bool y) { return x != y; });
+}
+
+void testExpressions() {
+  for (int round = 0; round < 200; ++round) {
+    size_t base = SIZES[rng() % std::size(SIZES)];
+    auto length = [&] {
+      size_t pick = rng() % 4;
+      return pick == 0 ? base : pick == 1 ? base + rng() % 70 : rng() % 300;
+    };
+    Bits a = random_bits(length()), b = random_bits(length()),
+         c = random_bits(length()), d = random_bits(length());
+    BitVector va = from_bits(a), vb = from_bits(b), vc = from_bits(c),
+              vd = from_bits(d);
+
+    assert(matches(BitVector((va & vb) | (vc ^ ~vd)),
+                   ref_or(ref_and(a, b), ref_xor(c, complement(d)))));
+    assert(matches(BitVector(vc | (va ^ vb)), ref_or(c, ref_xor(a, b))));
+    assert(matches(BitVector(~(va | vb) & vc),
+                   ref_and(complement(ref_or(a, b)), c)));
+
+    // an operand that is also the target
+    BitVector r = va;
+    r = vb | (r ^ vc);
+    Bits expected = ref_or(b, ref_xor(a, c));
+    assert(matches(r, expected));
+    r &= vc ^ r;
+    expected = ref_and(expected, ref_xor(c, expected));
+    assert(matches(r, expected));
+    r ^= r;
+    assert(matches(r, Bits(expected.size())));
+
+    BitVector s = va;
+    s &= vb;
+    s |= vc;
+    s ^= vd;
+    assert(matches(s, ref_xor(ref_or(ref_and(a, b), c), d)));
+  }
+  std::cout << "All expression tests passed!" << std::endl;
+}
+
+// -- text kernels --
+// Every parse/format kernel this CPU runs is forced in turn and checked on
+// odd lengths, where the vector loops hand over to their tails
+
+static std::string bit_text(const Bits &b) {
+  std::string s;
+  for (bool bit : b)
+    s += bit ? '1' : '0';
+  return s;
+}
+
+static void check_text_kernel() {
+  for (size_t n = 0; n < 300; n += 1 + n / 16) {
+    for (size_t extra : {size_t(0), size_t(1000)}) {
+      Bits ref = random_bits(n + extra);
+      std::string text = bit_text(ref);
+      std::vector<uint64_t> words(BitVector::words_for_bits(ref.size()) + 1,
+                                  ~uint64_t(0));
+      assert(parse_bits(text.data(), text.size(), words.data()));
+      for (size_t i = 0; i < ref.size(); ++i)
+        assert(((words[i / 64] >> (i % 64)) & 1u) == ref[i]);
+      if (ref.size() % 64)
+        assert(words[ref.size() / 64] >> (ref.size() % 64) == 0);
+      assert(words.back() == ~uint64_t(0)); // nothing past the last word
+
+      std::string out(text.size() + 1, '#');
+      format_bits(words.data(), text.size(), out.data());
+      assert(out == text + '#');
+      assert(matches(BitVector(text.c_str()), ref));
+
+      // one bad character anywhere, in either vector half or the tail
+      for (size_t at : {size_t(0), size_t(31), size_t(32), size_t(63),
+                        size_t(64), text.size() / 2, text.size() - 1}) {
+        if (at >= text.size())
+          continue;
+        for (char bad : {'2', '/', 'a', ' ', '\xb1'}) {
+          std::string broken = text;
+          broken[at] = bad;
+          assert(!parse_bits(broken.data(), broken.size(), words.data()));
+        }
+      }
+    }
+  }
+}
+
+void testTextKernels() {
+  std::string original = bittext_kernel();
+  std::string tested;
+  for (const char *name : {"avx512", "avx2", "generic"}) {
+    if (!bittext_use_kernel(name))
+      continue;
+    assert(bittext_kernel() == std::string(name));
+    check_text_kernel();
+    tested += std::string(" ") + name;
+  }
+  assert(!bittext_use_kernel("sse9") && tested.ends_with("generic"));
+  bittext_use_kernel(original.c_str());
+  std::cout << "All text kernel tests passed (" << tested.substr(1) << ")!"
+            << std::endl;
+}
+
+// -- StaticBitVector --
+// Everything below up to testStaticBitVector is checked by the compiler
+
+// Every bit after setRange / flipRange over [i, i + k), against the range
+template <size_t N> constexpr bool ranges_agree(size_t i, size_t k) {
+  StaticBitVector<N> set, flipped(true);
+  set.setRange(i, k, true);
+  flipped.flipRange(i, k);
+  for (size_t pos = 0; pos < N; ++pos) {
+    bool inside = pos >= i && pos < i + k;
+    if (set.get(pos) != inside || flipped.get(pos) == inside)
+      return false;
+  }
+  set.setRange(i, k, false);
+  return set.weight() == 0 && flipped.weight() == N - k;
+}
+
+static_assert(ranges_agree<1>(0, 1) && ranges_agree<1>(0, 0));
+static_assert(ranges_agree<64>(0, 64) && ranges_agree<64>(63, 1));
+static_assert(ranges_agree<65>(1, 64) && ranges_agree<65>(64, 1));
+static_assert(ranges_agree<130>(3, 100) && ranges_agree<130>(60, 10));
+static_assert(ranges_agree<130>(0, 130) && ranges_agree<256>(64, 128));
+
+// Tail bits stay clear through flipAll, ~ and setAll
+static_assert((~StaticBitVector<70>()).weight() == 70);
+static_assert(StaticBitVector<70>(true).find_last() == 69);
+static_assert(StaticBitVector<70>(true) == ~StaticBitVector<70>());
+
+static_assert(StaticBitVector<5>("10110").weight() == 3);
+static_assert(StaticBitVector<5>("10110").find_first() == 0);
+static_assert(StaticBitVector<5>("10110").find_next(0) == 2);
+static_assert(StaticBitVector<5>("00000").find_first() ==
+              StaticBitVector<5>::npos);
+static_assert((StaticBitVector<5>("10110") ^ StaticBitVector<5>("01100")) ==
+              StaticBitVector<5>("11010"));
+
+// The character classes are compile-time constants of four words
+static_assert(sizeof(CharBits) == 4 * sizeof(word_t));
+static_assert(DIGIT_CHARS.weight() == 10 && DIGIT_CHARS.find_first() == '0' &&
+              DIGIT_CHARS.find_last() == '9');
+static_assert(ALPHA_CHARS.weight() == 52 && ALNUM_CHARS.weight() == 62);
+static_assert((ALNUM_CHARS & ~DIGIT_CHARS) == ALPHA_CHARS);
+static_assert((LOWER_CHARS | UPPER_CHARS) == ALPHA_CHARS);
+static_assert(SPACE_CHARS.weight() == 6 && SPACE_CHARS.get(' ') &&
+              SPACE_CHARS.get('\t') && !SPACE_CHARS.get('x'));
+static_assert(charRange('z', 'a').weight() == 0);
+
+void testStaticBitVector() {
+  // random ranges at runtime, against a reference
+  for (int round = 0; round < 500; ++round) {
+    StaticBitVector<130> v;
+    Bits ref(130);
+    for (int step = 0; step < 5; ++step) {
+      size_t i = rng() % 131, k = rng() % (131 - i);
+      bool value = rng() & 1;
+      if (step % 2) {
+        v.flipRange(i, k);
+        for (size_t pos = i; pos < i + k; ++pos)
+          ref[pos] = !ref[pos];
+      } else {
+        v.setRange(i, k, value);
+        for (size_t pos = i; pos < i + k; ++pos)
+          ref[pos] = value;
+      }
+    }
+    size_t ones = 0;
+    for (size_t pos = 0; pos < 130; ++pos) {
+      assert(v.get(pos) == ref[pos]);
+      ones += ref[pos];
+    }
+    assert(v.weight() == ones);
+  }
+
+  StaticBitVector<130> v;
+  bool threw = false;
+  try {
+    v.setRange(100, 31, true);
+  } catch (const std::out_of_range &) {
+    threw = true;
+  }
+  assert(threw && v.weight() == 0);
+
+  CharacterSet letters(ALPHA_CHARS);
+  assert(letters.getCardinality() == 52 && letters.contains('q') &&
+         !letters.contains('1'));
+  std::cout << "All StaticBitVector tests passed!" << std::endl;
+}
+
+// -- CharacterSet algebra --
+
+static CharacterSet random_set(Bits &members) {
+  members = random_bits(256);
+  CharacterSet cs;
+  for (size_t c = 0; c < 256; ++c)
+    if (members[c])
+      cs += static_cast<char>(c);
+  return cs;
+}
+
+void testCharacterSetAlgebra() {
+  for (int round = 0; round < 50; ++round) {
+    Bits a, b;
+    CharacterSet x = random_set(a), y = random_set(b);
+    assert(matches(x | y, ref_or(a, b)));
+    assert(matches(x & y, ref_and(a, b)));
+    assert(matches(x / y, ref_and(a, complement(b))));
+    assert(matches(~x, complement(a)));
+    CharacterSet z = x;
+    z /= y;
+    z |= ~x & y;
+    assert(matches(z, ref_xor(a, b)));
+    z &= x;
+    assert(matches(z, ref_and(a, complement(b))));
+  }
+  std::cout << "All CharacterSet algebra tests passed!" << std::endl;
+}
+
+// -- comparisons and hashing --
+// <=> orders like std::vector<bool> (bit 0 first, a prefix before any
+// longer vector), and equal vectors hash alike however they were built
+
+static std::strong_ordering ref_order(const Bits &a, const Bits &b) {
+  return std::lexicographical_compare_three_way(a.begin(), a.end(), b.begin(),
+                                                b.end());
+}
+
+// b with one bit flipped, or cut / extended at `at`: close to b, so the
+// comparison has to look past a long common prefix
+static Bits near_copy(const Bits &b, size_t at, int how) {
+  Bits out = b;
+  if (how == 0 && at < out.size())
+    out[at] = !out[at];
+  else if (how == 1)
+    out.resize(std::min(at, out.size()));
+  else
+    out.resize(out.size() + 1 + at % 70, at % 2);
+  return out;
+}
+
+static void check_order(const Bits &a, const Bits &b) {
+  BitVector x = from_bits(a), y = from_bits(b);
+  assert((x <=> y) == ref_order(a, b));
+  assert((y <=> x) == ref_order(b, a));
+  assert((x == y) == (a == b));
+  if (a == b)
+    assert(x.hash() == y.hash());
+}
+
+void testComparisons() {
+  for (size_t n : SIZES) {
+    for (int round = 0; round < 20; ++round) {
+      Bits a = random_bits(n);
+      size_t at = n ? rng() % (n + 1) : 0;
+      check_order(a, random_bits(n));
+      check_order(a, random_bits(rng() % 300));
+      for (int how = 0; how < 3; ++how)
+        check_order(a, near_copy(a, at, how));
+      check_order(a, a);
+    }
+    Bits a = random_bits(n);
+    BitVector flipped = from_bits(a);
+    flipped.flipAll();
+    assert(flipped == from_bits(complement(a)));
+    assert(flipped.hash() == from_bits(complement(a)).hash());
+  }
+
+  // a CharacterSet hashes like the BitVector of its members
+  for (int round = 0; round < 20; ++round) {
+    Bits members;
+    CharacterSet cs = random_set(members);
+    assert(std::hash<CharacterSet>{}(cs) == cs.hash());
+    assert(cs.hash() == from_bits(members).hash());
+    assert(std::hash<CharacterSet>{}(~cs) ==
+           from_bits(complement(members)).hash());
+  }
+  std::cout << "All comparison tests passed!" << std::endl;
+}
+
+int main() {
+  testShifts();
+  testRotations();
+  testExpressions();
+  testTextKernels();
+  testStaticBitVector();
+  testCharacterSetAlgebra();
+  testComparisons();
+
+  std::cout << "All tests passed successfully!" << std::endl;
+  return 0;
+}
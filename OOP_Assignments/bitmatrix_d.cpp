@@ -149,9 +149,7 @@ void BitMatrix::flip_range(size_t j, size_t i, size_t k) {
   check_row_index(j);
   if (i + k > columns())
     throw std::out_of_range("Range out of column bounds");
-  for (size_t pos = i; pos < i + k; ++pos) {
-    m_matrix[j].flip(pos);
-  }
+  m_matrix[j].flipRange(i, k);
 }
 
 void BitMatrix::set_range(size_t j, size_t i, size_t k, bool value) {
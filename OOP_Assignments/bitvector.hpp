@@ -43,18 +43,24 @@ sizes dont need to match.
 */
 
 #include <algorithm>
+#include <bit>
 #include <climits>
+#include <compare>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
 #include <memory>
+#include <new>
 #include <stdexcept>
 #include <string>
 
 using byte_t = uint8_t;
+using word_t = uint64_t;
 using pair = std::pair<size_t, size_t>;
 static constexpr size_t BITS_PER_BYTE = CHAR_BIT; // = 8.
+static constexpr size_t BITS_PER_WORD = sizeof(word_t) * BITS_PER_BYTE; // = 64.
+static constexpr size_t WORD_ALIGNMENT = 64; // one cache line.
 
 inline size_t max(size_t a, size_t b) { return (a >= b ? a : b); }
 
@@ -65,6 +71,11 @@ class BitVector {
     return (bits + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
   }
 
+  // Word to Bit converter (the storage is made of 64 bit words)
+  static size_t words_for_bits(size_t bits) {
+    return (bits + BITS_PER_WORD - 1) / BITS_PER_WORD;
+  }
+
   // Clean garbage bits and preserve valid bits (т.е: Valid bit filter.)
   byte_t last_byte_mask() const {
     size_t rem =
@@ -76,6 +87,14 @@ class BitVector {
                                     // bit eg 1u << 3 - 1 = 00001111
   }
 
+  // Same filter for the last storage word.
+  word_t last_word_mask() const {
+    size_t rem = nbits % BITS_PER_WORD;
+    if (rem == 0)
+      return ~word_t(0);
+    return (word_t(1) << rem) - 1;
+  }
+
   // Range Checker
   void check_index(size_t i) const {
     if (i >= nbits)
@@ -83,7 +102,38 @@ class BitVector {
   }
 
 private:
-  std::unique_ptr<byte_t[]> data;
+  // Aligned buffer release (the buffer comes from aligned operator new[])
+  struct WordDeleter {
+    void operator()(word_t *p) const noexcept {
+      ::operator delete[](p, std::align_val_t{WORD_ALIGNMENT});
+    }
+  };
+  using word_ptr = std::unique_ptr<word_t[], WordDeleter>;
+
+  // Cache-line aligned words, so the loops below vectorize cleanly.
+  static word_ptr allocate_words(size_t nwords) {
+    void *raw = ::operator new[](nwords * sizeof(word_t),
+                                 std::align_val_t{WORD_ALIGNMENT});
+    return word_ptr(static_cast<word_t *>(raw));
+  }
+
+  // Garbage bits past nbits in the last word are always kept at zero.
+  void clear_tail() noexcept {
+    if (nbits % BITS_PER_WORD != 0)
+      data[words_for_bits(nbits) - 1] &= last_word_mask();
+  }
+
+  // Маска битов слова w, попадающих в [from, to) (from < to).
+  static word_t range_word_mask(size_t w, size_t from, size_t to) noexcept {
+    word_t mask = ~word_t(0);
+    if (w == from / BITS_PER_WORD)
+      mask &= ~word_t(0) << (from % BITS_PER_WORD);
+    if (w == (to - 1) / BITS_PER_WORD)
+      mask &= ~word_t(0) >> (BITS_PER_WORD - 1 - (to - 1) % BITS_PER_WORD);
+    return mask;
+  }
+
+  word_ptr data;
   size_t nbits = 0;
 
   // TODO: Class in Class, interesting.
@@ -120,12 +170,12 @@ class BitVector {
 
   // С параметрами (размер и значение - одно и то же для всех разрядов)
   BitVector(size_t size, bool value = false) : nbits(size) {
-    size_t nbytes = bytes_for_bits(size);
-    if (nbytes) {
-      data = std::make_unique<byte_t[]>(nbytes);
-      std::fill_n(data.get(), nbytes, value ? byte_t(0xFF) : byte_t(0x00));
-      if (value && (nbits % BITS_PER_BYTE != 0))
-        data[nbytes - 1] &= last_byte_mask();
+    size_t nwords = words_for_bits(size);
+    if (nwords) {
+      data = allocate_words(nwords);
+      std::fill_n(data.get(), nwords, value ? ~word_t(0) : word_t(0));
+      if (value)
+        clear_tail();
     }
   }
 
@@ -134,27 +184,26 @@ class BitVector {
     if (!bitstr)
       throw std::invalid_argument("Null string");
     nbits = std::strlen(bitstr);
-    size_t nbytes = bytes_for_bits(nbits);
-    if (nbytes) {
-      data = std::make_unique<byte_t[]>(nbytes);
-      std::fill_n(data.get(), nbytes, byte_t(0x00));
+    size_t nwords = words_for_bits(nbits);
+    if (nwords) {
+      data = allocate_words(nwords);
+      std::fill_n(data.get(), nwords, word_t(0));
       for (size_t i = 0; i < nbits; ++i) {
         char c = bitstr[i];
         if (c != '0' && c != '1')
           throw std::invalid_argument("Bit string must be '0' or '1'");
         if (c == '1')
-          data[i / BITS_PER_BYTE] |=
-              static_cast<byte_t>(1u << (i % BITS_PER_BYTE));
+          data[i / BITS_PER_WORD] |= word_t(1) << (i % BITS_PER_WORD);
       }
     }
   }
 
   // Конструктор копирования
   BitVector(const BitVector &other) : nbits(other.nbits) {
-    size_t nbytes = bytes_for_bits(nbits);
-    if (nbytes) {
-      data = std::make_unique<byte_t[]>(nbytes);
-      std::memcpy(data.get(), other.data.get(), nbytes);
+    size_t nwords = words_for_bits(nbits);
+    if (nwords) {
+      data = allocate_words(nwords);
+      std::memcpy(data.get(), other.data.get(), nwords * sizeof(word_t));
       // Other option in case no standard library.
       // for(size_t i = 0; i < nbits; ++i){
       //   data[i] = other.data[i];
@@ -166,10 +215,10 @@ class BitVector {
   BitVector &operator=(const BitVector &other) {
     if (this == &other)
       return *this;
-    size_t nbytes = bytes_for_bits(other.nbits);
-    if (nbytes) {
-      auto tmp = std::unique_ptr<byte_t[]>(new byte_t[nbytes]);
-      std::memcpy(tmp.get(), other.data.get(), nbytes);
+    size_t nwords = words_for_bits(other.nbits);
+    if (nwords) {
+      auto tmp = allocate_words(nwords);
+      std::memcpy(tmp.get(), other.data.get(), nwords * sizeof(word_t));
       // Other option in case no standard library.
       // for(size_t i = 0; i < nbits; ++i){
       //   data[i] = other.data[i];
@@ -187,11 +236,11 @@ class BitVector {
   BitVector &operator=(BitVector &&) noexcept = default;
   ~BitVector() = default;
 
-  // position: byte and offset:
+  // position: word and offset:
   inline pair coord(size_t i) const {
-    size_t b = i / BITS_PER_BYTE;   // which byte
-    size_t off = i % BITS_PER_BYTE; // offset
-    return {b, off};
+    size_t w = i / BITS_PER_WORD;   // which word
+    size_t off = i % BITS_PER_WORD; // offset
+    return {w, off};
   }
 
   // swap
@@ -227,14 +276,14 @@ class BitVector {
     pair b = coord(i);
 
     // TODO: Need explanation here.
-    byte_t mask = static_cast<byte_t>(
-        1u << b.second); // create a mask at the position of the target bit.
+    word_t mask = word_t(1)
+                  << b.second; // create a mask at the position of the bit.
     if (value) // if the value is true, then use the OR operation to set the
                // bit at that position to true.
       data[b.first] |= mask;
     else // if it is false create an inverted mask say iu << 2 = 00000100 ~mask
          // = 11111011 and use the AND operator to force that bit to turn off.
-      data[b.first] &= static_cast<byte_t>(~mask);
+      data[b.first] &= ~mask;
   }
 
   // flip single bit (invert i-th)
@@ -246,19 +295,19 @@ class BitVector {
     // size_t off = i % BITS_PER_BYTE; // offset
     pair b = coord(i);
     // TODO: Another explanation here.
-    data[b.first] ^= static_cast<byte_t>(
-        1u << b.second); // creates a mask at the offset position, then uses
-                         // the XOR operator to flip.
+    data[b.first] ^= word_t(1)
+                     << b.second; // creates a mask at the offset position,
+                                  // then uses the XOR operator to flip.
   }
 
   // flip all bits
   void flipAll() {
     // TODO: Is flipping and inverting the same thing?
-    size_t nbytes = bytes_for_bits(nbits);
-    for (size_t i = 0; i < nbytes; ++i)
-      data[i] = static_cast<byte_t>(~data[i]);
-    if (nbytes && (nbits % BITS_PER_BYTE != 0))
-      data[nbytes - 1] &= last_byte_mask();
+    size_t nwords = words_for_bits(nbits);
+    for (size_t i = 0; i < nwords; ++i)
+      data[i] = ~data[i];
+    if (nwords)
+      clear_tail();
   }
 
   // Установка в 0/1 в диапазоне;
@@ -267,48 +316,75 @@ class BitVector {
       return;
     if (i + k > nbits)
       throw std::out_of_range("Range out of bounds");
-    // already optimized
-    for (size_t pos = i; pos < i + k; ++pos)
-      set(pos, value);
+    // Маскируются только крайние слова, середина заполняется целиком.
+    size_t first = i / BITS_PER_WORD;
+    size_t last = (i + k - 1) / BITS_PER_WORD;
+    word_t head = range_word_mask(first, i, i + k);
+    word_t tail = range_word_mask(last, i, i + k);
+    data[first] = value ? data[first] | head : data[first] & ~head;
+    if (first == last)
+      return;
+    std::fill_n(data.get() + first + 1, last - first - 1,
+                value ? ~word_t(0) : word_t(0));
+    data[last] = value ? data[last] | tail : data[last] & ~tail;
+  }
+
+  // Инверсия в диапазоне [i, i + k).
+  void flipRange(size_t i, size_t k) {
+    if (k == 0)
+      return;
+    if (i + k > nbits)
+      throw std::out_of_range("Range out of bounds");
+    size_t first = i / BITS_PER_WORD;
+    size_t last = (i + k - 1) / BITS_PER_WORD;
+    data[first] ^= range_word_mask(first, i, i + k);
+    if (first == last)
+      return;
+    for (size_t w = first + 1; w < last; ++w)
+      data[w] = ~data[w];
+    data[last] ^= range_word_mask(last, i, i + k);
   }
 
   // Установка в 0/1 всех компонент вектора;
   void setAll(bool value) {
-    size_t nbytes = bytes_for_bits(nbits);
-    if (nbytes == 0)
+    size_t nwords = words_for_bits(nbits);
+    if (nwords == 0)
       return;
-    for (size_t pos = 0; pos < nbits; ++pos)
-      set(pos, value); // operates bitwise.
-    // std::fill_n(data.get(), nbytes, value ? byte_t(0xFF) : byte_t(0x00));
+    std::fill_n(data.get(), nwords, value ? ~word_t(0) : word_t(0));
     // magic that makes things work properly. -> clears all unused bits in the
-    // last byte to zero.
-    if (value && (nbits % BITS_PER_BYTE != 0))
-      data[nbytes - 1] &= last_byte_mask();
+    // last word to zero.
+    if (value)
+      clear_tail();
   }
 
   // Вес вектора (количество единичных компонент).
+  // One popcount per 64 bit word; the spare bits of the last word are always
+  // kept at zero, so they never have to be subtracted.
   size_t weight() const {
     size_t cnt = 0;
-    // size_t nbytes = bytes_for_bits(nbits);
-    // for (size_t i = 0; i < nbytes; ++i) {
-    //   cnt += __builtin_popcount(static_cast<unsigned int>(data[i]));
-    // }
-    // // subtract bits in spare area if any (they should be cleared on
-    // operations,
-    // // but safe)
-    // // TODO: What does this do and why.
-    // if (nbytes && (nbits % BITS_PER_BYTE != 0)) {
-    //   byte_t mask = last_byte_mask();
-    //   byte_t spare = static_cast<byte_t>(data[nbytes - 1] & ~mask);
-    //   if (spare) cnt -= __builtin_popcount(static_cast<unsigned int>(spare));
-    // }
-
-    for (size_t i = 0; i < nbits; ++i) {
-      if (get(i)) {
-        cnt++;
-      }
-    }
+    size_t nwords = words_for_bits(nbits);
+    for (size_t i = 0; i < nwords; ++i)
+      cnt += static_cast<size_t>(std::popcount(data[i]));
+    return cnt;
+  }
 
+  // Вес диапазона [from, to).
+  size_t weight(size_t from, size_t to) const {
+    if (from > to || to > nbits)
+      throw std::out_of_range("Range out of bounds");
+    if (from == to)
+      return 0;
+    size_t first = from / BITS_PER_WORD;
+    size_t last = (to - 1) / BITS_PER_WORD;
+    word_t head = ~word_t(0) << (from % BITS_PER_WORD); // drop bits < from
+    word_t tail = ~word_t(0) >>
+                  (BITS_PER_WORD - 1 - (to - 1) % BITS_PER_WORD); // bits >= to
+    if (first == last)
+      return static_cast<size_t>(std::popcount(data[first] & head & tail));
+    size_t cnt = static_cast<size_t>(std::popcount(data[first] & head));
+    for (size_t i = first + 1; i < last; ++i)
+      cnt += static_cast<size_t>(std::popcount(data[i]));
+    cnt += static_cast<size_t>(std::popcount(data[last] & tail));
     return cnt;
   }
 
@@ -321,16 +397,30 @@ class BitVector {
   // Получение компоненты ([ ], см. примечание ниже);
   bool operator[](size_t i) const { return get(i); }
 
-  bool operator==(BitVector &rhs) const {
-    if (nbits != rhs.nbits) {
-      return false;
-    }
-    // non optimal solution
-    for (size_t i = 0; i < nbits; i++) {
-      if (get(i) != rhs.get(i))
-        return false;
-    }
-    return true;
+  // Tail bits are always zero, so whole words compare
+  bool operator==(const BitVector &rhs) const {
+    return nbits == rhs.nbits &&
+           std::equal(data.get(), data.get() + words_for_bits(nbits),
+                      rhs.data.get());
+  }
+
+  // Lexicographic over the bits in index order, a prefix first
+  std::strong_ordering operator<=>(const BitVector &rhs) const {
+    size_t common = std::min(nbits, rhs.nbits);
+    size_t full = common / BITS_PER_WORD;
+    const word_t *a = data.get();
+    const word_t *b = rhs.data.get();
+    size_t w = static_cast<size_t>(std::mismatch(a, a + full, b).first - a);
+    word_t diff = 0;
+    if (w < full)
+      diff = a[w] ^ b[w];
+    else if (common % BITS_PER_WORD != 0)
+      diff = (a[w] ^ b[w]) & ((word_t(1) << (common % BITS_PER_WORD)) - 1);
+    if (diff != 0) // the lowest differing bit decides
+      return (a[w] >> std::countr_zero(diff)) & 1u
+                 ? std::strong_ordering::greater
+                 : std::strong_ordering::less;
+    return nbits <=> rhs.nbits;
   }
 
   // Bitwise operators: &, |, ^ and their compound forms
@@ -339,15 +429,27 @@ class BitVector {
     //   throw std::invalid_argument("Sizes must match for &");
     // }
     BitVector out(*this);
-    size_t nbytes = bytes_for_bits(max(nbits, rhs.nbits));
-    for (size_t i = 0; i < nbytes; ++i)
+    size_t nwords = words_for_bits(nbits);
+    size_t common = std::min(nwords, words_for_bits(rhs.nbits));
+    for (size_t i = 0; i < common; ++i)
       out.data[i] &= rhs.data[i];
-    if (nbytes && (max(nbits, rhs.nbits) % BITS_PER_BYTE != 0))
-      out.data[nbytes - 1] &= out.last_byte_mask();
+    // sizes dont need to match: missing rhs words read as zero.
+    for (size_t i = common; i < nwords; ++i)
+      out.data[i] = 0;
+    if (nwords)
+      out.clear_tail();
     return out;
   }
+  // in place: no copy of the vector, one pass over the words.
   BitVector &operator&=(const BitVector &rhs) {
-    *this = *this & rhs;
+    size_t nwords = words_for_bits(nbits);
+    size_t common = std::min(nwords, words_for_bits(rhs.nbits));
+    for (size_t i = 0; i < common; ++i)
+      data[i] &= rhs.data[i];
+    for (size_t i = common; i < nwords; ++i)
+      data[i] = 0;
+    if (nwords)
+      clear_tail();
     return *this;
   }
 
@@ -355,15 +457,22 @@ class BitVector {
     // if (nbits != rhs.nbits)
     //   throw std::invalid_argument("Sizes must match for |");
     BitVector out(*this);
-    size_t nbytes = bytes_for_bits(max(nbits, rhs.nbits));
-    for (size_t i = 0; i < nbytes; ++i)
+    size_t nwords = words_for_bits(nbits);
+    size_t common = std::min(nwords, words_for_bits(rhs.nbits));
+    for (size_t i = 0; i < common; ++i)
       out.data[i] |= rhs.data[i];
-    if (nbytes && (max(nbits, rhs.nbits) % BITS_PER_BYTE != 0))
-      out.data[nbytes - 1] &= out.last_byte_mask();
+    if (nwords)
+      out.clear_tail();
     return out;
   }
+  // in place: no copy of the vector, one pass over the words.
   BitVector &operator|=(const BitVector &rhs) {
-    *this = *this | rhs;
+    size_t nwords = words_for_bits(nbits);
+    size_t common = std::min(nwords, words_for_bits(rhs.nbits));
+    for (size_t i = 0; i < common; ++i)
+      data[i] |= rhs.data[i];
+    if (nwords)
+      clear_tail();
     return *this;
   }
 
@@ -371,65 +480,81 @@ class BitVector {
     // if (nbits != rhs.nbits)
     // throw std::invalid_argument("Sizes must match for ^");
     BitVector out(*this);
-    size_t nbytes = bytes_for_bits(max(nbits, rhs.nbits));
-    for (size_t i = 0; i < nbytes; ++i)
+    size_t nwords = words_for_bits(nbits);
+    size_t common = std::min(nwords, words_for_bits(rhs.nbits));
+    for (size_t i = 0; i < common; ++i)
       out.data[i] ^= rhs.data[i];
-    if (nbytes && (max(nbits, rhs.nbits) % BITS_PER_BYTE != 0))
-      out.data[nbytes - 1] &= out.last_byte_mask();
+    if (nwords)
+      out.clear_tail();
     return out;
   }
+  // in place: no copy of the vector, one pass over the words.
   BitVector &operator^=(const BitVector &rhs) {
-    *this = *this ^ rhs;
+    size_t nwords = words_for_bits(nbits);
+    size_t common = std::min(nwords, words_for_bits(rhs.nbits));
+    for (size_t i = 0; i < common; ++i)
+      data[i] ^= rhs.data[i];
+    if (nwords)
+      clear_tail();
     return *this;
   }
 
   // bitwise NOT
   BitVector operator~() const {
     BitVector out(*this);
-    size_t nbytes = bytes_for_bits(nbits);
-    for (size_t i = 0; i < nbytes; ++i)
-      out.data[i] = static_cast<byte_t>(~out.data[i]);
-    if (nbytes && (nbits % BITS_PER_BYTE != 0))
-      out.data[nbytes - 1] &= out.last_byte_mask();
+    out.flipAll();
     return out;
   }
 
   // shift operators
-  // Left Shift
-  BitVector operator<<(const size_t off) {
-    if (off >= nbits)
-      return BitVector(nbits, false);
-
-    BitVector out(nbits, false);
-    for (size_t i = 0; i < nbits - off; ++i) {
-      if (get(i + off)) {
-        out.set(i, true);
-      }
+  // Whole words move at once; the remainder r is funnel-shifted in from the
+  // neighbouring word: (w[k] >> r) | (w[k + 1] << (64 - r)).
+
+  // Left Shift (bit i takes the value of bit i + off, in place)
+  BitVector &operator<<=(const size_t off) {
+    if (off >= nbits) {
+      setAll(false);
+      return *this;
+    }
+    size_t nwords = words_for_bits(nbits);
+    size_t q = off / BITS_PER_WORD; // whole words
+    size_t r = off % BITS_PER_WORD; // remaining bits
+    for (size_t w = 0; w < nwords; ++w) {
+      word_t lo = w + q < nwords ? data[w + q] : 0;
+      word_t hi = w + q + 1 < nwords ? data[w + q + 1] : 0;
+      data[w] = r ? (lo >> r) | (hi << (BITS_PER_WORD - r)) : lo;
     }
-    return out;
-  }
-  BitVector operator<<=(const size_t off) {
-    *this = *this << off;
     return *this;
   }
-
-  // Right Shift
-  BitVector operator>>(const size_t off) {
-    if (off >= nbits)
-      return BitVector(nbits, false);
-
-    BitVector out(nbits, false);
-    for (size_t i = 0; i < nbits - off; ++i) {
-      if (get(i)) {
-        out.set(i + off, true);
-      }
-    }
+  BitVector operator<<(const size_t off) const {
+    BitVector out(*this);
+    out <<= off;
     return out;
   }
-  BitVector operator>>=(const size_t off) {
-    *this = *this >> off;
+
+  // Right Shift (bit i + off takes the value of bit i, in place)
+  BitVector &operator>>=(const size_t off) {
+    if (off >= nbits) {
+      setAll(false);
+      return *this;
+    }
+    size_t nwords = words_for_bits(nbits);
+    size_t q = off / BITS_PER_WORD;
+    size_t r = off % BITS_PER_WORD;
+    // walk from the top so no word is read after it was overwritten
+    for (size_t w = nwords; w-- > 0;) {
+      word_t hi = w >= q ? data[w - q] : 0;
+      word_t lo = w >= q + 1 ? data[w - q - 1] : 0;
+      data[w] = r ? (hi << r) | (lo >> (BITS_PER_WORD - r)) : hi;
+    }
+    clear_tail();
     return *this;
   }
+  BitVector operator>>(const size_t off) const {
+    BitVector out(*this);
+    out >>= off;
+    return out;
+  }
 };
 
 inline std::ostream &operator<<(std::ostream &os, const BitVector &bv) {